@@ -0,0 +1,151 @@
+/*
+ * File:  align_output.c
+ * Author: Stefano Ribes
+ *
+ * The records are formatted by hand: printf() parses its format string at
+ * every call, which dominates the cost of short records.
+ */
+#include "align_output.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void out_init(out_buffer_t* out, FILE* stream, const size_t capacity) {
+  out->capacity = capacity > 0 ? capacity : 1;
+  out->data = malloc(out->capacity);
+  out->length = 0;
+  out->stream = stream;
+  if (out->data == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the output buffer\n");
+    exit(1);
+  }
+}
+
+void out_flush(out_buffer_t* out) {
+  if (out->length > 0) {
+    fwrite(out->data, 1, out->length, out->stream);
+    out->length = 0;
+  }
+}
+
+void out_free(out_buffer_t* out) {
+  out_flush(out);
+  free(out->data);
+  out->data = NULL;
+}
+
+/**
+ * @brief      Makes room for some bytes: flushes the buffer if they do not
+ *             fit, and grows it if they do not fit in an empty one either.
+ */
+static inline void out_reserve(out_buffer_t* out, const size_t length) {
+  if (out->length + length <= out->capacity) {
+    return;
+  }
+  out_flush(out);
+  if (length > out->capacity) {
+    out->capacity = length;
+    out->data = realloc(out->data, out->capacity);
+    if (out->data == NULL) {
+      fprintf(stderr, "ERROR. Unable to allocate the output buffer\n");
+      exit(1);
+    }
+  }
+}
+
+void out_bytes(out_buffer_t* out, const char* data, const size_t length) {
+  out_reserve(out, length);
+  memcpy(out->data + out->length, data, length);
+  out->length += length;
+}
+
+void out_string(out_buffer_t* out, const char* s) {
+  out_bytes(out, s, strlen(s));
+}
+
+void out_char(out_buffer_t* out, const char c) {
+  out_reserve(out, 1);
+  out->data[out->length++] = c;
+}
+
+void out_int(out_buffer_t* out, const long value) {
+  char digits[24];
+  int num_digits = 0;
+  unsigned long v = value < 0 ? -(unsigned long)value : (unsigned long)value;
+  do {
+    digits[sizeof(digits) - 1 - num_digits++] = '0' + v % 10;
+    v /= 10;
+  } while (v > 0);
+  if (value < 0) {
+    digits[sizeof(digits) - 1 - num_digits++] = '-';
+  }
+  out_bytes(out, digits + sizeof(digits) - num_digits, num_digits);
+}
+
+int out_cigar(out_buffer_t* out, const int length, const char* alignX,
+    const char* alignY) {
+  if (length == 0) {
+    out_char(out, '*');
+    return 0;
+  }
+  int num_identical = 0;
+  char op = 0;
+  int run = 0;
+  for (int k = length - 1; k >= 0; --k) {
+    const char kOp = alignX[k] == '-' ? 'D' : alignY[k] == '-' ? 'I' : 'M';
+    num_identical += alignX[k] == alignY[k];
+    if (kOp != op && run > 0) {
+      out_int(out, run);
+      out_char(out, op);
+      run = 0;
+    }
+    op = kOp;
+    ++run;
+  }
+  out_int(out, run);
+  out_char(out, op);
+  return num_identical;
+}
+
+void out_alignment(out_buffer_t* out, const char* x_name, const int x_start,
+    const int x_end, const char* y_name, const int y_start, const int y_end,
+    const int score, const int length, const char* alignX,
+    const char* alignY) {
+  out_string(out, x_name);
+  out_char(out, '\t');
+  out_int(out, x_start);
+  out_char(out, '\t');
+  out_int(out, x_end);
+  out_char(out, '\t');
+  out_string(out, y_name);
+  out_char(out, '\t');
+  out_int(out, y_start);
+  out_char(out, '\t');
+  out_int(out, y_end);
+  out_char(out, '\t');
+  out_int(out, score);
+  out_char(out, '\t');
+  /*
+   * The identity is counted while writing the CIGAR, which follows it: the
+   * CIGAR is written past a slot wide enough for the identity, then moved
+   * back next to it. A run of r symbols takes at most r + 1 <= 2 r bytes.
+   */
+  const size_t kSlot = sizeof("100.00\t") - 1;
+  out_reserve(out, kSlot + 2 * (size_t)length + 2);
+  const size_t kIdentity = out->length;
+  out->length += kSlot;
+  const int kNumIdentical = out_cigar(out, length, alignX, alignY);
+  const size_t kCigarBytes = out->length - kIdentity - kSlot;
+  out->length = kIdentity;
+  const long kHundredths = length > 0 ?
+    ((long)kNumIdentical * 10000 + length / 2) / length : 0;
+  out_int(out, kHundredths / 100);
+  const char kDecimals[4] = {
+    '.', '0' + kHundredths / 10 % 10, '0' + kHundredths % 10, '\t'
+  };
+  out_bytes(out, kDecimals, sizeof(kDecimals));
+  memmove(out->data + out->length, out->data + kIdentity + kSlot,
+    kCigarBytes);
+  out->length += kCigarBytes;
+  out_char(out, '\n');
+}
@@ -0,0 +1,96 @@
+/*
+ * File:  align_output.h
+ * Author: Stefano Ribes
+ */
+#ifndef ALIGN_OUTPUT_H_
+#define ALIGN_OUTPUT_H_
+
+#include <stdio.h>
+
+#define OUT_BUFFER_BYTES (4 << 20) // Default capacity of an output buffer
+
+/*
+ * @brief      Output buffer written to its stream with one fwrite() when it is
+ *             full or flushed, so that a batch of records costs a single
+ *             write.
+ */
+typedef struct {
+  char* data;
+  size_t length;
+  size_t capacity;
+  FILE* stream;
+} out_buffer_t;
+
+/**
+ * @brief      Initialises an output buffer.
+ *
+ * @param      out       The buffer, to be released with out_free()
+ * @param      stream    The stream the buffer is written to
+ * @param[in]  capacity  The capacity in bytes, e.g. OUT_BUFFER_BYTES
+ */
+void out_init(out_buffer_t* out, FILE* stream, const size_t capacity);
+
+/**
+ * @brief      Writes the buffer to its stream and empties it.
+ *
+ * @param      out   The buffer
+ */
+void out_flush(out_buffer_t* out);
+
+/**
+ * @brief      Flushes and releases an output buffer.
+ *
+ * @param      out   The buffer
+ */
+void out_free(out_buffer_t* out);
+
+/**
+ * @brief      Appends bytes, a string, a character or a decimal integer.
+ */
+void out_bytes(out_buffer_t* out, const char* data, const size_t length);
+void out_string(out_buffer_t* out, const char* s);
+void out_char(out_buffer_t* out, const char c);
+void out_int(out_buffer_t* out, const long value);
+
+/**
+ * @brief      Appends the CIGAR string of an alignment: runs of M (match or
+ *             mismatch), I (symbol of X against a gap) and D (gap against a
+ *             symbol of Y), "*" for an empty alignment.
+ *
+ * @param      out     The buffer
+ * @param[in]  length  The length of the alignment
+ * @param[in]  alignX  The aligned X, backwards
+ * @param[in]  alignY  The aligned Y, backwards
+ *
+ * @return     The number of identical aligned symbols.
+ */
+int out_cigar(out_buffer_t* out, const int length, const char* alignX,
+    const char* alignY);
+
+/**
+ * @brief      Appends a tab-separated alignment record:
+ *
+ *             x_name x_start x_end y_name y_start y_end score identity cigar
+ *
+ *             The alignment covers X[x_start .. x_end-1] and Y[y_start ..
+ *             y_end-1]. The identity is the percentage of identical symbols
+ *             over the alignment length, as in print_alignment().
+ *
+ * @param      out      The buffer
+ * @param[in]  x_name   The name of X
+ * @param[in]  x_start  The first position of X
+ * @param[in]  x_end    The position of X past the alignment
+ * @param[in]  y_name   The name of Y
+ * @param[in]  y_start  The first position of Y
+ * @param[in]  y_end    The position of Y past the alignment
+ * @param[in]  score    The score
+ * @param[in]  length   The length of the alignment
+ * @param[in]  alignX   The aligned X, backwards
+ * @param[in]  alignY   The aligned Y, backwards
+ */
+void out_alignment(out_buffer_t* out, const char* x_name, const int x_start,
+    const int x_end, const char* y_name, const int y_start, const int y_end,
+    const int score, const int length, const char* alignX,
+    const char* alignY);
+
+#endif // end ALIGN_OUTPUT_H_
@@ -0,0 +1,51 @@
+/*
+ * File:  alignment.c
+ * Author: Stefano Ribes
+ */
+#include "alignment.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int seq_length(const char* X) {
+  int m = 0;
+  while (X[m] != 0) {
+    ++m;
+  }
+  return m;
+}
+
+void print_alignment(const int alignment_length, const char* alignX,
+    const char* alignY) {
+  /*
+   * The three rows are built in one buffer and written at once, instead of a
+   * printf() per character.
+   */
+  const size_t kRow = (size_t)alignment_length + 1;
+  char* rows = malloc(kRow * 3);
+  if (rows == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the alignment rows\n");
+    exit(1);
+  }
+  int match_cnt = 0;
+  for (int i = alignment_length - 1, k = 0; i >= 0; --i, ++k) {
+    rows[k] = alignX[i];
+    rows[kRow + k] = alignX[i] == alignY[i] ? '|' : ' ';
+    rows[2 * kRow + k] = alignY[i];
+    match_cnt += alignX[i] == alignY[i];
+  }
+  rows[kRow - 1] = '\n';
+  rows[2 * kRow - 1] = '\n';
+  rows[3 * kRow - 1] = '\n';
+  printf("* Alignment Sequence:\n");
+  fwrite(rows, 1, kRow * 3, stdout);
+  free(rows);
+  // NOTE: The percentage identity is calculated based on the total alignment
+  // length, i.e. including all the indel.
+  const float perc_identity = (float)match_cnt / (float)alignment_length * 100.;
+  printf("[INFO] Percent identity: %.2f%%\n", perc_identity);
+  // NOTE: The Hamming distance only works for sequences of same length. We
+  // calculate the Hamming distance by getting the difference between the
+  // aligned sequences and the number of matches.
+  printf("[INFO] Hamming distance: %d\n", alignment_length - match_cnt);
+}
@@ -0,0 +1,77 @@
+/*
+ * File:  alignment.h
+ * Author: Stefano Ribes
+ */
+#ifndef ALIGNMENT_H_
+#define ALIGNMENT_H_
+
+#include <stddef.h>
+
+#define MATCH_SCORE 2
+#define MISMATCH_SCORE -1
+#define GAP_PENALTY 2
+
+/*
+ * Kernels specialised through compile-time constant parameters must be inlined
+ * in each of their call sites.
+ */
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+#define STOP 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+
+/*
+ * @brief      Data structure to store the up, left and diagonal scores of a
+ *             cell.
+ */
+typedef struct {
+  int up;
+  int diag;
+  int left;
+} score_t;
+
+/*
+ * @brief      Index data structure to store cells coordinates.
+ */
+typedef struct {
+  int x;
+  int y;
+} idx_t;
+
+/**
+ * @brief      Gets the linear index of cell (i, j) in a row-major matrix with
+ *             n + 1 columns.
+ *
+ * @param[in]  i     The row index
+ * @param[in]  j     The column index
+ * @param[in]  n     The length of the Y sequence
+ *
+ * @return     The cell index.
+ */
+static inline size_t cell_idx(const int i, const int j, const int n) {
+  return (size_t)i * (size_t)(n + 1) + (size_t)j;
+}
+
+/**
+ * @brief      Gets the length of a (null-terminated) sequence.
+ *
+ * @param[in]  X     The sequence
+ *
+ * @return     The sequence length.
+ */
+int seq_length(const char* X);
+
+/**
+ * @brief      Prints an alignment sequence. The aligned strings are stored
+ *             backwards, i.e. as produced by the traceback.
+ *
+ * @param[in]  alignment_length  The alignment length
+ * @param[in]  alignX            The aligned string of the x sequence
+ * @param[in]  alignY            The aligned string of the y sequence
+ */
+void print_alignment(const int alignment_length, const char* alignX,
+    const char* alignY);
+
+#endif // end ALIGNMENT_H_
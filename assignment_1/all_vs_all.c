@@ -0,0 +1,293 @@
+/*
+ * @author     Stefano Ribes
+ *
+ * @brief      All-vs-all pairwise comparison of a collection of sequences.
+ *
+ * @details    To compile this C program, type:
+ *
+ *             make all_vs_all.exe
+ *
+ *             To run the program, type:
+ *
+ *             ./all_vs_all.exe [--metric score|edit|identity] [--tile T]
+ *               [--threads N] [--matrix identity|dna|blosum62|pam250]
+ *               [--print] sequences.fa matrix.bin
+ *
+ *             The sequences file is either in FASTA format or it holds one
+ *             sequence per line. The upper triangle of the N x N matrix is
+ *             split in tiles of T x T pairs (64 by default), scheduled
+ *             dynamically across the threads. Within a tile, the profile of
+ *             each query (the score profile of the global alignment, or the
+ *             bit vectors of the edit distance) is built once and reused for
+ *             all of its targets.
+ *
+ *             The result is the memory-mapped matrix.bin: a header, one done
+ *             flag per tile, then the full symmetric matrix of N x N floats
+ *             in row-major order. A tile is flagged once all of its values
+ *             are written, so an interrupted run started again with the same
+ *             sequences and parameters only computes the missing tiles. With
+ *             --print, the matrix is also printed as tab-separated values.
+ */
+#include "pairwise.h"
+#include "scoring.h"
+#include "sequence_io.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <omp.h>
+
+#define DEFAULT_TILE 64
+#define MATRIX_MAGIC "AVAMTX01"
+
+#define USAGE "ERROR. Usage: %s [--metric score|edit|identity] [--tile T] " \
+  "[--threads N] [--matrix identity|dna|blosum62|pam250] [--print] " \
+  "sequences.fa matrix.bin\n"
+
+/*
+ * @brief      Header of the result file, followed by the done flags of the
+ *             tiles (padded to 8 bytes) and the matrix.
+ */
+typedef struct {
+  char magic[8];
+  uint32_t num_sequences;
+  uint32_t metric;
+  uint32_t matrix;
+  uint32_t tile;
+  uint64_t fingerprint; // Hash of the sequences
+  uint64_t num_tiles;
+  uint64_t reserved[3];
+} matrix_header_t;
+
+/*
+ * @brief      Tile of pairs (i, j), i in block bi and j in block bj >= bi.
+ */
+typedef struct {
+  int bi;
+  int bj;
+} tile_t;
+
+/*
+ * @brief      Result file, memory-mapped.
+ */
+typedef struct {
+  matrix_header_t* header;
+  uint8_t* done;
+  float* values;
+  size_t size;
+} result_file_t;
+
+/**
+ * @brief      Hashes the sequences (FNV-1a), so that a result file is only
+ *             resumed with the sequences it was started with.
+ */
+static uint64_t fingerprint(const sequence_t* seqs, const int num_seqs) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (int s = 0; s < num_seqs; ++s) {
+    for (int i = 0; i <= seqs[s].length; ++i) { // Terminator included
+      hash = (hash ^ (uint8_t)seqs[s].seq[i]) * 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+/**
+ * @brief      Maps the result file, creating it unless it matches the header,
+ *             in which case its done tiles are kept.
+ *
+ * @param[in]  filename  The filename
+ * @param[in]  expected  The expected header
+ * @param      file      The result file
+ *
+ * @return     Whether the file was resumed.
+ */
+static bool map_result(const char* filename, const matrix_header_t* expected,
+    result_file_t* file) {
+  const size_t kFlagBytes = (expected->num_tiles + 7) / 8 * 8;
+  const size_t kNumValues = (size_t)expected->num_sequences *
+    expected->num_sequences;
+  file->size = sizeof(matrix_header_t) + kFlagBytes +
+    sizeof(float) * kNumValues;
+  const int fd = open(filename, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR. Unable to open %s\n", filename);
+    exit(1);
+  }
+  matrix_header_t header;
+  const bool kResumed = pread(fd, &header, sizeof(header), 0) ==
+    sizeof(header) && memcmp(&header, expected, sizeof(header)) == 0 &&
+    lseek(fd, 0, SEEK_END) == (off_t)file->size;
+  if (!kResumed && (ftruncate(fd, 0) != 0 ||
+      ftruncate(fd, file->size) != 0)) {
+    fprintf(stderr, "ERROR. Unable to allocate %zu bytes for %s\n",
+      file->size, filename);
+    exit(1);
+  }
+  void* data = mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+    0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "ERROR. Unable to map %s\n", filename);
+    exit(1);
+  }
+  file->header = data;
+  file->done = (uint8_t*)data + sizeof(matrix_header_t);
+  file->values = (float*)(file->done + kFlagBytes);
+  if (!kResumed) {
+    *file->header = *expected;
+  }
+  return kResumed;
+}
+
+/**
+ * @brief      Computes the pairs of a tile and flags it as done.
+ *
+ * @return     The number of cells of the pairs.
+ */
+static double compute_tile(const tile_t* tile, const int tile_size,
+    const sequence_t* seqs, uint8_t** codes, const int num_seqs,
+    const metric_t metric, const matrix_t matrix, result_file_t* file,
+    const size_t t) {
+  const int kEndI = (tile->bi + 1) * tile_size < num_seqs ?
+    (tile->bi + 1) * tile_size : num_seqs;
+  const int kEndJ = (tile->bj + 1) * tile_size < num_seqs ?
+    (tile->bj + 1) * tile_size : num_seqs;
+  double num_cells = 0;
+  for (int i = tile->bi * tile_size; i < kEndI; ++i) {
+    query_profile_t query;
+    query_profile_init(&query, codes[i], seqs[i].length, metric, matrix);
+    const int kStartJ = tile->bj * tile_size > i ? tile->bj * tile_size : i;
+    for (int j = kStartJ; j < kEndJ; ++j) {
+      const float kValue = query_profile_compare(&query, codes[j],
+        seqs[j].length);
+      file->values[(size_t)i * num_seqs + j] = kValue;
+      file->values[(size_t)j * num_seqs + i] = kValue;
+      num_cells += (double)seqs[i].length * seqs[j].length;
+    }
+    query_profile_free(&query);
+  }
+  // The flag is only stored after the values.
+  __atomic_store_n(&file->done[t], 1, __ATOMIC_RELEASE);
+  return num_cells;
+}
+
+int main(int argc, char** argv) {
+  metric_t metric = METRIC_SCORE;
+  matrix_t matrix = MATRIX_IDENTITY;
+  int tile_size = DEFAULT_TILE;
+  int num_threads = omp_get_max_threads();
+  bool print = false;
+  const char* filenames[2] = {NULL, NULL};
+  int num_files = 0;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--metric") == 0 && arg + 1 < argc) {
+      if (parse_metric(argv[++arg], &metric)) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--matrix") == 0 && arg + 1 < argc) {
+      if (parse_matrix(argv[++arg], &matrix)) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--tile") == 0 && arg + 1 < argc) {
+      tile_size = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+      num_threads = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--print") == 0) {
+      print = true;
+    } else if (num_files < 2) {
+      filenames[num_files++] = argv[arg];
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  if (num_files != 2 || tile_size < 1) {
+    fprintf(stderr, USAGE, argv[0]);
+    exit(1);
+  }
+  int num_seqs = 0;
+  sequence_t* seqs = read_sequences(filenames[0], &num_seqs);
+  uint8_t** codes = malloc(sizeof(uint8_t*) * (num_seqs + 1));
+  for (int s = 0; s < num_seqs; ++s) {
+    codes[s] = metric == METRIC_SCORE ?
+      encode_sequence(matrix, seqs[s].seq, seqs[s].length) :
+      (uint8_t*)seqs[s].seq;
+  }
+  /*
+   * Tiles of the upper triangle, and the result file
+   */
+  const int kNumBlocks = (num_seqs + tile_size - 1) / tile_size;
+  const size_t kNumTiles = (size_t)kNumBlocks * (kNumBlocks + 1) / 2;
+  tile_t* tiles = malloc(sizeof(tile_t) * (kNumTiles + 1));
+  size_t t = 0;
+  for (int bi = 0; bi < kNumBlocks; ++bi) {
+    for (int bj = bi; bj < kNumBlocks; ++bj) {
+      tiles[t].bi = bi;
+      tiles[t].bj = bj;
+      ++t;
+    }
+  }
+  matrix_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MATRIX_MAGIC, sizeof(header.magic));
+  header.num_sequences = num_seqs;
+  header.metric = metric;
+  header.matrix = metric == METRIC_SCORE ? matrix : MATRIX_IDENTITY;
+  header.tile = tile_size;
+  header.fingerprint = fingerprint(seqs, num_seqs);
+  header.num_tiles = kNumTiles;
+  result_file_t file;
+  const bool kResumed = map_result(filenames[1], &header, &file);
+  size_t* pending = malloc(sizeof(size_t) * (kNumTiles + 1));
+  size_t num_pending = 0;
+  for (t = 0; t < kNumTiles; ++t) {
+    if (!kResumed || !file.done[t]) {
+      pending[num_pending++] = t;
+    }
+  }
+  fprintf(stderr, "[INFO] %d sequences, %zu tiles of %dx%d pairs, %zu done "
+    "by a previous run\n", num_seqs, kNumTiles, tile_size, tile_size,
+    kNumTiles - num_pending);
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  double num_cells = 0;
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1) \
+      reduction(+: num_cells)
+  for (size_t p = 0; p < num_pending; ++p) {
+    num_cells += compute_tile(&tiles[pending[p]], tile_size, seqs, codes,
+      num_seqs, metric, matrix, &file, pending[p]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  const double kSeconds = (end.tv_sec - start.tv_sec) +
+    (end.tv_nsec - start.tv_nsec) * 1e-9;
+  fprintf(stderr, "[INFO] %s of %zu tiles in %.3f s: %.3f GCUPS (%s)\n",
+    metric_name(metric), num_pending, kSeconds,
+    num_cells / (kSeconds > 0 ? kSeconds : 1e-9) * 1e-9, filenames[1]);
+  if (print) {
+    for (int i = 0; i < num_seqs; ++i) {
+      for (int j = 0; j < num_seqs; ++j) {
+        printf(j + 1 < num_seqs ? "%g\t" : "%g\n",
+          file.values[(size_t)i * num_seqs + j]);
+      }
+    }
+  }
+  msync(file.header, file.size, MS_SYNC);
+  munmap(file.header, file.size);
+  if (metric == METRIC_SCORE) {
+    for (int s = 0; s < num_seqs; ++s) {
+      free(codes[s]);
+    }
+  }
+  free(codes);
+  free(tiles);
+  free(pending);
+  free_sequences(seqs, num_seqs);
+  return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * File:  banded.c
+ * Author: Stefano Ribes
+ *
+ * Banded global alignment. The cells of row i are indexed by their offset
+ * t = j - i - lo from the lowest diagonal lo of the band, so that cell (i, j)
+ * reads the diagonal neighbour at offset t and the upper one at offset t + 1
+ * of the previous row, and the left one at offset t - 1 of the same row. The
+ * rows have a sentinel cell at each end, scoring minus infinity.
+ */
+#include "banded.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MINUS_INF (INT_MIN / 4) // Cells outside of the band
+
+/*
+ * @brief      Band of diagonals [lo, hi], clipped to the matrix.
+ */
+typedef struct {
+  int lo;
+  int hi;
+  int width;
+  size_t row_bytes; // Trace bytes of a row, 4 cells per byte
+} band_t;
+
+static band_t make_band(const int m, const int n, const int band) {
+  band_t b;
+  b.lo = (n - m < 0 ? n - m : 0) - band;
+  b.hi = (n - m > 0 ? n - m : 0) + band;
+  b.lo = b.lo > -m ? b.lo : -m;
+  b.hi = b.hi < n ? b.hi : n;
+  b.width = b.hi - b.lo + 1;
+  b.row_bytes = ((size_t)b.width + 3) / 4;
+  return b;
+}
+
+size_t banded_trace_bytes(const int m, const int n, const int band) {
+  return ((size_t)m + 1) * make_band(m, n, band).row_bytes;
+}
+
+static inline int get_trace(const uint8_t* trace, const band_t* b,
+    const int i, const int j) {
+  const int t = j - i - b->lo;
+  return (trace[(size_t)i * b->row_bytes + (t >> 2)] >> ((t & 3) * 2)) & 3;
+}
+
+/**
+ * @brief      Whether no path leaving the band can reach a given score. Such a
+ *             path touches a diagonal outside of [lo, hi], hence it has at
+ *             least |m - n| + 2 (band + 1) gaps, and at most
+ *             (m + n - gaps) / 2 substitutions.
+ */
+static bool is_above_bound(const int m, const int n, const matrix_t matrix,
+    const band_t* b, const int band, const int score) {
+  if (b->lo == -m && b->hi == n) {
+    return true; // The band is the whole matrix
+  }
+  const long kMinGaps = (long)(m > n ? m - n : n - m) + 2 * ((long)band + 1);
+  const long kMaxSubstitutions = ((long)m + n - kMinGaps) / 2;
+  if (kMaxSubstitutions < 0) {
+    return true;
+  }
+  const long kBound = kMaxSubstitutions * matrix_max_score(matrix) -
+    kMinGaps * GAP_PENALTY;
+  return score > kBound;
+}
+
+/*
+ * The matrix parameter is a compile-time constant at every call site, so the
+ * compiler emits a specialised loop for each matrix.
+ */
+static ALWAYS_INLINE int fill_band_matrix(const uint8_t* X, const uint8_t* Y,
+    const int m, const int n, const band_t* b, int* prev, int* curr,
+    uint8_t* trace, const matrix_t matrix) {
+  // Row 0, with the sentinels at offsets -1 and width.
+  for (int t = -1; t <= b->width; ++t) {
+    const int j = t + b->lo;
+    prev[t+1] = t >= 0 && t < b->width && j >= 0 ? -GAP_PENALTY * j :
+      MINUS_INF;
+  }
+  for (int i = 1; i <= m; ++i) {
+    for (int t = -1; t <= b->width; ++t) {
+      curr[t+1] = MINUS_INF;
+    }
+    const uint8_t x = X[i-1];
+    uint8_t* trace_row = trace + (size_t)i * b->row_bytes;
+    int j_start = i + b->lo;
+    if (j_start <= 0) {
+      curr[-i - b->lo + 1] = -GAP_PENALTY * i; // Column 0, traced as STOP
+      j_start = 1;
+    }
+    const int kEnd = i + b->hi < n ? i + b->hi : n;
+    for (int j = j_start; j <= kEnd; ++j) {
+      const int t = j - i - b->lo;
+      // Same tie breaking of the full matrix fill (DIAG, then UP, then LEFT).
+      const int diag = prev[t+1] + substitution_score(matrix, x, Y[j-1]);
+      const int up = prev[t+2] - GAP_PENALTY;
+      const int left = curr[t] - GAP_PENALTY;
+      int score = up > diag ? up : diag;
+      int dir = up > diag ? UP : DIAG;
+      dir = left > score ? LEFT : dir;
+      score = left > score ? left : score;
+      curr[t+1] = score;
+      trace_row[t >> 2] |= dir << ((t & 3) * 2);
+    }
+    int* tmp = prev;
+    prev = curr;
+    curr = tmp;
+  }
+  return prev[n - m - b->lo + 1];
+}
+
+static int fill_band(const uint8_t* X, const uint8_t* Y, const int m,
+    const int n, const band_t* b, int* prev, int* curr, uint8_t* trace,
+    const matrix_t matrix) {
+  switch (matrix) {
+    case MATRIX_DNA:
+      return fill_band_matrix(X, Y, m, n, b, prev, curr, trace, MATRIX_DNA);
+    case MATRIX_BLOSUM62:
+      return fill_band_matrix(X, Y, m, n, b, prev, curr, trace,
+        MATRIX_BLOSUM62);
+    case MATRIX_PAM250:
+      return fill_band_matrix(X, Y, m, n, b, prev, curr, trace,
+        MATRIX_PAM250);
+    default:
+      return fill_band_matrix(X, Y, m, n, b, prev, curr, trace,
+        MATRIX_IDENTITY);
+  }
+}
+
+band_result_t banded_align(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, const int band, char* alignX,
+    char* alignY) {
+  const band_t b = make_band(m, n, band);
+  uint8_t* trace = calloc((size_t)(m + 1) * b.row_bytes, sizeof(uint8_t));
+  int* prev = malloc(sizeof(int) * (b.width + 2));
+  int* curr = malloc(sizeof(int) * (b.width + 2));
+  if (trace == NULL || prev == NULL || curr == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d band of %d\n", m, n,
+      band);
+    exit(1);
+  }
+  uint8_t* X_codes = encode_sequence(matrix, X, m);
+  uint8_t* Y_codes = encode_sequence(matrix, Y, n);
+  band_result_t result;
+  result.score = fill_band(X_codes, Y_codes, m, n, &b, prev, curr, trace,
+    matrix);
+  result.band = band;
+  result.num_passes = 1;
+  result.is_optimal = is_above_bound(m, n, matrix, &b, band, result.score);
+  /*
+   * Trace back from the lower-right corner of the matrix
+   */
+  int i = m;
+  int j = n;
+  int alignment_length = 0;
+  while (i > 0 && j > 0 && get_trace(trace, &b, i, j) != STOP) {
+    switch (get_trace(trace, &b, i, j)) {
+      case DIAG:
+        alignX[alignment_length] = X[i-1];
+        alignY[alignment_length] = Y[j-1];
+        --i;
+        --j;
+        break;
+      case LEFT:
+        alignX[alignment_length] = '-';
+        alignY[alignment_length] = Y[j-1];
+        --j;
+        break;
+      case UP:
+        alignX[alignment_length] = X[i-1];
+        alignY[alignment_length] = '-';
+        --i;
+        break;
+    }
+    ++alignment_length;
+  }
+  /*
+   * Unaligned beginning
+   */
+  while (i > 0) {
+    alignX[alignment_length] = X[i-1];
+    alignY[alignment_length] = '-';
+    --i;
+    ++alignment_length;
+  }
+  while (j > 0) {
+    alignX[alignment_length] = '-';
+    alignY[alignment_length] = Y[j-1];
+    --j;
+    ++alignment_length;
+  }
+  result.length = alignment_length;
+  free(trace);
+  free(prev);
+  free(curr);
+  free(X_codes);
+  free(Y_codes);
+  return result;
+}
+
+band_result_t banded_align_adaptive(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, const int start_band,
+    const size_t max_bytes, char* alignX, char* alignY) {
+  band_result_t result;
+  result.score = 0;
+  result.band = start_band > 0 ? start_band : 1;
+  result.num_passes = 0;
+  result.is_optimal = false;
+  result.length = 0;
+  const int kMaxBand = m > n ? m : n;
+  for (int band = result.band; banded_trace_bytes(m, n, band) <= max_bytes;
+       band *= 2) {
+    const int kPasses = result.num_passes;
+    result = banded_align(X, Y, m, n, matrix, band, alignX, alignY);
+    result.num_passes += kPasses;
+    if (result.is_optimal || band >= kMaxBand) {
+      break;
+    }
+  }
+  return result;
+}
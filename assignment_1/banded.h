@@ -0,0 +1,91 @@
+/*
+ * File:  banded.h
+ * Author: Stefano Ribes
+ */
+#ifndef BANDED_H_
+#define BANDED_H_
+
+#include "alignment.h"
+#include "scoring.h"
+
+#include <stdbool.h>
+
+#define BAND_START 16 // First band of the adaptive mode
+
+/*
+ * @brief      Result of a banded global alignment.
+ */
+typedef struct {
+  int score;
+  int band; // Band used, i.e. the one of the last pass
+  int num_passes; // Number of passes, the band doubling after each one
+  bool is_optimal; // Whether the score is provably the optimal one
+  int length; // Alignment length, zero if the alignment was not computed
+} band_result_t;
+
+/**
+ * @brief      Global alignment restricted to a band of diagonals. The band
+ *             holds the diagonals between the main one and the one of cell
+ *             (m, n), widened by band diagonals on each side, and the cells
+ *             outside of it score minus infinity. Only the band is stored:
+ *             two rows of scores and the trace, 2 bits per cell.
+ *
+ *             A path leaving the band has at least |m - n| + 2 (band + 1)
+ *             gaps, which bounds its score. When the banded score is above
+ *             that bound, the optimal paths lie in the band and the alignment
+ *             is exactly the one of the full matrix traceback, ties included.
+ *
+ * @param[in]  X       The X input sequence
+ * @param[in]  Y       The Y input sequence
+ * @param[in]  m       The length of the X sequence
+ * @param[in]  n       The length of the Y sequence
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  band    The number of diagonals on each side
+ * @param      alignX  The aligned X sequence, stored backwards (at least
+ *                     m + n characters)
+ * @param      alignY  The aligned Y sequence, stored backwards (at least
+ *                     m + n characters)
+ *
+ * @return     The score, the band and whether the score is optimal.
+ */
+band_result_t banded_align(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, const int band, char* alignX,
+    char* alignY);
+
+/**
+ * @brief      Banded global alignment, doubling the band from start_band
+ *             until the score is provably optimal, see banded_align(). The
+ *             band stops growing when its trace would exceed max_bytes, in
+ *             which case the result of the last pass is not optimal.
+ *
+ * @param[in]  X           The X input sequence
+ * @param[in]  Y           The Y input sequence
+ * @param[in]  m           The length of the X sequence
+ * @param[in]  n           The length of the Y sequence
+ * @param[in]  matrix      The substitution matrix
+ * @param[in]  start_band  The band of the first pass
+ * @param[in]  max_bytes   The maximum size of the trace
+ * @param      alignX      The aligned X sequence, stored backwards (at least
+ *                         m + n characters)
+ * @param      alignY      The aligned Y sequence, stored backwards (at least
+ *                         m + n characters)
+ *
+ * @return     The result of the last pass, with no passes if even the first
+ *             band exceeds max_bytes.
+ */
+band_result_t banded_align_adaptive(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, const int start_band,
+    const size_t max_bytes, char* alignX, char* alignY);
+
+/**
+ * @brief      Gets the size of the trace of a banded alignment.
+ *
+ * @param[in]  m     The length of the X sequence
+ * @param[in]  n     The length of the Y sequence
+ * @param[in]  band  The number of diagonals on each side
+ *
+ * @return     The trace size in bytes.
+ */
+size_t banded_trace_bytes(const int m, const int n, const int band);
+
+#endif // end BANDED_H_
@@ -0,0 +1,447 @@
+/*
+ * @author     Stefano Ribes
+ *
+ * @brief      Alignment benchmarks.
+ *
+ * @details    To compile this C program, type:
+ *
+ *             make bench_alignment.exe
+ *
+ *             To run the program, type:
+ *
+ *             ./bench_alignment.exe [--length L] [--max-threads N]
+ *
+ *             The program aligns two random sequences of length L and reports
+ *             the time of the wavefront fill from 1 to N threads (powers of
+ *             two), checking that every run is bit-identical to the serial
+ *             fill. It then compares the cost per cell of the affine gap
+ *             (Gotoh) engine against the serial linear gap fill, and the
+ *             cost per cell of each substitution matrix on protein sequences.
+ *             Finally, it scores panels of queries sharing a prefix of
+ *             growing length against a target of length L, with the query
+ *             trie and one query at a time. Last, it writes random alignments
+ *             to /dev/null, as rows printed a character at a time and as
+ *             CIGAR records, with fprintf() and with the output buffer.
+ */
+#include "align_output.h"
+#include "alignment.h"
+#include "gotoh.h"
+#include "query_trie.h"
+#include "wavefront.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#define DEFAULT_LENGTH 5000
+#define TRIE_QUERIES 1000 // Queries of a synthetic panel
+#define TRIE_QUERY_LENGTH 40
+#define TRIE_PREFIXES 10 // Distinct shared prefixes of a panel
+#define OUTPUT_RECORDS 100000 // Alignments written by the output benchmark
+#define OUTPUT_LENGTH 150 // Length of the aligned sequences
+#define USAGE "ERROR. Usage: %s [--length L] [--max-threads N]\n"
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static char* random_sequence(const int length, const char* alphabet) {
+  const int kAlphabetSize = strlen(alphabet);
+  char* s = malloc(length + 1);
+  for (int i = 0; i < length; ++i) {
+    s[i] = alphabet[rand() % kAlphabetSize];
+  }
+  s[length] = 0;
+  return s;
+}
+
+/**
+ * @brief      Benchmarks the wavefront fill of the global alignment matrices.
+ *
+ * @param[in]  length       The length of the sequences
+ * @param[in]  max_threads  The maximum number of threads
+ *
+ * @return     Zero if all the runs are bit-identical to the serial one.
+ */
+static int bench_wavefront(const int length, const int max_threads) {
+  const int m = length;
+  const int n = length;
+  char* X = random_sequence(m, "ACGT");
+  char* Y = random_sequence(n, "ACGT");
+  trace_store_t trace_ref, trace;
+  if (trace_store_init(&trace_ref, m, n) || trace_store_init(&trace, m, n)) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d matrices\n", m, n);
+    exit(1);
+  }
+  const size_t kTraceBytes = trace_store_bytes(m, n);
+  double start = now();
+  const int kScoreRef = wavefront_fill_global(X, Y, m, n, MATRIX_IDENTITY,
+    NULL, &trace_ref, WAVEFRONT_TILE, 1);
+  const double kSerial = now() - start;
+  printf("[INFO] Wavefront fill, %dx%d cells, %d-cell tiles, %.1f MB packed "
+    "traceback\n", m, n, WAVEFRONT_TILE, kTraceBytes / (1024.0 * 1024.0));
+  printf("threads\ttime[s]\tGCUPS\tspeedup\tidentical\n");
+  printf("serial\t%.4f\t%.3f\t%.2f\t-\n", kSerial,
+    (double)m * n / kSerial * 1e-9, 1.0);
+  int all_identical = 1;
+  for (int t = 1; t <= max_threads; t *= 2) {
+    start = now();
+    const int kScore = wavefront_fill_global(X, Y, m, n, MATRIX_IDENTITY,
+      NULL, &trace, WAVEFRONT_TILE, t);
+    const double kTime = now() - start;
+    const int kIdentical = kScore == kScoreRef &&
+      memcmp(trace.cells, trace_ref.cells, kTraceBytes) == 0;
+    all_identical &= kIdentical;
+    printf("%d\t%.4f\t%.3f\t%.2f\t%s\n", t, kTime,
+      (double)m * n / kTime * 1e-9, kSerial / kTime, kIdentical ? "yes" : "NO");
+    // Poison the inner cells, so that the next run cannot reuse them.
+    for (int i = 1; i <= m; ++i) {
+      memset(trace_store_row(&trace, i) + 1, 0xff, (n + 1) / 2);
+    }
+    if (t < max_threads && t * 2 > max_threads) {
+      t = max_threads / 2; // Always include max_threads
+    }
+  }
+  free(X);
+  free(Y);
+  trace_store_free(&trace_ref);
+  trace_store_free(&trace);
+  return all_identical ? 0 : 1;
+}
+
+/**
+ * @brief      Benchmarks the affine gap engine against the linear gap fill,
+ *             with the same (linear) gap costs, so that the scores must match.
+ *
+ * @param[in]  length  The length of the sequences
+ *
+ * @return     Zero if the affine and linear scores match.
+ */
+static int bench_gotoh(const int length) {
+  const int m = length;
+  const int n = length;
+  char* X = random_sequence(m, "ACGT");
+  char* Y = random_sequence(n, "ACGT");
+  trace_store_t trace;
+  char* alignX = malloc(sizeof(char) * (m + n));
+  char* alignY = malloc(sizeof(char) * (m + n));
+  if (trace_store_init(&trace, m, n) || !alignX || !alignY) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d matrices\n", m, n);
+    exit(1);
+  }
+  const gap_cost_t kLinear = {0, GAP_PENALTY};
+  const double kCells = (double)m * n;
+  double start = now();
+  const int kLinearScore = wavefront_fill_global(X, Y, m, n, MATRIX_IDENTITY,
+    NULL, &trace, WAVEFRONT_TILE, 1);
+  const double kLinearTime = now() - start;
+  start = now();
+  const gotoh_result_t kScoreOnly = gotoh_align(X, m, Y, n, MATRIX_IDENTITY,
+    kLinear, false, NULL, NULL);
+  const double kScoreOnlyTime = now() - start;
+  start = now();
+  const gotoh_result_t kTraced = gotoh_align(X, m, Y, n, MATRIX_IDENTITY,
+    kLinear, false, alignX, alignY);
+  const double kTracedTime = now() - start;
+  const int kMatch = kScoreOnly.score == kLinearScore &&
+    kTraced.score == kLinearScore;
+  printf("\n[INFO] Affine gap engine, %dx%d cells, serial\n", m, n);
+  printf("fill\t\ttime[s]\tGCUPS\tns/cell\tscore\n");
+  printf("linear\t\t%.4f\t%.3f\t%.2f\t%d\n", kLinearTime,
+    kCells / kLinearTime * 1e-9, kLinearTime / kCells * 1e9, kLinearScore);
+  printf("affine\t\t%.4f\t%.3f\t%.2f\t%d\n", kScoreOnlyTime,
+    kCells / kScoreOnlyTime * 1e-9, kScoreOnlyTime / kCells * 1e9,
+    kScoreOnly.score);
+  printf("affine+trace\t%.4f\t%.3f\t%.2f\t%d\n", kTracedTime,
+    kCells / kTracedTime * 1e-9, kTracedTime / kCells * 1e9, kTraced.score);
+  free(X);
+  free(Y);
+  trace_store_free(&trace);
+  free(alignX);
+  free(alignY);
+  return kMatch ? 0 : 1;
+}
+
+/**
+ * @brief      Benchmarks the specialised kernels of each substitution matrix
+ *             on random protein sequences.
+ *
+ * @param[in]  length  The length of the sequences
+ */
+static void bench_matrices(const int length) {
+  const int m = length;
+  const int n = length;
+  char* X = random_sequence(m, "ARNDCQEGHILKMFPSTWYV");
+  char* Y = random_sequence(n, "ARNDCQEGHILKMFPSTWYV");
+  const gap_cost_t kGap = {10, 1};
+  const double kCells = (double)m * n;
+  printf("\n[INFO] Substitution matrices, %dx%d cells, affine gaps (open %d, "
+    "extend %d), serial\n", m, n, kGap.open, kGap.extend);
+  printf("matrix\t\ttime[s]\tGCUPS\tns/cell\tscore\n");
+  for (int k = 0; k < NUM_MATRICES; ++k) {
+    const double kStart = now();
+    const gotoh_result_t kResult = gotoh_align(X, m, Y, n, (matrix_t)k, kGap,
+      true, NULL, NULL);
+    const double kTime = now() - kStart;
+    printf("%-8s\t%.4f\t%.3f\t%.2f\t%d\n", matrix_name((matrix_t)k), kTime,
+      kCells / kTime * 1e-9, kTime / kCells * 1e9, kResult.score);
+  }
+  free(X);
+  free(Y);
+}
+
+/**
+ * @brief      Benchmarks the query trie on synthetic panels, whose queries
+ *             start with one of TRIE_PREFIXES prefixes, from none to 90% of
+ *             the query length, against scoring each query on its own.
+ *
+ * @param[in]  length  The length of the target
+ *
+ * @return     Zero if the scores of the trie match the ones of the queries
+ *             scored one at a time.
+ */
+static int bench_trie(const int length) {
+  static const int kSharedPercents[] = {0, 25, 50, 75, 90};
+  const int kNumPanels = sizeof(kSharedPercents) / sizeof(kSharedPercents[0]);
+  char* Y = random_sequence(length, "ACGT");
+  char* queries[TRIE_QUERIES];
+  int lengths[TRIE_QUERIES];
+  int* scores_ref = malloc(sizeof(int) * TRIE_QUERIES);
+  int* scores = malloc(sizeof(int) * TRIE_QUERIES);
+  printf("\n[INFO] Query trie, %d queries of length %d, %d shared prefixes, "
+    "target of length %d, global mode, serial\n", TRIE_QUERIES,
+    TRIE_QUERY_LENGTH, TRIE_PREFIXES, length);
+  printf("shared\trows\treuse\tqueries[s]\ttrie[s]\tspeedup\tidentical\n");
+  int all_identical = 1;
+  for (int p = 0; p < kNumPanels; ++p) {
+    const int kShared = TRIE_QUERY_LENGTH * kSharedPercents[p] / 100;
+    char* prefixes[TRIE_PREFIXES];
+    for (int k = 0; k < TRIE_PREFIXES; ++k) {
+      prefixes[k] = random_sequence(kShared, "ACGT");
+    }
+    for (int q = 0; q < TRIE_QUERIES; ++q) {
+      char* suffix = random_sequence(TRIE_QUERY_LENGTH - kShared, "ACGT");
+      queries[q] = malloc(TRIE_QUERY_LENGTH + 1);
+      memcpy(queries[q], prefixes[q % TRIE_PREFIXES], kShared);
+      memcpy(queries[q] + kShared, suffix, TRIE_QUERY_LENGTH - kShared + 1);
+      lengths[q] = TRIE_QUERY_LENGTH;
+      free(suffix);
+    }
+    double start = now();
+    for (int q = 0; q < TRIE_QUERIES; ++q) {
+      query_trie_t single;
+      trie_build(&single, (const char* const*)&queries[q], &lengths[q], 1);
+      trie_align(&single, Y, length, MATRIX_IDENTITY, MODE_GLOBAL,
+        &scores_ref[q]);
+      trie_free(&single);
+    }
+    const double kQueriesTime = now() - start;
+    start = now();
+    query_trie_t trie;
+    trie_build(&trie, (const char* const*)queries, lengths, TRIE_QUERIES);
+    trie_align(&trie, Y, length, MATRIX_IDENTITY, MODE_GLOBAL, scores);
+    const double kTrieTime = now() - start;
+    const int kIdentical = memcmp(scores, scores_ref,
+      sizeof(int) * TRIE_QUERIES) == 0;
+    all_identical &= kIdentical;
+    printf("%d%%\t%d\t%.2fx\t%.4f\t\t%.4f\t%.2f\t%s\n", kSharedPercents[p],
+      trie.num_nodes - 1,
+      (double)TRIE_QUERIES * TRIE_QUERY_LENGTH / (trie.num_nodes - 1),
+      kQueriesTime, kTrieTime, kQueriesTime / kTrieTime,
+      kIdentical ? "yes" : "NO");
+    trie_free(&trie);
+    for (int k = 0; k < TRIE_PREFIXES; ++k) {
+      free(prefixes[k]);
+    }
+    for (int q = 0; q < TRIE_QUERIES; ++q) {
+      free(queries[q]);
+    }
+  }
+  free(Y);
+  free(scores_ref);
+  free(scores);
+  return all_identical ? 0 : 1;
+}
+
+/**
+ * @brief      Prints the rows of an alignment a character at a time, as
+ *             print_alignment() used to.
+ */
+static void print_rows(FILE* stream, const int length, const char* alignX,
+    const char* alignY) {
+  fprintf(stream, "* Alignment Sequence:\n");
+  for (int k = length - 1; k >= 0; --k) {
+    fprintf(stream, "%c", alignX[k]);
+  }
+  fprintf(stream, "\n");
+  for (int k = length - 1; k >= 0; --k) {
+    fprintf(stream, "%c", alignX[k] == alignY[k] ? '|' : ' ');
+  }
+  fprintf(stream, "\n");
+  for (int k = length - 1; k >= 0; --k) {
+    fprintf(stream, "%c", alignY[k]);
+  }
+  fprintf(stream, "\n");
+}
+
+/**
+ * @brief      Prints the record of out_alignment() with fprintf().
+ */
+static void print_record(FILE* stream, const int score, const int length,
+    const char* alignX, const char* alignY) {
+  int num_identical = 0;
+  int m = 0;
+  int n = 0;
+  for (int k = 0; k < length; ++k) {
+    num_identical += alignX[k] == alignY[k];
+    m += alignX[k] != '-';
+    n += alignY[k] != '-';
+  }
+  fprintf(stream, "X\t0\t%d\tY\t0\t%d\t%d\t%.2f\t", m, n, score,
+    (double)((num_identical * 10000L + length / 2) / length) / 100);
+  char op = 0;
+  int run = 0;
+  for (int k = length - 1; k >= 0; --k) {
+    const char kOp = alignX[k] == '-' ? 'D' : alignY[k] == '-' ? 'I' : 'M';
+    if (kOp != op && run > 0) {
+      fprintf(stream, "%d%c", run, op);
+      run = 0;
+    }
+    op = kOp;
+    ++run;
+  }
+  fprintf(stream, "%d%c\n", run, op);
+}
+
+/**
+ * @brief      Benchmarks the output of OUTPUT_RECORDS random alignments of
+ *             OUTPUT_LENGTH columns, with 5% of gaps, written to /dev/null.
+ *
+ * @return     Zero if the buffered records match the fprintf() ones.
+ */
+static int bench_output(void) {
+  const size_t kColumns = (size_t)OUTPUT_RECORDS * OUTPUT_LENGTH;
+  char* alignX = random_sequence(kColumns, "ACGT");
+  char* alignY = random_sequence(kColumns, "ACGT");
+  int* scores = malloc(sizeof(int) * OUTPUT_RECORDS);
+  int* m = malloc(sizeof(int) * OUTPUT_RECORDS);
+  int* n = malloc(sizeof(int) * OUTPUT_RECORDS);
+  for (size_t k = 0; k < kColumns; ++k) {
+    const int kDraw = rand() % 100;
+    if (kDraw < 60) {
+      alignY[k] = alignX[k]; // Mostly similar sequences
+    } else if (kDraw < 63) {
+      alignX[k] = '-';
+    } else if (kDraw < 65) {
+      alignY[k] = '-';
+    }
+  }
+  for (int r = 0; r < OUTPUT_RECORDS; ++r) {
+    const char* kX = alignX + (size_t)r * OUTPUT_LENGTH;
+    const char* kY = alignY + (size_t)r * OUTPUT_LENGTH;
+    scores[r] = m[r] = n[r] = 0;
+    for (int k = 0; k < OUTPUT_LENGTH; ++k) {
+      scores[r] += kX[k] == '-' || kY[k] == '-' ? -GAP_PENALTY :
+        kX[k] == kY[k] ? MATCH_SCORE : MISMATCH_SCORE;
+      m[r] += kX[k] != '-';
+      n[r] += kY[k] != '-';
+    }
+  }
+  /*
+   * Check the buffered records against the fprintf() ones.
+   */
+  char* expected = NULL;
+  size_t expected_length = 0;
+  FILE* stream = open_memstream(&expected, &expected_length);
+  out_buffer_t out;
+  out_init(&out, stream, OUT_BUFFER_BYTES);
+  for (int r = 0; r < OUTPUT_RECORDS; ++r) {
+    print_record(stream, scores[r], OUTPUT_LENGTH,
+      alignX + (size_t)r * OUTPUT_LENGTH, alignY + (size_t)r * OUTPUT_LENGTH);
+  }
+  fflush(stream);
+  const size_t kExpectedLength = expected_length;
+  for (int r = 0; r < OUTPUT_RECORDS; ++r) {
+    out_alignment(&out, "X", 0, m[r], "Y", 0, n[r], scores[r], OUTPUT_LENGTH,
+      alignX + (size_t)r * OUTPUT_LENGTH, alignY + (size_t)r * OUTPUT_LENGTH);
+  }
+  out_free(&out);
+  fclose(stream);
+  const int kIdentical = expected_length == 2 * kExpectedLength &&
+    memcmp(expected, expected + kExpectedLength, kExpectedLength) == 0;
+  FILE* null = fopen("/dev/null", "w");
+  if (null == NULL) {
+    fprintf(stderr, "ERROR. Unable to open /dev/null\n");
+    exit(1);
+  }
+  printf("\n[INFO] Alignment output, %d alignments of %d columns, to "
+    "/dev/null\n", OUTPUT_RECORDS, OUTPUT_LENGTH);
+  printf("output\t\t\ttime[s]\trecords/s\tMB/s\n");
+  double start = now();
+  for (int r = 0; r < OUTPUT_RECORDS; ++r) {
+    print_rows(null, OUTPUT_LENGTH, alignX + (size_t)r * OUTPUT_LENGTH,
+      alignY + (size_t)r * OUTPUT_LENGTH);
+  }
+  fflush(null);
+  double seconds = now() - start;
+  const double kRowBytes = (double)OUTPUT_RECORDS * (22 + 3 * (OUTPUT_LENGTH +
+    1));
+  printf("rows, fprintf\t\t%.4f\t%.0f\t%.1f\n", seconds,
+    OUTPUT_RECORDS / seconds, kRowBytes / seconds * 1e-6);
+  start = now();
+  for (int r = 0; r < OUTPUT_RECORDS; ++r) {
+    print_record(null, scores[r], OUTPUT_LENGTH,
+      alignX + (size_t)r * OUTPUT_LENGTH, alignY + (size_t)r * OUTPUT_LENGTH);
+  }
+  fflush(null);
+  seconds = now() - start;
+  printf("records, fprintf\t%.4f\t%.0f\t%.1f\n", seconds,
+    OUTPUT_RECORDS / seconds, kExpectedLength / seconds * 1e-6);
+  out_init(&out, null, OUT_BUFFER_BYTES);
+  start = now();
+  for (int r = 0; r < OUTPUT_RECORDS; ++r) {
+    out_alignment(&out, "X", 0, m[r], "Y", 0, n[r], scores[r], OUTPUT_LENGTH,
+      alignX + (size_t)r * OUTPUT_LENGTH, alignY + (size_t)r * OUTPUT_LENGTH);
+  }
+  out_flush(&out);
+  seconds = now() - start;
+  printf("records, buffer\t\t%.4f\t%.0f\t%.1f\n", seconds,
+    OUTPUT_RECORDS / seconds, kExpectedLength / seconds * 1e-6);
+  out_free(&out);
+  fclose(null);
+  printf("[INFO] Buffered records identical to fprintf: %s\n",
+    kIdentical ? "yes" : "NO");
+  free(expected);
+  free(alignX);
+  free(alignY);
+  free(scores);
+  free(m);
+  free(n);
+  return kIdentical ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  int length = DEFAULT_LENGTH;
+  int max_threads = omp_get_max_threads();
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--length") == 0 && arg + 1 < argc) {
+      length = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--max-threads") == 0 && arg + 1 < argc) {
+      max_threads = atoi(argv[++arg]);
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  srand(42);
+  const int kWavefrontFailed = bench_wavefront(length, max_threads);
+  const int kGotohFailed = bench_gotoh(length);
+  bench_matrices(length);
+  const int kTrieFailed = bench_trie(length);
+  const int kOutputFailed = bench_output();
+  return kWavefrontFailed || kGotohFailed || kTrieFailed || kOutputFailed;
+}
@@ -0,0 +1,54 @@
+/*
+ * File:  cpu_dispatch.c
+ * Author: Stefano Ribes
+ */
+#include "cpu_dispatch.h"
+
+#include <string.h>
+
+static const char* const kIsaNames[NUM_ISAS] = {
+  "scalar",
+  "sse4.1",
+  "avx2",
+  "avx512bw"
+};
+
+static int selected_isa = -1; // Not selected yet
+
+isa_t cpu_detect_isa(void) {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512bw")) {
+    return ISA_AVX512BW;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return ISA_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return ISA_SSE41;
+  }
+  return ISA_SCALAR;
+}
+
+isa_t cpu_isa(void) {
+  if (selected_isa < 0) {
+    selected_isa = cpu_detect_isa();
+  }
+  return (isa_t)selected_isa;
+}
+
+int cpu_select_isa(const char* name) {
+  for (int k = 0; k < NUM_ISAS; ++k) {
+    if (strcmp(name, kIsaNames[k]) == 0) {
+      if (k > (int)cpu_detect_isa()) {
+        return 1;
+      }
+      selected_isa = k;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+const char* isa_name(const isa_t isa) {
+  return kIsaNames[isa];
+}
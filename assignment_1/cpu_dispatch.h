@@ -0,0 +1,56 @@
+/*
+ * File:  cpu_dispatch.h
+ * Author: Stefano Ribes
+ */
+#ifndef CPU_DISPATCH_H_
+#define CPU_DISPATCH_H_
+
+/*
+ * @brief      Instruction sets of the SIMD kernels, from the least to the most
+ *             capable one.
+ */
+typedef enum {
+  ISA_SCALAR,
+  ISA_SSE41,
+  ISA_AVX2,
+  ISA_AVX512BW,
+  NUM_ISAS
+} isa_t;
+
+/**
+ * @brief      Gets the most capable instruction set of the processor, from
+ *             cpuid.
+ *
+ * @return     The instruction set.
+ */
+isa_t cpu_detect_isa(void);
+
+/**
+ * @brief      Gets the instruction set of the kernels: the one selected with
+ *             cpu_select_isa(), otherwise the detected one.
+ *
+ * @return     The instruction set.
+ */
+isa_t cpu_isa(void);
+
+/**
+ * @brief      Overrides the instruction set of the kernels, e.g. to compare
+ *             them: scalar, sse4.1, avx2 or avx512bw.
+ *
+ * @param[in]  name  The instruction set name
+ *
+ * @return     Zero on success, non-zero if the name is unknown or the
+ *             processor does not support it.
+ */
+int cpu_select_isa(const char* name);
+
+/**
+ * @brief      Gets the name of an instruction set.
+ *
+ * @param[in]  isa   The instruction set
+ *
+ * @return     The name.
+ */
+const char* isa_name(const isa_t isa);
+
+#endif // end CPU_DISPATCH_H_
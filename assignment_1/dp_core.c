@@ -0,0 +1,235 @@
+/*
+ * File:  dp_core.c
+ * Author: Stefano Ribes
+ *
+ * A mode is a set of compile-time flags: whether the prefix of X (column 0)
+ * or of Y (row 0) can be skipped for free, whether the scores are clamped at
+ * zero, and whether the alignment may end anywhere in the last row or in the
+ * last column. A free boundary cell is zero and stops the traceback.
+ */
+#include "dp_core.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const kModeNames[NUM_MODES] = {
+  "global",
+  "local",
+  "semi-global",
+  "overlap",
+  "glocal"
+};
+
+/*
+ * @brief      Encoded sequences and matrices of an alignment.
+ */
+typedef struct {
+  const uint8_t* X;
+  const uint8_t* Y;
+  int m;
+  int n;
+  matrix_t matrix;
+  uint8_t* trace;
+  int* row; // Scores of the previous row
+  int* next; // Scores of the current row
+} dp_t;
+
+int parse_mode(const char* name, align_mode_t* mode) {
+  for (int k = 0; k < NUM_MODES; ++k) {
+    if (strcmp(name, kModeNames[k]) == 0) {
+      *mode = (align_mode_t)k;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+const char* mode_name(const align_mode_t mode) {
+  return kModeNames[mode];
+}
+
+size_t dp_trace_bytes(const int m, const int n) {
+  return sizeof(uint8_t) * cell_idx(m + 1, 0, n);
+}
+
+/*
+ * @brief      Cell of the matrix and its score, a candidate end cell.
+ */
+typedef struct {
+  int score;
+  int i;
+  int j;
+} end_cell_t;
+
+static ALWAYS_INLINE void keep_best(end_cell_t* best, const int score,
+    const int i, const int j) {
+  if (score > best->score) {
+    best->score = score;
+    best->i = i;
+    best->j = j;
+  }
+}
+
+/**
+ * @brief      Fills the trace and finds the end cell. All the parameters but
+ *             the matrices are compile-time constants at the call sites.
+ */
+static ALWAYS_INLINE end_cell_t fill(const dp_t* dp, const bool free_x,
+    const bool free_y, const bool clamp, const bool end_row,
+    const bool end_col, const matrix_t matrix) {
+  const int m = dp->m;
+  const int n = dp->n;
+  int* restrict row = dp->row;
+  int* restrict next = dp->next;
+  for (int j = 0; j <= n; ++j) {
+    row[j] = free_y || clamp ? 0 : -GAP_PENALTY * j;
+    dp->trace[j] = free_y || clamp || j == 0 ? STOP : LEFT;
+  }
+  end_cell_t best = {row[n], 0, n};
+  int first_score = 0; // Score of column 0 of the last row filled
+  if (clamp) {
+    best.score = 0;
+    best.j = 0;
+  }
+  for (int i = 1; i <= m; ++i) {
+    const uint8_t x = dp->X[i-1];
+    uint8_t* restrict trace_row = dp->trace + cell_idx(i, 0, n);
+    next[0] = free_x || clamp ? 0 : -GAP_PENALTY * i;
+    first_score = next[0];
+    trace_row[0] = free_x || clamp ? STOP : UP;
+    for (int j = 1; j <= n; ++j) {
+      const int diag = row[j-1] + substitution_score(matrix, x, dp->Y[j-1]);
+      const int up = row[j] - GAP_PENALTY;
+      const int left = next[j-1] - GAP_PENALTY;
+      int score = up > diag ? up : diag;
+      int dir = up > diag ? UP : DIAG;
+      dir = left > score ? LEFT : dir;
+      score = left > score ? left : score;
+      if (clamp) {
+        dir = score > 0 ? dir : STOP;
+        score = score > 0 ? score : 0;
+      }
+      next[j] = score;
+      trace_row[j] = dir;
+    }
+    if (clamp) {
+      for (int j = 1; j <= n; ++j) {
+        keep_best(&best, next[j], i, j);
+      }
+    } else if (end_col) {
+      keep_best(&best, next[n], i, n);
+    }
+    int* tmp = row;
+    row = next;
+    next = tmp;
+  }
+  if (clamp) {
+    return best;
+  }
+  if (end_row) {
+    // The last row is scanned first, so that it wins the ties.
+    end_cell_t last = {first_score, m, 0};
+    for (int j = 1; j <= n; ++j) {
+      keep_best(&last, row[j], m, j);
+    }
+    if (end_col) {
+      keep_best(&last, best.score, best.i, best.j);
+    }
+    return last;
+  }
+  if (end_col) {
+    return best;
+  }
+  const end_cell_t kCorner = {row[n], m, n};
+  return kCorner;
+}
+
+static ALWAYS_INLINE end_cell_t fill_mode(const dp_t* dp, const bool free_x,
+    const bool free_y, const bool clamp, const bool end_row,
+    const bool end_col) {
+  switch (dp->matrix) {
+    case MATRIX_DNA:
+      return fill(dp, free_x, free_y, clamp, end_row, end_col, MATRIX_DNA);
+    case MATRIX_BLOSUM62:
+      return fill(dp, free_x, free_y, clamp, end_row, end_col,
+        MATRIX_BLOSUM62);
+    case MATRIX_PAM250:
+      return fill(dp, free_x, free_y, clamp, end_row, end_col, MATRIX_PAM250);
+    default:
+      return fill(dp, free_x, free_y, clamp, end_row, end_col,
+        MATRIX_IDENTITY);
+  }
+}
+
+dp_result_t dp_align(const char* X, const int m, const char* Y, const int n,
+    const matrix_t matrix, const align_mode_t mode, char* alignX,
+    char* alignY) {
+  dp_t dp;
+  dp.X = encode_sequence(matrix, X, m);
+  dp.Y = encode_sequence(matrix, Y, n);
+  dp.m = m;
+  dp.n = n;
+  dp.matrix = matrix;
+  dp.trace = malloc(dp_trace_bytes(m, n));
+  dp.row = malloc(sizeof(int) * (n + 1));
+  dp.next = malloc(sizeof(int) * (n + 1));
+  if (dp.trace == NULL || dp.row == NULL || dp.next == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d trace matrix\n", m,
+      n);
+    exit(1);
+  }
+  end_cell_t end;
+  switch (mode) {
+    case MODE_LOCAL:
+      end = fill_mode(&dp, true, true, true, false, false);
+      break;
+    case MODE_SEMI_GLOBAL:
+      end = fill_mode(&dp, true, true, false, true, true);
+      break;
+    case MODE_OVERLAP:
+      end = fill_mode(&dp, true, false, false, true, false);
+      break;
+    case MODE_GLOCAL:
+      end = fill_mode(&dp, false, true, false, true, false);
+      break;
+    default:
+      end = fill_mode(&dp, false, false, false, false, false);
+  }
+  /*
+   * Traceback from the end cell to the first STOP
+   */
+  dp_result_t result = {end.score, end.i, end.j, end.i, end.j, 0};
+  int i = end.i;
+  int j = end.j;
+  while (dp.trace[cell_idx(i, j, n)] != STOP) {
+    switch (dp.trace[cell_idx(i, j, n)]) {
+      case DIAG:
+        alignX[result.length] = X[i-1];
+        alignY[result.length] = Y[j-1];
+        --i;
+        --j;
+        break;
+      case UP:
+        alignX[result.length] = X[i-1];
+        alignY[result.length] = '-';
+        --i;
+        break;
+      default:
+        alignX[result.length] = '-';
+        alignY[result.length] = Y[j-1];
+        --j;
+    }
+    ++result.length;
+  }
+  result.start_i = i;
+  result.start_j = j;
+  free((uint8_t*)dp.X);
+  free((uint8_t*)dp.Y);
+  free(dp.trace);
+  free(dp.row);
+  free(dp.next);
+  return result;
+}
@@ -0,0 +1,103 @@
+/*
+ * File:  dp_core.h
+ * Author: Stefano Ribes
+ */
+#ifndef DP_CORE_H_
+#define DP_CORE_H_
+
+#include "alignment.h"
+#include "scoring.h"
+
+#include <stddef.h>
+
+/*
+ * @brief      Boundary policies of the alignment DP with linear gaps. They
+ *             only differ in which end gaps are free, whether the scores are
+ *             clamped at zero and where the traceback starts:
+ *
+ *             - global: X and Y aligned end to end;
+ *             - local: best-scoring pair of substrings;
+ *             - semi-global: all end gaps free, so the alignment runs from
+ *               the top or left boundary to the bottom or right one;
+ *             - overlap: a suffix of X aligned with a prefix of Y, as for
+ *               the dovetail of two reads in assembly;
+ *             - glocal: X aligned end to end with a substring of Y, as for
+ *               a read mapped onto a reference.
+ */
+typedef enum {
+  MODE_GLOBAL,
+  MODE_LOCAL,
+  MODE_SEMI_GLOBAL,
+  MODE_OVERLAP,
+  MODE_GLOCAL,
+  NUM_MODES
+} align_mode_t;
+
+/*
+ * @brief      Alignment found by dp_align(): it covers X[start_i .. end_i-1]
+ *             and Y[start_j .. end_j-1].
+ */
+typedef struct {
+  int score;
+  int start_i;
+  int start_j;
+  int end_i;
+  int end_j;
+  int length;
+} dp_result_t;
+
+/**
+ * @brief      Gets an alignment mode from its name: global, local,
+ *             semi-global, overlap or glocal.
+ *
+ * @param[in]  name  The mode name
+ * @param      mode  The mode
+ *
+ * @return     Zero on success, non-zero if the name is unknown.
+ */
+int parse_mode(const char* name, align_mode_t* mode);
+
+/**
+ * @brief      Gets the name of an alignment mode.
+ *
+ * @param[in]  mode  The mode
+ *
+ * @return     The mode name.
+ */
+const char* mode_name(const align_mode_t mode);
+
+/**
+ * @brief      Gets the size of the trace matrix of dp_align().
+ *
+ * @param[in]  m     The length of the X sequence
+ * @param[in]  n     The length of the Y sequence
+ *
+ * @return     The size in bytes.
+ */
+size_t dp_trace_bytes(const int m, const int n);
+
+/**
+ * @brief      Aligns two sequences with a boundary policy. All the modes
+ *             share one inner loop, specialised at compile time on the
+ *             matrix and on the clamping at zero; the boundaries and the
+ *             search of the end cell are specialised on the mode. The scores
+ *             are kept in two rows, the trace in a (m+1)x(n+1) byte matrix.
+ *             The ties are broken as in the other kernels: DIAG, UP, then
+ *             LEFT.
+ *
+ * @param[in]  X       The X input sequence
+ * @param[in]  m       The length of the X sequence
+ * @param[in]  Y       The Y input sequence
+ * @param[in]  n       The length of the Y sequence
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  mode    The alignment mode
+ * @param      alignX  The aligned X, backwards, of at least m + n symbols
+ * @param      alignY  The aligned Y, backwards, of at least m + n symbols
+ *
+ * @return     The alignment.
+ */
+dp_result_t dp_align(const char* X, const int m, const char* Y, const int n,
+    const matrix_t matrix, const align_mode_t mode, char* alignX,
+    char* alignY);
+
+#endif // end DP_CORE_H_
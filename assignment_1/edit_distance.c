@@ -0,0 +1,195 @@
+/*
+ * @author     Stefano Ribes
+ *
+ * @brief      Edit distance of many pairs of sequences.
+ *
+ * @details    To compile this C program, type:
+ *
+ *             make edit_distance.exe
+ *
+ *             To run the program, type:
+ *
+ *             ./edit_distance.exe [--max-dist K] [--threads N]
+ *               [--engine myers|four-russians] [--fr-table FILE] [pairs.txt]
+ *
+ *             Each line of the input file (or of the standard input) holds two
+ *             sequences separated by blanks. For each pair, the program prints
+ *             the edit distance, or -1 if it exceeds K. The pairs are read and
+ *             processed in chunks, each one in parallel.
+ *
+ *             The distances are computed with Myers' bit-parallel algorithm.
+ *             With --engine four-russians, the block tables of the
+ *             Four-Russians engine are mapped from FILE (by default
+ *             FR_TABLE_NAME in $TMPDIR or /tmp, written on first use), and
+ *             the long DNA pairs are given to it, see levenshtein_distance().
+ */
+#include "four_russians.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#define CHUNK_PAIRS 65536 // Pairs read and processed at once
+
+#define USAGE "ERROR. Usage: %s [--max-dist K] [--threads N] " \
+  "[--engine myers|four-russians] [--fr-table FILE] [pairs.txt]\n"
+
+/*
+ * @brief      A pair of sequences, pointing into the input line.
+ */
+typedef struct {
+  const char* X;
+  int m;
+  const char* Y;
+  int n;
+} pair_t;
+
+/**
+ * @brief      Gets the next blank-separated token of a line.
+ *
+ * @param      s       The line, advanced past the token
+ * @param      length  The token length
+ *
+ * @return     The token start, NULL if there are no more tokens.
+ */
+static const char* next_token(const char** s, int* length) {
+  const char* p = *s;
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+    ++p;
+  }
+  if (*p == 0) {
+    return NULL;
+  }
+  const char* start = p;
+  while (*p != 0 && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+    ++p;
+  }
+  *length = p - start;
+  *s = p;
+  return start;
+}
+
+/**
+ * @brief      Reads the next chunk of pairs, skipping blank lines.
+ *
+ * @param      fp       The input file
+ * @param      lines    The line buffers, reused across chunks
+ * @param      sizes    The sizes of the line buffers
+ * @param      pairs    The pairs
+ * @param      line_no  The number of lines read so far
+ *
+ * @return     The number of pairs read.
+ */
+static int read_chunk(FILE* fp, char** lines, size_t* sizes, pair_t* pairs,
+    long* line_no) {
+  int num_pairs = 0;
+  while (num_pairs < CHUNK_PAIRS &&
+      getline(&lines[num_pairs], &sizes[num_pairs], fp) != -1) {
+    ++*line_no;
+    const char* s = lines[num_pairs];
+    pair_t* pair = &pairs[num_pairs];
+    pair->X = next_token(&s, &pair->m);
+    if (pair->X == NULL) {
+      continue;
+    }
+    pair->Y = next_token(&s, &pair->n);
+    if (pair->Y == NULL) {
+      fprintf(stderr, "ERROR. Line %ld: expected two sequences\n", *line_no);
+      exit(1);
+    }
+    ++num_pairs;
+  }
+  return num_pairs;
+}
+
+int main(int argc, char** argv) {
+  int max_dist = -1;
+  int num_threads = omp_get_max_threads();
+  const char* filename = NULL;
+  const char* table_file = NULL;
+  bool use_four_russians = false;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--max-dist") == 0 && arg + 1 < argc) {
+      max_dist = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+      num_threads = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--engine") == 0 && arg + 1 < argc) {
+      ++arg;
+      if (strcmp(argv[arg], "four-russians") == 0) {
+        use_four_russians = true;
+      } else if (strcmp(argv[arg], "myers") != 0) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--fr-table") == 0 && arg + 1 < argc) {
+      table_file = argv[++arg];
+    } else if (filename == NULL) {
+      filename = argv[arg];
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  fr_tables_t tables;
+  if (use_four_russians && fr_tables_open(&tables, table_file)) {
+    fprintf(stderr, "ERROR. Unable to build the Four-Russians tables\n");
+    exit(1);
+  }
+  const fr_tables_t* kTables = use_four_russians ? &tables : NULL;
+  FILE* fp = filename ? fopen(filename, "r") : stdin;
+  if (fp == NULL) {
+    fprintf(stderr, "ERROR. Unable to open %s\n", filename);
+    exit(1);
+  }
+  char** lines = calloc(CHUNK_PAIRS, sizeof(char*));
+  size_t* sizes = calloc(CHUNK_PAIRS, sizeof(size_t));
+  pair_t* pairs = malloc(sizeof(pair_t) * CHUNK_PAIRS);
+  int* dists = malloc(sizeof(int) * CHUNK_PAIRS);
+  if (lines == NULL || sizes == NULL || pairs == NULL || dists == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the input buffers\n");
+    exit(1);
+  }
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  long line_no = 0;
+  long total_pairs = 0;
+  double num_cells = 0;
+  int num_pairs;
+  while ((num_pairs = read_chunk(fp, lines, sizes, pairs, &line_no)) > 0) {
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 256) \
+        reduction(+: num_cells)
+    for (int k = 0; k < num_pairs; ++k) {
+      const int kDist = levenshtein_distance(kTables, pairs[k].X, pairs[k].m,
+        pairs[k].Y, pairs[k].n, max_dist);
+      dists[k] = max_dist >= 0 && kDist > max_dist ? -1 : kDist;
+      num_cells += (double)pairs[k].m * (double)pairs[k].n;
+    }
+    for (int k = 0; k < num_pairs; ++k) {
+      printf("%d\n", dists[k]);
+    }
+    total_pairs += num_pairs;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  const double kSeconds = (end.tv_sec - start.tv_sec) +
+    (end.tv_nsec - start.tv_nsec) * 1e-9;
+  fprintf(stderr, "[INFO] %ld pairs in %.6f s: %.1f pairs/s, %.3f GCUPS\n",
+    total_pairs, kSeconds, total_pairs / (kSeconds > 0 ? kSeconds : 1e-9),
+    num_cells / (kSeconds > 0 ? kSeconds : 1e-9) * 1e-9);
+  for (int k = 0; k < CHUNK_PAIRS; ++k) {
+    free(lines[k]);
+  }
+  free(lines);
+  free(sizes);
+  free(pairs);
+  free(dists);
+  if (fp != stdin) {
+    fclose(fp);
+  }
+  if (use_four_russians) {
+    fr_tables_close(&tables);
+  }
+  return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * File:  four_russians.c
+ * Author: Stefano Ribes
+ *
+ * A block is indexed by the codes of its X and Y symbols (2 bits each) and by
+ * the differences along its top row and left column, encoded in base 3 (the
+ * difference d as the digit d + 1, the first cell as the lowest digit). Its
+ * entry holds the base-3 codes of the differences along its bottom row (low 5
+ * bits) and right column (next 5 bits). The X symbols are the most significant
+ * part of the index, so that a row of blocks only reads one slice of the
+ * table.
+ *
+ * The cache file starts with a header, checked when it is mapped, followed by
+ * the table.
+ */
+#include "four_russians.h"
+#include "myers.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FR_DIFFS 27 // Difference codes of a block side, 3^FR_BLOCK
+#define FR_SYMBOLS 64 // Symbol codes of a block side, 4^FR_BLOCK
+#define FR_SLICE (FR_SYMBOLS * FR_DIFFS * FR_DIFFS) // Entries of an X code
+#define FR_ENTRIES ((size_t)FR_SYMBOLS * FR_SLICE)
+#define FR_ALL_PLUS 26 // Code of a side whose differences are all +1
+#define FR_MAGIC "FRTABLE1"
+#define FR_STRIPS 8 // Rows of blocks stepped together
+
+typedef struct {
+  char magic[8];
+  uint32_t block;
+  uint32_t num_symbols;
+  uint64_t num_entries;
+} fr_header_t;
+
+/**
+ * @brief      Gets the differences of a block side from its code.
+ */
+static void decode_diffs(int code, int* diffs) {
+  for (int k = 0; k < FR_BLOCK; ++k) {
+    diffs[k] = code % 3 - 1;
+    code /= 3;
+  }
+}
+
+static void build_table(uint16_t* table) {
+  int D[FR_BLOCK + 1][FR_BLOCK + 1];
+  for (int x_code = 0; x_code < FR_SYMBOLS; ++x_code) {
+    for (int y_code = 0; y_code < FR_SYMBOLS; ++y_code) {
+      int x[FR_BLOCK];
+      int y[FR_BLOCK];
+      for (int k = 0; k < FR_BLOCK; ++k) {
+        x[k] = x_code >> (2 * (FR_BLOCK - 1 - k)) & 3;
+        y[k] = y_code >> (2 * (FR_BLOCK - 1 - k)) & 3;
+      }
+      for (int top = 0; top < FR_DIFFS; ++top) {
+        int top_diffs[FR_BLOCK];
+        decode_diffs(top, top_diffs);
+        D[0][0] = 0;
+        for (int j = 1; j <= FR_BLOCK; ++j) {
+          D[0][j] = D[0][j-1] + top_diffs[j-1];
+        }
+        for (int left = 0; left < FR_DIFFS; ++left) {
+          int left_diffs[FR_BLOCK];
+          decode_diffs(left, left_diffs);
+          for (int i = 1; i <= FR_BLOCK; ++i) {
+            D[i][0] = D[i-1][0] + left_diffs[i-1];
+            for (int j = 1; j <= FR_BLOCK; ++j) {
+              int d = D[i-1][j-1] + (x[i-1] != y[j-1]);
+              d = D[i-1][j] + 1 < d ? D[i-1][j] + 1 : d;
+              d = D[i][j-1] + 1 < d ? D[i][j-1] + 1 : d;
+              D[i][j] = d;
+            }
+          }
+          int bottom = 0;
+          int right = 0;
+          for (int k = FR_BLOCK; k >= 1; --k) {
+            bottom = bottom * 3 + D[FR_BLOCK][k] - D[FR_BLOCK][k-1] + 1;
+            right = right * 3 + D[k][FR_BLOCK] - D[k-1][FR_BLOCK] + 1;
+          }
+          table[(((size_t)x_code * FR_SYMBOLS + y_code) * FR_DIFFS + top) *
+            FR_DIFFS + left] = bottom | right << 5;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief      Maps the cache file if its header matches.
+ *
+ * @return     Zero on success.
+ */
+static int map_tables(fr_tables_t* tables, const char* path,
+    const fr_header_t* expected) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return 1;
+  }
+  const size_t kSize = sizeof(fr_header_t) + sizeof(uint16_t) * FR_ENTRIES;
+  fr_header_t header;
+  struct stat st;
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(&header, expected, sizeof(header)) != 0 || fstat(fd, &st) != 0 ||
+      (size_t)st.st_size != kSize) {
+    close(fd);
+    return 1;
+  }
+  void* data = mmap(NULL, kSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return 1;
+  }
+  tables->mapping = data;
+  tables->size = kSize;
+  tables->table = (const uint16_t*)((const char*)data + sizeof(fr_header_t));
+  return 0;
+}
+
+/**
+ * @brief      Writes the cache file, through a temporary file renamed at the
+ *             end so that a concurrent reader never maps a partial one.
+ *
+ * @return     Zero on success.
+ */
+static int write_tables(const char* path, const fr_header_t* header,
+    const uint16_t* table) {
+  const size_t kTmpLength = strlen(path) + 32;
+  char* tmp = malloc(kTmpLength);
+  if (tmp == NULL) {
+    return 1;
+  }
+  snprintf(tmp, kTmpLength, "%s.%ld", path, (long)getpid());
+  FILE* stream = fopen(tmp, "wb");
+  int error = stream == NULL;
+  if (!error) {
+    error = fwrite(header, sizeof(*header), 1, stream) != 1 ||
+      fwrite(table, sizeof(uint16_t), FR_ENTRIES, stream) != FR_ENTRIES;
+    error |= fclose(stream) != 0;
+    error = error || rename(tmp, path) != 0;
+    if (error) {
+      remove(tmp);
+    }
+  }
+  free(tmp);
+  return error;
+}
+
+int fr_tables_open(fr_tables_t* tables, const char* path) {
+  fr_header_t expected;
+  memset(&expected, 0, sizeof(expected));
+  memcpy(expected.magic, FR_MAGIC, sizeof(expected.magic));
+  expected.block = FR_BLOCK;
+  expected.num_symbols = 4;
+  expected.num_entries = FR_ENTRIES;
+  char default_path[4096];
+  if (path == NULL) {
+    const char* kDir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    snprintf(default_path, sizeof(default_path), "%s/%s", kDir,
+      FR_TABLE_NAME);
+    path = default_path;
+  }
+  if (map_tables(tables, path, &expected) == 0) {
+    return 0;
+  }
+  uint16_t* table = malloc(sizeof(uint16_t) * FR_ENTRIES);
+  if (table == NULL) {
+    return 1;
+  }
+  build_table(table);
+  if (write_tables(path, &expected, table) == 0 &&
+      map_tables(tables, path, &expected) == 0) {
+    free(table);
+    return 0;
+  }
+  // NOTE: The cache cannot be written, e.g. in a read-only directory: the
+  // table built in memory is used instead.
+  tables->table = table;
+  tables->mapping = NULL;
+  tables->size = sizeof(uint16_t) * FR_ENTRIES;
+  return 0;
+}
+
+void fr_tables_close(fr_tables_t* tables) {
+  if (tables->mapping != NULL) {
+    munmap(tables->mapping, tables->size);
+  } else {
+    free((void*)tables->table);
+  }
+  tables->table = NULL;
+  tables->mapping = NULL;
+}
+
+/**
+ * @brief      Encodes a DNA sequence, 2 bits per symbol.
+ *
+ * @return     Zero on success, non-zero if a symbol is not in ACGT.
+ */
+static int encode_dna(const char* X, const int m, uint8_t* codes) {
+  for (int i = 0; i < m; ++i) {
+    switch (X[i]) {
+      case 'A': codes[i] = 0; break;
+      case 'C': codes[i] = 1; break;
+      case 'G': codes[i] = 2; break;
+      case 'T': codes[i] = 3; break;
+      default: return 1;
+    }
+  }
+  return 0;
+}
+
+static inline int block_code(const uint8_t* codes) {
+  return codes[0] << 4 | codes[1] << 2 | codes[2];
+}
+
+/**
+ * @brief      Fills the columns left over by the blocks for the rows of a row
+ *             of blocks, cell by cell.
+ *
+ * @param[in]  x          The X codes of the rows
+ * @param[in]  y          The Y codes of the columns
+ * @param[in]  num_cols   The number of columns
+ * @param[in]  left       The code of the differences along the left column
+ * @param      tail       The scores of the columns and of the one on their
+ *                        left, from the row above to the last row
+ */
+static void fill_tail(const uint8_t* x, const uint8_t* y, const int num_cols,
+    int left, int* tail) {
+  for (int i = 0; i < FR_BLOCK; ++i) {
+    int diag = tail[0];
+    tail[0] += left % 3 - 1;
+    left /= 3;
+    for (int c = 1; c <= num_cols; ++c) {
+      int d = diag + (x[i] != y[c-1]);
+      d = tail[c] + 1 < d ? tail[c] + 1 : d;
+      d = tail[c-1] + 1 < d ? tail[c-1] + 1 : d;
+      diag = tail[c];
+      tail[c] = d;
+    }
+  }
+}
+
+int fr_distance(const fr_tables_t* tables, const char* X, const int m,
+    const char* Y, const int n) {
+  uint8_t* x = malloc(m + 1);
+  uint8_t* y = malloc(n + 1);
+  if (x == NULL || y == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the sequence codes\n");
+    exit(1);
+  }
+  if (encode_dna(X, m, x) || encode_dna(Y, n, y)) {
+    free(x);
+    free(y);
+    return -1;
+  }
+  const int kRowBlocks = m / FR_BLOCK;
+  const int kColBlocks = n / FR_BLOCK;
+  const int kBlockedCols = kColBlocks * FR_BLOCK; // Columns of the blocks
+  const int kTailCols = n - kBlockedCols;
+  uint16_t* y_codes = malloc(sizeof(uint16_t) * (kColBlocks + 1));
+  uint8_t* bottom = malloc(kColBlocks + 1); // Bottom of the row of blocks
+  int* tail = malloc(sizeof(int) * (n + 1)); // Scores of the last columns
+  if (y_codes == NULL || bottom == NULL || tail == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate %d column blocks\n",
+      kColBlocks);
+    exit(1);
+  }
+  for (int b = 0; b < kColBlocks; ++b) {
+    y_codes[b] = block_code(y + b * FR_BLOCK) * FR_DIFFS * FR_DIFFS;
+    bottom[b] = FR_ALL_PLUS; // Row 0 grows by one per column
+  }
+  for (int c = 0; c <= kTailCols; ++c) {
+    tail[c] = kBlockedCols + c;
+  }
+  /*
+   * Rows of blocks, FR_STRIPS at a time along a skewed front: at step s, row
+   * k of the group does block s - k, whose top is the bottom of block s - k of
+   * row k - 1, done at the previous step. The lookups of a step are
+   * independent, so that their latencies overlap.
+   *
+   * The column kBlockedCols is the first one of the tail, which is filled
+   * cell by cell from the differences along the right side of the last block
+   * of each row.
+   */
+  for (int r0 = 0; r0 < kRowBlocks; r0 += FR_STRIPS) {
+    const int kStrips = kRowBlocks - r0 < FR_STRIPS ? kRowBlocks - r0 :
+      FR_STRIPS;
+    const uint16_t* slices[FR_STRIPS];
+    int left[FR_STRIPS];
+    for (int k = 0; k < kStrips; ++k) {
+      slices[k] = tables->table +
+        (size_t)block_code(x + (r0 + k) * FR_BLOCK) * FR_SLICE;
+      left[k] = FR_ALL_PLUS; // Column 0 grows by one per row
+    }
+    for (int step = 0; step < kColBlocks + kStrips - 1; ++step) {
+      // Rows of the group on the front: the ones at its ends wait for their
+      // first block or are done.
+      const int kFirst = step - kColBlocks + 1 > 0 ? step - kColBlocks + 1 : 0;
+      const int kLast = step < kStrips - 1 ? step : kStrips - 1;
+      for (int k = kFirst; k <= kLast; ++k) {
+        const int b = step - k;
+        const int kEntry = slices[k][y_codes[b] + bottom[b] * FR_DIFFS +
+          left[k]];
+        bottom[b] = kEntry & 31;
+        left[k] = kEntry >> 5;
+      }
+    }
+    for (int k = 0; k < kStrips; ++k) {
+      fill_tail(x + (r0 + k) * FR_BLOCK, y + kBlockedCols, kTailCols, left[k],
+        tail);
+    }
+  }
+  /*
+   * Rows left over by the blocks, from the bottom row of the last row of
+   * blocks.
+   */
+  int dist = tail[kTailCols];
+  if (kRowBlocks * FR_BLOCK < m) {
+    int* row = malloc(sizeof(int) * (n + 1));
+    if (row == NULL) {
+      fprintf(stderr, "ERROR. Unable to allocate a row of %d cells\n", n);
+      exit(1);
+    }
+    row[0] = kRowBlocks * FR_BLOCK;
+    for (int b = 0; b < kColBlocks; ++b) {
+      int code = bottom[b];
+      for (int k = 1; k <= FR_BLOCK; ++k) {
+        row[b * FR_BLOCK + k] = row[b * FR_BLOCK + k - 1] + code % 3 - 1;
+        code /= 3;
+      }
+    }
+    for (int c = 1; c <= kTailCols; ++c) {
+      row[kBlockedCols + c] = tail[c];
+    }
+    for (int i = kRowBlocks * FR_BLOCK + 1; i <= m; ++i) {
+      int diag = row[0];
+      row[0] = i;
+      for (int j = 1; j <= n; ++j) {
+        int d = diag + (x[i-1] != y[j-1]);
+        d = row[j] + 1 < d ? row[j] + 1 : d;
+        d = row[j-1] + 1 < d ? row[j-1] + 1 : d;
+        diag = row[j];
+        row[j] = d;
+      }
+    }
+    dist = row[n];
+    free(row);
+  }
+  free(x);
+  free(y);
+  free(y_codes);
+  free(bottom);
+  free(tail);
+  return dist;
+}
+
+int levenshtein_distance(const fr_tables_t* tables, const char* X,
+    const int m, const char* Y, const int n, const int max_dist) {
+  if (tables != NULL && max_dist < 0 && m >= FR_MIN_LENGTH &&
+      n >= FR_MIN_LENGTH) {
+    const int kDist = fr_distance(tables, X, m, Y, n);
+    if (kDist >= 0) {
+      return kDist;
+    }
+  }
+  return myers_distance(X, m, Y, n, max_dist);
+}
@@ -0,0 +1,95 @@
+/*
+ * File:  four_russians.h
+ * Author: Stefano Ribes
+ */
+#ifndef FOUR_RUSSIANS_H_
+#define FOUR_RUSSIANS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FR_BLOCK 3 // Rows and columns of a precomputed block
+#define FR_TABLE_NAME "four_russians_t3.tbl" // Cache file, in $TMPDIR or /tmp
+#define FR_MIN_LENGTH 1024 // Shortest sequences given to the Four-Russians
+
+/*
+ * @brief      Block transition tables of the Four-Russians edit distance over
+ *             the DNA alphabet, mapped from their cache file (or built in
+ *             memory if it cannot be written).
+ */
+typedef struct {
+  const uint16_t* table;
+  void* mapping; // NULL when the table is on the heap
+  size_t size;
+} fr_tables_t;
+
+/**
+ * @brief      Maps the block tables from their cache file, building and
+ *             writing it first if it is missing or stale.
+ *
+ * @param      tables  The tables, to be released with fr_tables_close()
+ * @param[in]  path    The cache file, NULL for FR_TABLE_NAME in $TMPDIR (or
+ *                     /tmp)
+ *
+ * @return     Zero on success, non-zero if the tables cannot be built.
+ */
+int fr_tables_open(fr_tables_t* tables, const char* path);
+
+/**
+ * @brief      Releases the block tables.
+ *
+ * @param      tables  The tables
+ */
+void fr_tables_close(fr_tables_t* tables);
+
+/**
+ * @brief      Edit (Levenshtein) distance of two DNA sequences with the
+ *             Four-Russians method (Masek and Paterson, 1980). The DP matrix
+ *             is split in FR_BLOCK x FR_BLOCK blocks, and a block only depends
+ *             on its symbols and on the differences between adjacent cells
+ *             along its top row and left column, each one -1, 0 or +1. The
+ *             differences along its bottom row and right column are therefore
+ *             looked up in a table of all the blocks, instead of being
+ *             computed: O(mn / FR_BLOCK^2) lookups.
+ *
+ *             The blocks are stepped row of blocks by row of blocks, so that
+ *             the lookups only touch the slice of the table of the X symbols
+ *             of the row, which fits in the L2 cache. The rows and columns
+ *             left over by the blocks are filled cell by cell.
+ *
+ * @param[in]  tables  The block tables
+ * @param[in]  X       The X sequence
+ * @param[in]  m       The length of the X sequence
+ * @param[in]  Y       The Y sequence
+ * @param[in]  n       The length of the Y sequence
+ *
+ * @return     The edit distance, or -1 if a sequence has a symbol other than
+ *             A, C, G and T (upper case, as myers_distance() compares the
+ *             symbols as they are).
+ */
+int fr_distance(const fr_tables_t* tables, const char* X, const int m,
+    const char* Y, const int n);
+
+/**
+ * @brief      Edit distance with the engine suited to a pair: the
+ *             Four-Russians one for DNA pairs whose sequences both have at
+ *             least FR_MIN_LENGTH symbols, when its tables are given and there
+ *             is no distance limit, otherwise myers_distance().
+ *
+ *             NOTE: With 64-bit words, Myers' algorithm computes 64 cells per
+ *             block step against 9 per table lookup, and it is the faster one
+ *             at any length on x86-64: the tables are only opened on request.
+ *
+ * @param[in]  tables    The block tables, NULL to always use Myers' algorithm
+ * @param[in]  X         The X sequence
+ * @param[in]  m         The length of the X sequence
+ * @param[in]  Y         The Y sequence
+ * @param[in]  n         The length of the Y sequence
+ * @param[in]  max_dist  The distance limit, negative for no limit
+ *
+ * @return     The edit distance, or max_dist + 1 if it exceeds the limit.
+ */
+int levenshtein_distance(const fr_tables_t* tables, const char* X,
+    const int m, const char* Y, const int n, const int max_dist);
+
+#endif // end FOUR_RUSSIANS_H_
@@ -9,181 +9,428 @@
  *
  *             To run the program, type:
  *
- *             ./global_alignment.exe
+ *             ./global_alignment.exe [--mem-budget MB] [--threads N]
+ *               [--matrix identity|dna|blosum62|pam250] [--gap-open O]
+ *               [--gap-extend E] [--max-paths K] [--band B|auto]
+ *               [--mode global|local|semi-global|overlap|glocal]
+ *               [--quiet] [--print-matrix]
+ *               [X Y | --queries FILE --targets FILE]
+ *
+ *             When the packed traceback (4 bits per cell) does not fit in the
+ *             memory budget (in MB), the alignment is computed in linear space
+ *             with Hirschberg's algorithm. Otherwise the traceback is filled
+ *             in parallel by tiles along the anti-diagonals.
+ *
+ *             A gap of length k costs O + k * E, by default O = 0 and
+ *             E = GAP_PENALTY. Any other gap cost is aligned with the affine
+ *             (Gotoh) engine, whose packed traceback must fit in the memory
+ *             budget, otherwise only the score is reported.
+ *
+ *             The substitution matrix defaults to the identity one, i.e.
+ *             MATCH_SCORE and MISMATCH_SCORE.
+ *
+ *             With --band, only the cells within B diagonals of the band
+ *             between cell (0, 0) and cell (m, n) are computed, in O(B max(m,
+ *             n)) space, and the program reports whether the score is provably
+ *             optimal. With --band auto, the band starts at BAND_START and
+ *             doubles until it is, then the alignment is the one of the full
+ *             matrix. Banded alignment requires the default gap costs.
+ *
+ *             With --mode, the boundary policy of the alignment can be
+ *             changed: local, semi-global (all end gaps free), overlap (a
+ *             suffix of X with a prefix of Y) or glocal (X end to end within
+ *             Y). These modes share a single DP core, specialised at compile
+ *             time on the mode, and require the default gap costs and a trace
+ *             matrix of (m+1)x(n+1) bytes within the memory budget.
+ *
+ *             With --queries and --targets, every query of a file is scored
+ *             against every target of another one (score only, with the
+ *             default gap costs and any mode). The queries are inserted in a
+ *             trie, walked depth first for each target: a prefix shared by
+ *             several queries is aligned once, and the scores of the target
+ *             against each query symbol are computed once per target. The
+ *             targets are scored in parallel and the scores printed as "query
+ *             target score" lines.
+ *
+ *             The co-optimal paths are counted in O(mn) time and, for short
+ *             sequences, the first K of them are printed (by default
+ *             MAX_PATHS, 0 to only count them).
+ *
+ *             With --print-matrix, the score and trace matrices of short
+ *             sequences are printed. With --quiet, only the alignment is
+ *             printed, as a "X x_start x_end Y y_start y_end score identity
+ *             CIGAR" record (see align_output.h), and the batch mode prints
+ *             nothing but its scores.
  */
+#include "align_output.h"
+#include "alignment.h"
+#include "banded.h"
+#include "dp_core.h"
+#include "gotoh.h"
+#include "hirschberg.h"
+#include "paths.h"
+#include "query_trie.h"
+#include "sequence_io.h"
+#include "wavefront.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
+#include <omp.h>
 
-#define MAX_LENGTH 100
-#define MAX_PATHS 100
-
-#define MATCH_SCORE 2
-#define MISMATCH_SCORE -1
-#define GAP_PENALTY 2
+#define MAX_LENGTH 100 // Longest sequences whose matrices and paths are printed
+#define MAX_PATHS 100 // Default number of optimal paths printed
+#define DEFAULT_MEM_BUDGET_MB 256
 
-#define STOP 0
-#define UP 1
-#define LEFT 2
-#define DIAG 3
+#define USAGE "ERROR. Usage: %s [--mem-budget MB] [--threads N] " \
+  "[--matrix identity|dna|blosum62|pam250] [--gap-open O] [--gap-extend E] " \
+  "[--max-paths K] [--band B|auto] " \
+  "[--mode global|local|semi-global|overlap|glocal] [--quiet] " \
+  "[--print-matrix] [X Y | --queries FILE --targets FILE]\n"
 
-/*
- * @brief      Data structure to store the up, left and diagonal scores of a
- *             cell.
- */
-typedef struct {
-  int up;
-  int diag;
-  int left;
-} score_t;
-
-/*
- * @brief      Index data structure to store cells coordinates.
- */
-typedef struct {
-  int x;
-  int y;
-} idx_t;
-
-/*
- * @brief      Data structure holding information for performing backtracking
- *             search of the optimal paths.
+/**
+ * @brief      Prints the co-optimal paths given two sequences, at most
+ *             max_paths of them, followed by the number of paths.
+ *
+ * @param[in]  X          The X input sequence
+ * @param[in]  Y          The Y input sequence
+ * @param[in]  m          The length of the X sequence
+ * @param[in]  n          The length of the Y sequence
+ * @param[in]  trace      The packed traceback
+ * @param[in]  max_paths  The maximum number of paths to print
  */
-typedef struct {
-  char* X;
-  char* Y;
-  int m;
-  int n;
-  idx_t dst;
-  idx_t* path;
-  bool* visited_cells;
-  int path_index;
-  int num_optimal_paths;
-} search_t;
+void print_all_paths(
+    const char* X,
+    const char* Y,
+    const int m,
+    const int n,
+    const trace_store_t* trace,
+    const long max_paths);
 
 /**
- * @brief      Prints an alignment sequence.
+ * @brief      Prints an alignment of X against Y: the aligned sequences or,
+ *             when quiet, a single record.
  *
- * @param[in]  alignment_length  The alignment length
- * @param[in]  alignX            The aligned string of the x sequence
- * @param[in]  alignY            The aligned string of the y sequence
+ * @param[in]  quiet    Whether to print a record
+ * @param[in]  score    The score
+ * @param[in]  x_start  The first aligned position of X
+ * @param[in]  x_end    The position of X past the alignment
+ * @param[in]  y_start  The first aligned position of Y
+ * @param[in]  y_end    The position of Y past the alignment
+ * @param[in]  length   The alignment length
+ * @param[in]  alignX   The aligned X, backwards
+ * @param[in]  alignY   The aligned Y, backwards
  */
-void print_alignment(const int alignment_length,
-    const char alignX[MAX_LENGTH * 2], const char alignY[MAX_LENGTH * 2]);
+static void report_alignment(const bool quiet, const int score,
+    const int x_start, const int x_end, const int y_start, const int y_end,
+    const int length, const char* alignX, const char* alignY) {
+  if (quiet) {
+    out_buffer_t out;
+    out_init(&out, stdout, OUT_BUFFER_BYTES);
+    out_alignment(&out, "X", x_start, x_end, "Y", y_start, y_end, score,
+      length, alignX, alignY);
+    out_free(&out);
+  } else {
+    print_alignment(length, alignX, alignY);
+  }
+}
 
 /**
- * @brief      Prints all optimal paths given two sequences.
+ * @brief      Scores an alignment with the linear gap penalty.
+ *
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  length  The alignment length
+ * @param[in]  alignX  The aligned X
+ * @param[in]  alignY  The aligned Y
  *
- * @param[in]  X       The X input sequence
- * @param[in]  Y       The Y input sequence
- * @param[in]  m       The length of the X sequence
- * @param[in]  n       The length of the Y sequence
- * @param[in]  trace   The trace matrix
- * @param[in]  scores  The scores matrix
- * @param[in]  src     The starting cell from which starting the alignment
- * @param[in]  dst     The destination cell to end the alignment
+ * @return     The score.
  */
-void print_all_paths(
-    const char* X, //[MAX_LENGTH + 1],
-    const char* Y, //[MAX_LENGTH + 1],
-    const int m,
-    const int n,
-    const int trace[MAX_LENGTH + 1][MAX_LENGTH + 1],
-    const score_t scores[MAX_LENGTH + 1][MAX_LENGTH + 1],
-    const idx_t src,
-    const idx_t dst);
+static int alignment_score(const matrix_t matrix, const int length,
+    const char* alignX, const char* alignY) {
+  uint8_t codes[256];
+  build_symbol_codes(matrix, codes);
+  int score = 0;
+  for (int k = 0; k < length; ++k) {
+    score += alignX[k] == '-' || alignY[k] == '-' ? -GAP_PENALTY :
+      substitution_score(matrix, codes[(uint8_t)alignX[k]],
+        codes[(uint8_t)alignY[k]]);
+  }
+  return score;
+}
 
 /**
- * @brief      Prints all paths utility (recursive function).
+ * @brief      Scores every query of a file against every target of another
+ *             one with the trie of the queries, the targets in parallel, and
+ *             prints the scores.
  *
- * @param[in]  trace      The trace
- * @param[in]  scores     The scores
- * @param[in]  curr_cell  The current cell to visit
- * @param      search     The search data structure
+ * @param[in]  queries_file  The queries file
+ * @param[in]  targets_file  The targets file
+ * @param[in]  matrix        The substitution matrix
+ * @param[in]  mode          The alignment mode
+ * @param[in]  num_threads   The number of threads
+ * @param[in]  quiet         Whether to only print the scores
  */
-void print_all_paths_util(
-  const int trace[MAX_LENGTH + 1][MAX_LENGTH + 1],
-  const score_t scores[MAX_LENGTH + 1][MAX_LENGTH + 1],
-  idx_t curr_cell,
-  search_t* search);
+static void align_batch(const char* queries_file, const char* targets_file,
+    const matrix_t matrix, const align_mode_t mode, const int num_threads,
+    const bool quiet) {
+  int num_queries = 0;
+  int num_targets = 0;
+  sequence_t* queries = read_sequences(queries_file, &num_queries);
+  sequence_t* targets = read_sequences(targets_file, &num_targets);
+  const char** seqs = malloc(sizeof(char*) * (num_queries + 1));
+  int* lengths = malloc(sizeof(int) * (num_queries + 1));
+  int* scores = malloc(sizeof(int) * ((size_t)num_queries * num_targets + 1));
+  if (seqs == NULL || lengths == NULL || scores == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d scores\n",
+      num_queries, num_targets);
+    exit(1);
+  }
+  long num_symbols = 0;
+  for (int q = 0; q < num_queries; ++q) {
+    seqs[q] = queries[q].seq;
+    lengths[q] = queries[q].length;
+    num_symbols += lengths[q];
+  }
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  query_trie_t trie;
+  trie_build(&trie, seqs, lengths, num_queries);
+  double num_cells = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads) \
+  reduction(+:num_cells)
+  for (int t = 0; t < num_targets; ++t) {
+    trie_align(&trie, targets[t].seq, targets[t].length, matrix, mode,
+      scores + (size_t)t * num_queries);
+    num_cells += (double)(trie.num_nodes - 1) * targets[t].length;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  const double kSeconds = (end.tv_sec - start.tv_sec) +
+    (end.tv_nsec - start.tv_nsec) * 1e-9;
+  out_buffer_t out;
+  out_init(&out, stdout, OUT_BUFFER_BYTES);
+  for (int t = 0; t < num_targets; ++t) {
+    for (int q = 0; q < num_queries; ++q) {
+      out_string(&out, queries[q].name);
+      out_char(&out, '\t');
+      out_string(&out, targets[t].name);
+      out_char(&out, '\t');
+      out_int(&out, scores[(size_t)t * num_queries + q]);
+      out_char(&out, '\n');
+    }
+  }
+  out_free(&out);
+  if (!quiet) {
+    fprintf(stderr, "[INFO] %d queries against %d targets (%s): %d trie "
+      "rows for %ld query symbols (%.2fx reuse), %.6f s, %.3f GCUPS (%d "
+      "threads)\n", num_queries, num_targets, mode_name(mode),
+      trie.num_nodes - 1, num_symbols, trie.num_nodes > 1 ?
+      (double)num_symbols / (trie.num_nodes - 1) : 1.0, kSeconds,
+      num_cells / (kSeconds > 0 ? kSeconds : 1e-9) * 1e-9, num_threads);
+  }
+  trie_free(&trie);
+  free(seqs);
+  free(lengths);
+  free(scores);
+  free_sequences(queries, num_queries);
+  free_sequences(targets, num_targets);
+}
 
 int main(int argc, char** argv) {
   int i, j;
   int m, n;
-  int alignment_length, score, tmp;
-  char X[MAX_LENGTH + 1] = "ATCGAT"; // "ATTA";
-  char Y[MAX_LENGTH + 1] = "ATACGT"; // "ATTTTA";
+  int alignment_length;
+  const char* X = "ATCGAT"; // "ATTA";
+  const char* Y = "ATACGT"; // "ATTTTA";
+  long mem_budget_mb = DEFAULT_MEM_BUDGET_MB;
+  int num_threads = omp_get_max_threads();
+  long max_paths = MAX_PATHS;
+  int band = -1; // No band
+  bool is_adaptive_band = false;
+  gap_cost_t gap = {0, GAP_PENALTY};
+  matrix_t matrix = MATRIX_IDENTITY;
+  align_mode_t mode = MODE_GLOBAL;
+  const char* queries_file = NULL;
+  const char* targets_file = NULL;
+  bool quiet = false;
+  bool print_matrix = false;
 
-  if (argc == 3) {
-    strcpy(X, argv[1]);
-    strcpy(Y, argv[2]);
+  int num_seqs = 0;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--mem-budget") == 0 && arg + 1 < argc) {
+      mem_budget_mb = atol(argv[++arg]);
+    } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+      num_threads = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--max-paths") == 0 && arg + 1 < argc) {
+      max_paths = atol(argv[++arg]);
+    } else if (strcmp(argv[arg], "--band") == 0 && arg + 1 < argc) {
+      is_adaptive_band = strcmp(argv[++arg], "auto") == 0;
+      band = is_adaptive_band ? BAND_START : atoi(argv[arg]);
+    } else if (strcmp(argv[arg], "--matrix") == 0 && arg + 1 < argc) {
+      if (parse_matrix(argv[++arg], &matrix)) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--mode") == 0 && arg + 1 < argc) {
+      if (parse_mode(argv[++arg], &mode)) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--queries") == 0 && arg + 1 < argc) {
+      queries_file = argv[++arg];
+    } else if (strcmp(argv[arg], "--targets") == 0 && arg + 1 < argc) {
+      targets_file = argv[++arg];
+    } else if (strcmp(argv[arg], "--quiet") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[arg], "--print-matrix") == 0) {
+      print_matrix = true;
+    } else if (strcmp(argv[arg], "--gap-open") == 0 && arg + 1 < argc) {
+      gap.open = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--gap-extend") == 0 && arg + 1 < argc) {
+      gap.extend = atoi(argv[++arg]);
+    } else if (num_seqs == 0) {
+      X = argv[arg];
+      ++num_seqs;
+    } else if (num_seqs == 1) {
+      Y = argv[arg];
+      ++num_seqs;
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  if (num_seqs == 1 || (mode != MODE_GLOBAL && (band >= 0 || gap.open != 0 ||
+      gap.extend != GAP_PENALTY))) {
+    fprintf(stderr, USAGE, argv[0]);
+    exit(1);
+  }
+  if (queries_file != NULL || targets_file != NULL) {
+    if (queries_file == NULL || targets_file == NULL || num_seqs > 0 ||
+        band >= 0 || gap.open != 0 || gap.extend != GAP_PENALTY) {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+    align_batch(queries_file, targets_file, matrix, mode, num_threads,
+      quiet);
+    return 0;
   }
-
-  int F[MAX_LENGTH + 1][MAX_LENGTH + 1]; // Score matrix
-  int trace[MAX_LENGTH + 1][MAX_LENGTH + 1]; // Trace matrix
-  char alignX[MAX_LENGTH * 2]; // Aligned X sequence
-  char alignY[MAX_LENGTH * 2]; // Aligned Y sequence
-
-  int max_score = -((1 << 30) - 1); // Fairly small number
-  const score_t no_match = {0};
-  score_t scores[MAX_LENGTH + 1][MAX_LENGTH + 1] = {no_match}; // Scores matrix
   /*
    * Find lengths of (null-terminated) strings X and Y
    */
-  m = 0;
-  n = 0;
-  while (X[m] != 0) {
-    ++m;
+  m = seq_length(X);
+  n = seq_length(Y);
+
+  char* alignX = malloc(sizeof(char) * (m + n)); // Aligned X sequence
+  char* alignY = malloc(sizeof(char) * (m + n)); // Aligned Y sequence
+  const size_t kMemBudget = (size_t)mem_budget_mb * 1024 * 1024;
+  if (mode != MODE_GLOBAL) {
+    if (dp_trace_bytes(m, n) > kMemBudget) {
+      fprintf(stderr, "ERROR. The %dx%d trace matrix exceeds the %ld MB "
+        "memory budget\n", m, n, mem_budget_mb);
+      exit(1);
+    }
+    const dp_result_t kResult = dp_align(X, m, Y, n, matrix, mode, alignX,
+      alignY);
+    if (!quiet) {
+      printf("[INFO] %s alignment, score: %d, from (%d, %d) to (%d, %d)\n",
+        mode_name(mode), kResult.score, kResult.start_i, kResult.start_j,
+        kResult.end_i, kResult.end_j);
+    }
+    report_alignment(quiet, kResult.score, kResult.start_i, kResult.end_i,
+      kResult.start_j, kResult.end_j, kResult.length, alignX, alignY);
+    free(alignX);
+    free(alignY);
+    return 0;
   }
-  while (Y[n] != 0) {
-    ++n;
+  if (gap.open != 0 || gap.extend != GAP_PENALTY) {
+    const bool kFits = gotoh_trace_bytes(m, n) <= kMemBudget;
+    if (!kFits && !quiet) {
+      printf("[INFO] Score-only alignment: the %dx%d affine traceback exceeds "
+        "the %ld MB memory budget\n", m, n, mem_budget_mb);
+    }
+    const gotoh_result_t result = gotoh_align(X, m, Y, n, matrix, gap, false,
+      kFits ? alignX : NULL, kFits ? alignY : NULL);
+    if (!quiet) {
+      printf("[INFO] Affine gap alignment (open %d, extend %d), score: %d\n",
+        gap.open, gap.extend, result.score);
+    }
+    // NOTE: Without the traceback, the record has an empty CIGAR ("*").
+    if (kFits || quiet) {
+      report_alignment(quiet, result.score, 0, m, 0, n, result.length, alignX,
+        alignY);
+    }
+    free(alignX);
+    free(alignY);
+    return 0;
   }
   /*
-   * Initialise matrices
+   * Banded alignment, falling back to the full matrix if the adaptive band
+   * does not fit in the memory budget.
    */
-  F[0][0] = 0;
-  trace[0][0] = STOP;
-  for (int i = 1; i <= m; ++i) {
-    F[i][0] = F[i-1][0] - GAP_PENALTY;
-    trace[i][0] = STOP;
+  if (band >= 0) {
+    const band_result_t kResult = is_adaptive_band ?
+      banded_align_adaptive(X, Y, m, n, matrix, band, kMemBudget, alignX,
+        alignY) :
+      banded_align(X, Y, m, n, matrix, band, alignX, alignY);
+    if (kResult.is_optimal || !is_adaptive_band) {
+      if (!quiet) {
+        printf("[INFO] Banded alignment (band %d, %d pass%s), score: %d, "
+          "%s\n", kResult.band, kResult.num_passes,
+          kResult.num_passes > 1 ? "es" : "", kResult.score,
+          kResult.is_optimal ? "optimal" : "not provably optimal");
+      }
+      report_alignment(quiet, kResult.score, 0, m, 0, n, kResult.length,
+        alignX, alignY);
+      free(alignX);
+      free(alignY);
+      return 0;
+    }
+    if (!quiet) {
+      printf("[INFO] No provably optimal band fits in the %ld MB memory "
+        "budget (last band %d, score %d)\n", mem_budget_mb, kResult.band,
+        kResult.score);
+    }
   }
-  for (int j = 1; j <= n; j++) {
-    F[0][j] = F[0][j-1] - GAP_PENALTY;
-    trace[0][j] = STOP;
+  /*
+   * Pick the traceback strategy: the packed traceback is used as long as it
+   * fits in the memory budget, otherwise switch to linear space.
+   */
+  if (trace_store_bytes(m, n) > kMemBudget) {
+    const long kLeafCells = kMemBudget / (sizeof(int) + sizeof(char));
+    if (!quiet) {
+      printf("[INFO] Linear-space (Hirschberg) alignment: %dx%d cells exceed "
+        "the %ld MB memory budget\n", m, n, mem_budget_mb);
+    }
+    alignment_length = hirschberg_align(X, Y, m, n, matrix, kLeafCells,
+      alignX, alignY);
+    report_alignment(quiet, quiet ? alignment_score(matrix, alignment_length,
+      alignX, alignY) : 0, 0, m, 0, n, alignment_length, alignX, alignY);
+    free(alignX);
+    free(alignY);
+    return 0;
+  }
+
+  // NOTE: The score matrix is only needed to print it, i.e. on request and for
+  // short sequences. Ties are recorded in the packed traceback, 4 bits per
+  // cell.
+  const bool kIsShort = m <= MAX_LENGTH && n <= MAX_LENGTH;
+  const bool kPrintMatrix = print_matrix && kIsShort && !quiet;
+  int* F = kPrintMatrix ? malloc(sizeof(int) * cell_idx(m + 1, 0, n)) : NULL;
+  trace_store_t trace;
+  if ((kPrintMatrix && F == NULL) || trace_store_init(&trace, m, n)) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d matrices\n", m, n);
+    exit(1);
   }
   /*
    * Fill matrices
    */
-  for (int i = 1; i <= m; ++i) {
-    for (int j = 1; j <= n; j++) {
-      if (X[i-1] == Y[j-1]) {
-        score = F[i-1][j-1] + MATCH_SCORE;
-      } else {
-        score = F[i-1][j-1] + MISMATCH_SCORE;
-      }
-      trace[i][j] = DIAG;
-      tmp = F[i-1][j] - GAP_PENALTY;
-      scores[i][j].diag = score;
-      scores[i][j].up = tmp;
-      if (tmp > score) {
-        score = tmp;
-        trace[i][j] = UP;
-      }
-      tmp = F[i][j-1] - GAP_PENALTY;
-      scores[i][j].left = tmp;
-      if(tmp > score) {
-        score = tmp;
-        trace[i][j] = LEFT;
-      }
-      F[i][j] = score;
-      max_score = score > max_score ? score : max_score;
-     }
-  }
+  const int kScore = wavefront_fill_global(X, Y, m, n, matrix, F, &trace,
+    WAVEFRONT_TILE, num_threads);
   /*
    * Print score matrix
    */
-#define PRINT_MATRIX(m, n, x, y, f) printf("      "); \
+#define PRINT_MATRIX(m, n, x, y, value) printf("      "); \
   for (int j = 0; j < n; ++j) { \
     printf("%5c", y[j]); \
   } \
@@ -195,24 +442,26 @@ int main(int argc, char** argv) {
       printf("%c", x[i-1]); \
     } \
     for (int j = 0; j <= n; j++) { \
-      printf("%5d", f[i][j]); \
+      printf("%5d", value); \
     } \
     printf("\n"); \
   } \
   printf("\n");
 
-  printf("[INFO] Score matrix:\n");
-  PRINT_MATRIX(m, n, X, Y, F);
-  printf("[INFO] Trace matrix:\n");
-  PRINT_MATRIX(m, n, X, Y, trace);
+  if (kPrintMatrix) {
+    printf("[INFO] Score matrix:\n");
+    PRINT_MATRIX(m, n, X, Y, F[cell_idx(i, j, n)]);
+    printf("[INFO] Trace matrix:\n");
+    PRINT_MATRIX(m, n, X, Y, trace_move(&trace, i, j));
+  }
   /*
    * Trace back from the lower-right corner of the matrix
    */
   i = m;
   j = n;
   alignment_length = 0;
-  while (trace[i][j] != STOP) {
-    switch (trace[i][j]) {
+  while (trace_move(&trace, i, j) != STOP) {
+    switch (trace_move(&trace, i, j)) {
       case DIAG:
         alignX[alignment_length] = X[i-1];
         alignY[alignment_length] = Y[j-1];
@@ -252,209 +501,91 @@ int main(int argc, char** argv) {
   /*
    * Print alignment
    */
-  print_alignment(alignment_length, alignX, alignY);
-  idx_t start, end;
-  start.x = m;
-  start.y = n;
-  end.x = 0;
-  end.y = 0;
-  print_all_paths(X, Y, m, n, trace, scores, start, end);
-  return 0;
-}
-
-void print_alignment(const int alignment_length,
-    const char alignX[MAX_LENGTH * 2],
-    const char alignY[MAX_LENGTH * 2]) {
-  int match_cnt = 0;
-  printf("* Alignment Sequence:\n");
-  for (int i = alignment_length - 1; i >= 0; --i) {
-    printf("%c", alignX[i]);
-  }
-  printf("\n");
-  for (int i = alignment_length - 1; i >= 0; --i) {
-    if (alignX[i] == alignY[i]) {
-      printf("|");
-      ++match_cnt;
-    } else {
-      printf(" ");
-    }
+  report_alignment(quiet, kScore, 0, m, 0, n, alignment_length, alignX,
+    alignY);
+  // NOTE: The number of optimal paths grows exponentially with the number of
+  // ties: they are always counted, but only listed for short sequences.
+  if (!quiet) {
+    print_all_paths(X, Y, m, n, &trace, kIsShort ? max_paths : 0);
   }
-  printf("\n");
-  for (int i = alignment_length - 1; i >= 0; --i) {
-    printf("%c", alignY[i]);
-  }
-  printf("\n");
-  // NOTE: The percentage identity is calculated based on the total alignment
-  // length, i.e. including all the indel.
-  const float perc_identity = (float)match_cnt / (float)alignment_length * 100.;
-  printf("[INFO] Percent identity: %.2f%\n", perc_identity);
-  // NOTE: The Hamming distance only works for sequences of same length. We
-  // calculate the Hamming distance by getting the difference between the
-  // aligned sequences and the number of matches.
-  printf("[INFO] Hamming distance: %d\n", alignment_length - match_cnt);
+  free(F);
+  trace_store_free(&trace);
+  free(alignX);
+  free(alignY);
+  return 0;
 }
 
 void print_all_paths(
-    const char X[MAX_LENGTH + 1],
-    const char Y[MAX_LENGTH + 1],
+    const char* X,
+    const char* Y,
     const int m,
     const int n,
-    const int trace[MAX_LENGTH + 1][MAX_LENGTH + 1],
-    const score_t scores[MAX_LENGTH + 1][MAX_LENGTH + 1],
-    const idx_t src,
-    const idx_t dst) {
-  // Setup search data structure
-  const int kNumCells = (m + 1) * (n + 1);
-  search_t* search = malloc(sizeof(search_t));
-  search->visited_cells = malloc(sizeof(bool) * kNumCells);
-  search->path = malloc(sizeof(idx_t) * kNumCells);
-  search->path_index = 0;
-  search->num_optimal_paths = 0;
-  search->dst = dst;
-  search->X = malloc(sizeof(m+1));
-  search->Y = malloc(sizeof(n+1));
-  search->m = m;
-  search->n = n;
-  memcpy(search->X, X, m+1);
-  memcpy(search->Y, Y, n+1);
-  for (int i = 0; i < kNumCells; ++i) {
-    search->visited_cells[i] = false;
-  }
-  printf("[INFO] All optimal paths:\n");
-  print_all_paths_util(trace, scores, src, search);
-  printf("[INFO] Number of optimal paths found: %d\n", search->num_optimal_paths);
-  free(search->X);
-  free(search->Y);
-  free(search->visited_cells);
-  free(search->path);
-  free(search);
-}
-
-int get_cell_id(const idx_t p, const int size) {
-  return p.x * size + p.y;
-}
-
-void print_all_paths_util(
-    const int trace[MAX_LENGTH + 1][MAX_LENGTH + 1],
-    const score_t scores[MAX_LENGTH + 1][MAX_LENGTH + 1],
-    const idx_t c,
-    search_t* search) {
-  // If cell with negative coordinates, end recursion.
-  if (c.x < 0 || c.y < 0) {
-    return;
-  }
-  // Update visited cells and append current cell c to path.
-  search->visited_cells[get_cell_id(c, search->n)] = true;
-  search->path[search->path_index] = c;
-  search->path_index++;
-  const idx_t* path = search->path;
-  const bool* visited_cells = search->visited_cells;
-  // If current cell is same as destination or STOP reached, then print path
-  if ((c.x == search->dst.x && c.y == search->dst.y) || trace[c.x][c.y] == STOP) {
-    const char* X = search->X;
-    const char* Y = search->Y;
-    char alignX[MAX_LENGTH * 2];
-    char alignY[MAX_LENGTH * 2];
-    int alignment_length = 0;
-    int x_idx = path[0].x;
-    int y_idx = path[0].y;
-    // In order to trace back the path, compare the COORDINATES of the cells in
-    // the path.
-    for (int i = 0; i < search->path_index - 1; ++i) {
-      if (path[i].x-1 == path[i+1].x && path[i].y-1 == path[i+1].y) {
-        // diag
-        alignX[alignment_length] = X[path[i].x-1];
-        alignY[alignment_length] = Y[path[i].y-1];
-        --x_idx;
-        --y_idx;
-      } else if (path[i].x-1 == path[i+1].x && path[i].y == path[i+1].y) {
-        // up
-        alignX[alignment_length] = X[path[i].x-1];
+    const trace_store_t* trace,
+    const long max_paths) {
+  const uint64_t kNumPaths = count_optimal_paths(trace);
+  if (max_paths > 0) {
+    if (kNumPaths <= (uint64_t)max_paths) {
+      printf("[INFO] All optimal paths:\n");
+    } else {
+      printf("[INFO] First %ld optimal paths:\n", max_paths);
+    }
+    char* alignX = malloc(sizeof(char) * (m + n));
+    char* alignY = malloc(sizeof(char) * (m + n));
+    path_iter_t iter;
+    path_iter_init(&iter, trace, (idx_t){m, n});
+    for (long k = 1; k <= max_paths && path_iter_next(&iter); ++k) {
+      const idx_t* path = iter.path;
+      int alignment_length = 0;
+      // In order to trace back the path, compare the COORDINATES of the cells
+      // in the path.
+      for (int i = 0; i < iter.length - 1; ++i) {
+        if (path[i].x-1 == path[i+1].x && path[i].y-1 == path[i+1].y) {
+          // diag
+          alignX[alignment_length] = X[path[i].x-1];
+          alignY[alignment_length] = Y[path[i].y-1];
+        } else if (path[i].x-1 == path[i+1].x) {
+          // up
+          alignX[alignment_length] = X[path[i].x-1];
+          alignY[alignment_length] = '-';
+        } else {
+          // left
+          alignX[alignment_length] = '-';
+          alignY[alignment_length] = Y[path[i].y-1];
+        }
+        ++alignment_length;
+      }
+      // Unaligned beginning
+      int x_idx = path[iter.length-1].x;
+      int y_idx = path[iter.length-1].y;
+      while (x_idx > 0) {
+        alignX[alignment_length] = X[x_idx-1];
         alignY[alignment_length] = '-';
         --x_idx;
-      } else if (path[i].x == path[i+1].x && path[i].y-1 == path[i+1].y) {
-        // left
+        ++alignment_length;
+      }
+      while (y_idx > 0) {
         alignX[alignment_length] = '-';
-        alignY[alignment_length] = Y[path[i].y-1];
+        alignY[alignment_length] = Y[y_idx-1];
         --y_idx;
+        ++alignment_length;
       }
-      ++alignment_length;
-    }
-    // Unaligned beginning
-    while (x_idx > 0) {
-      alignX[alignment_length] = X[x_idx-1];
-      alignY[alignment_length] = '-';
-      --x_idx;
-      ++alignment_length;
-    }
-    while (y_idx > 0) {
-      alignX[alignment_length] = '-';
-      alignY[alignment_length] = Y[y_idx-1];
-      --y_idx;
-      ++alignment_length;
-    }
-    search->num_optimal_paths++;
-    printf("* Path n.%d: List of coordinates: ", search->num_optimal_paths);
-    for (int i = 0; i < search->path_index; ++i) {
-      printf("(%d, %d) ", path[i].x, path[i].y);
+      printf("* Path n.%ld: List of coordinates: ", k);
+      for (int i = 0; i < iter.length; ++i) {
+        printf("(%d, %d) ", path[i].x, path[i].y);
+      }
+      printf("\n");
+      print_alignment(alignment_length, alignX, alignY);
+      printf("\n");
     }
-    printf("\n");
-    print_alignment(alignment_length, alignX, alignY);
-    printf("\n");
+    path_iter_free(&iter);
+    free(alignX);
+    free(alignY);
+  }
+  if (kNumPaths == PATHS_SATURATED) {
+    printf("[INFO] Number of optimal paths found: at least %llu\n",
+      (unsigned long long)kNumPaths);
   } else {
-    // If current cell is not the final destination, call
-    // recursion/backtracking/visit on cells with same score directions and
-    // which haven't been visited yet.
-    idx_t up, diag, left;
-    up.x = c.x - 1;
-    up.y = c.y;
-    diag.x = c.x - 1;
-    diag.y = c.y - 1;
-    left.x = c.x;
-    left.y = c.y - 1;
-    switch (trace[c.x][c.y]) {
-      case UP:
-        if (!visited_cells[get_cell_id(up, search->n)]) {
-          print_all_paths_util(trace, scores, up, search); // Visit Up cell.
-        }
-        if (scores[c.x][c.y].up == scores[c.x][c.y].diag &&
-            !visited_cells[get_cell_id(diag, search->n)]) {
-          print_all_paths_util(trace, scores, diag, search); // Visit Diag cell.
-        }
-        if (scores[c.x][c.y].up == scores[c.x][c.y].left &&
-            !visited_cells[get_cell_id(left, search->n)]) {
-          print_all_paths_util(trace, scores, left, search); // Visit Left cell.
-        }
-        break;
-      case LEFT:
-        if (!visited_cells[get_cell_id(left, search->n)]) {
-          print_all_paths_util(trace, scores, left, search); // Visit Left cell.
-        }
-        if (scores[c.x][c.y].left == scores[c.x][c.y].diag &&
-            !visited_cells[get_cell_id(diag, search->n)]) {
-          print_all_paths_util(trace, scores, diag, search); // Visit Diag cell.
-        }
-        if (scores[c.x][c.y].left == scores[c.x][c.y].up &&
-            !visited_cells[get_cell_id(up, search->n)]) {
-          print_all_paths_util(trace, scores, up, search); // Visit Up cell.
-        }
-        break;
-      case DIAG:
-        if (!visited_cells[get_cell_id(diag, search->n)]) {
-          print_all_paths_util(trace, scores, diag, search); // Visit Diag cell.
-        }
-        if (scores[c.x][c.y].diag == scores[c.x][c.y].up &&
-            !visited_cells[get_cell_id(up, search->n)]) {
-          print_all_paths_util(trace, scores, up, search); // Visit Up cell.
-        }
-        if (scores[c.x][c.y].diag == scores[c.x][c.y].left &&
-            !visited_cells[get_cell_id(left, search->n)]) {
-          print_all_paths_util(trace, scores, left, search); // Visit Left cell.
-        }
-        break;
-    }
+    printf("[INFO] Number of optimal paths found: %llu\n",
+      (unsigned long long)kNumPaths);
   }
-  // Remove current cell from path and set it as not visited
-  search->path_index--;
-  search->visited_cells[get_cell_id(c, search->n)] = false;
-}
\ No newline at end of file
+}
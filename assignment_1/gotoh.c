@@ -0,0 +1,256 @@
+/*
+ * File:  gotoh.c
+ * Author: Stefano Ribes
+ *
+ * Affine gap alignment with three states per cell. The M, I and D scores of a
+ * row are interleaved, so that a cell reads a single 12-byte record of the
+ * previous row and writes one of the current row. The traceback only keeps
+ * 4 bits per cell, two cells per byte.
+ */
+#include "gotoh.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MINUS_INF (INT_MIN / 2) // Leaves room for the subtractions
+
+#define TRACE_STATE 0x3 // STOP, UP, LEFT or DIAG
+#define TRACE_I_EXTEND 0x4 // The I state extends the I state above
+#define TRACE_D_EXTEND 0x8 // The D state extends the D state on the left
+
+typedef struct {
+  int M;
+  int I;
+  int D;
+} gotoh_cell_t;
+
+static inline int max3(const gotoh_cell_t c) {
+  const int tmp = c.M > c.I ? c.M : c.I;
+  return tmp > c.D ? tmp : c.D;
+}
+
+static inline size_t trace_stride(const int n) {
+  return (size_t)(n + 1) / 2;
+}
+
+size_t gotoh_trace_bytes(const int m, const int n) {
+  return (size_t)m * trace_stride(n);
+}
+
+static inline int trace_at(const uint8_t* trace, const int i, const int j,
+    const int n) {
+  const uint8_t pair = trace[(size_t)(i - 1) * trace_stride(n) + (j - 1) / 2];
+  return (j - 1) & 1 ? pair >> 4 : pair & 0xf;
+}
+
+/*
+ * The bool and matrix parameters are compile-time constants at every call
+ * site, so the compiler emits a specialised loop for each combination.
+ */
+static ALWAYS_INLINE gotoh_result_t gotoh_fill(const uint8_t* X, const int m,
+    const uint8_t* Y, const int n, const gap_cost_t gap, gotoh_cell_t* prev,
+    gotoh_cell_t* curr, uint8_t* trace, const bool is_local,
+    const bool store_trace, const matrix_t matrix) {
+  const int kOpen = gap.open + gap.extend;
+  const int kExtend = gap.extend;
+  // Local alignments end at the first best cell, (1, 1) if no cell is positive.
+  gotoh_result_t best = {is_local ? INT_MIN : 0, 0, 0, 0, 0, 0};
+  /*
+   * Row 0: in a global alignment, Y[0..j-1] is aligned to a single gap.
+   */
+  prev[0].M = 0;
+  prev[0].I = MINUS_INF;
+  prev[0].D = MINUS_INF;
+  for (int j = 1; j <= n; ++j) {
+    prev[j].M = MINUS_INF;
+    prev[j].I = MINUS_INF;
+    prev[j].D = is_local ? MINUS_INF : -gap.open - j * kExtend;
+  }
+  for (int i = 1; i <= m; ++i) {
+    const uint8_t x = X[i-1];
+    uint8_t* trace_row = trace + (size_t)(i - 1) * trace_stride(n);
+    uint8_t pending = 0;
+    curr[0].M = MINUS_INF;
+    curr[0].I = is_local ? MINUS_INF : -gap.open - i * kExtend;
+    curr[0].D = MINUS_INF;
+    // H is the best of the three states, clamped to zero in local alignments.
+    int h_diag = is_local ? 0 : max3(prev[0]);
+    int h_left = is_local ? 0 : curr[0].I;
+    int d_left = MINUS_INF;
+    for (int j = 1; j <= n; ++j) {
+      const gotoh_cell_t up = prev[j];
+      int h_up = max3(up);
+      h_up = is_local && h_up < 0 ? 0 : h_up;
+      // Gap openings win the ties with the extensions.
+      const int kIOpen = h_up - kOpen;
+      const int kIExtend = up.I - kExtend;
+      const int I = kIExtend > kIOpen ? kIExtend : kIOpen;
+      const int kDOpen = h_left - kOpen;
+      const int kDExtend = d_left - kExtend;
+      const int D = kDExtend > kDOpen ? kDExtend : kDOpen;
+      const int M = h_diag + substitution_score(matrix, x, Y[j-1]);
+      // Same tie breaking of the linear fill: DIAG, then UP, then LEFT.
+      int h = I > M ? I : M;
+      int state = I > M ? UP : DIAG;
+      state = D > h ? LEFT : state;
+      h = D > h ? D : h;
+      if (is_local) {
+        state = h > 0 ? state : STOP;
+        h = h > 0 ? h : 0;
+        if (h > best.score) {
+          best.score = h;
+          best.end_i = i;
+          best.end_j = j;
+        }
+      }
+      curr[j].M = M;
+      curr[j].I = I;
+      curr[j].D = D;
+      if (store_trace) {
+        const int kCode = state | (kIExtend > kIOpen ? TRACE_I_EXTEND : 0) |
+          (kDExtend > kDOpen ? TRACE_D_EXTEND : 0);
+        if ((j - 1) & 1) {
+          trace_row[(j - 1) / 2] = pending | (kCode << 4);
+        } else {
+          pending = kCode;
+        }
+      }
+      h_diag = h_up;
+      h_left = h;
+      d_left = D;
+    }
+    if (store_trace && (n & 1)) {
+      trace_row[(n - 1) / 2] = pending;
+    }
+    gotoh_cell_t* tmp = prev;
+    prev = curr;
+    curr = tmp;
+  }
+  if (!is_local) {
+    best.score = max3(prev[n]);
+    best.end_i = m;
+    best.end_j = n;
+  } else if (best.score == INT_MIN) {
+    best.score = 0; // Empty sequence
+  }
+  best.start_i = best.end_i + 1;
+  best.start_j = best.end_j + 1;
+  return best;
+}
+
+/**
+ * @brief      Follows the packed traceback from the end cell of the result.
+ */
+static void gotoh_traceback(const char* X, const char* Y, const int n,
+    const uint8_t* trace, const bool is_local, gotoh_result_t* result,
+    char* alignX, char* alignY) {
+  int i = result->end_i;
+  int j = result->end_j;
+  int length = 0;
+  int state = DIAG; // DIAG stands for the best of the three states here
+  while (i > 0 && j > 0) {
+    const int kCode = trace_at(trace, i, j, n);
+    if (state == DIAG) {
+      state = kCode & TRACE_STATE;
+      if (state == STOP) {
+        break;
+      } else if (state == DIAG) {
+        alignX[length] = X[i-1];
+        alignY[length] = Y[j-1];
+        --i;
+        --j;
+        ++length;
+      }
+    } else if (state == UP) {
+      alignX[length] = X[i-1];
+      alignY[length] = '-';
+      state = kCode & TRACE_I_EXTEND ? UP : DIAG;
+      --i;
+      ++length;
+    } else {
+      alignX[length] = '-';
+      alignY[length] = Y[j-1];
+      state = kCode & TRACE_D_EXTEND ? LEFT : DIAG;
+      --j;
+      ++length;
+    }
+  }
+  /*
+   * Unaligned beginning
+   */
+  while (!is_local && i > 0) {
+    alignX[length] = X[i-1];
+    alignY[length] = '-';
+    --i;
+    ++length;
+  }
+  while (!is_local && j > 0) {
+    alignX[length] = '-';
+    alignY[length] = Y[j-1];
+    --j;
+    ++length;
+  }
+  result->start_i = i + 1;
+  result->start_j = j + 1;
+  result->length = length;
+}
+
+static ALWAYS_INLINE gotoh_result_t gotoh_fill_matrix(const uint8_t* X,
+    const int m, const uint8_t* Y, const int n, const gap_cost_t gap,
+    gotoh_cell_t* prev, gotoh_cell_t* curr, uint8_t* trace, const bool is_local,
+    const matrix_t matrix) {
+  if (is_local && trace != NULL) {
+    return gotoh_fill(X, m, Y, n, gap, prev, curr, trace, true, true, matrix);
+  } else if (is_local) {
+    return gotoh_fill(X, m, Y, n, gap, prev, curr, NULL, true, false, matrix);
+  } else if (trace != NULL) {
+    return gotoh_fill(X, m, Y, n, gap, prev, curr, trace, false, true, matrix);
+  } else {
+    return gotoh_fill(X, m, Y, n, gap, prev, curr, NULL, false, false, matrix);
+  }
+}
+
+gotoh_result_t gotoh_align(const char* X, const int m, const char* Y,
+    const int n, const matrix_t matrix, const gap_cost_t gap,
+    const bool is_local, char* alignX, char* alignY) {
+  gotoh_cell_t* rows = malloc(sizeof(gotoh_cell_t) * 2 * (n + 1));
+  const bool kStoreTrace = alignX != NULL && alignY != NULL;
+  uint8_t* trace = kStoreTrace ? malloc(gotoh_trace_bytes(m, n) + 1) : NULL;
+  if (rows == NULL || (kStoreTrace && trace == NULL)) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d affine traceback\n",
+      m, n);
+    exit(1);
+  }
+  uint8_t* X_codes = encode_sequence(matrix, X, m);
+  uint8_t* Y_codes = encode_sequence(matrix, Y, n);
+  gotoh_cell_t* prev = rows;
+  gotoh_cell_t* curr = rows + n + 1;
+  gotoh_result_t result;
+  switch (matrix) {
+    case MATRIX_DNA:
+      result = gotoh_fill_matrix(X_codes, m, Y_codes, n, gap, prev, curr,
+        trace, is_local, MATRIX_DNA);
+      break;
+    case MATRIX_BLOSUM62:
+      result = gotoh_fill_matrix(X_codes, m, Y_codes, n, gap, prev, curr,
+        trace, is_local, MATRIX_BLOSUM62);
+      break;
+    case MATRIX_PAM250:
+      result = gotoh_fill_matrix(X_codes, m, Y_codes, n, gap, prev, curr,
+        trace, is_local, MATRIX_PAM250);
+      break;
+    default:
+      result = gotoh_fill_matrix(X_codes, m, Y_codes, n, gap, prev, curr,
+        trace, is_local, MATRIX_IDENTITY);
+  }
+  if (kStoreTrace) {
+    gotoh_traceback(X, Y, n, trace, is_local, &result, alignX, alignY);
+  }
+  free(rows);
+  free(trace);
+  free(X_codes);
+  free(Y_codes);
+  return result;
+}
@@ -0,0 +1,80 @@
+/*
+ * File:  gotoh.h
+ * Author: Stefano Ribes
+ */
+#ifndef GOTOH_H_
+#define GOTOH_H_
+
+#include "alignment.h"
+#include "scoring.h"
+
+#include <stdbool.h>
+
+/*
+ * @brief      Affine gap costs: a gap of length k costs open + k * extend.
+ *             With open = 0 and extend = GAP_PENALTY the scores are the ones
+ *             of the linear gap model.
+ */
+typedef struct {
+  int open;
+  int extend;
+} gap_cost_t;
+
+/*
+ * @brief      Result of an affine gap alignment. The start and end cells are
+ *             1-based, i.e. the aligned region is X[start_i-1 .. end_i-1]
+ *             against Y[start_j-1 .. end_j-1].
+ */
+typedef struct {
+  int score;
+  int start_i;
+  int start_j;
+  int end_i;
+  int end_j;
+  int length; // Alignment length, zero when no traceback is requested
+} gotoh_result_t;
+
+/**
+ * @brief      Global or local alignment with affine gap costs (Gotoh). Each
+ *             cell holds three states: M (X[i-1] aligned to Y[j-1]), I (X[i-1]
+ *             aligned to a gap, i.e. an UP move) and D (Y[j-1] aligned to a
+ *             gap, i.e. a LEFT move). Only two rows of interleaved M/I/D
+ *             scores are kept, while the traceback is packed in 4 bits per
+ *             cell: the best state (STOP, UP, LEFT or DIAG) and whether the
+ *             I and D states extend a gap.
+ *
+ *             Ties are broken preferring DIAG, then UP, then LEFT, and gap
+ *             openings over extensions, as in global_alignment.c and
+ *             local_alignment.c. A local alignment ends at the first cell in
+ *             row-major order holding the best score.
+ *
+ * @param[in]  X         The X input sequence
+ * @param[in]  m         The length of the X sequence
+ * @param[in]  Y         The Y input sequence
+ * @param[in]  n         The length of the Y sequence
+ * @param[in]  matrix    The substitution matrix
+ * @param[in]  gap       The gap costs
+ * @param[in]  is_local  Whether to compute a local alignment
+ * @param      alignX    The aligned X sequence, stored backwards (at least
+ *                       m + n characters). If NULL, only the score (and the
+ *                       end cell) is computed, in linear space.
+ * @param      alignY    The aligned Y sequence, stored backwards (at least
+ *                       m + n characters)
+ *
+ * @return     The alignment score, its start and end cells and its length.
+ */
+gotoh_result_t gotoh_align(const char* X, const int m, const char* Y,
+    const int n, const matrix_t matrix, const gap_cost_t gap,
+    const bool is_local, char* alignX, char* alignY);
+
+/**
+ * @brief      Gets the size of the packed traceback of gotoh_align().
+ *
+ * @param[in]  m     The length of the X sequence
+ * @param[in]  n     The length of the Y sequence
+ *
+ * @return     The traceback size in bytes.
+ */
+size_t gotoh_trace_bytes(const int m, const int n);
+
+#endif // end GOTOH_H_
@@ -0,0 +1,111 @@
+/*
+ * File:  guide_tree.c
+ * Author: Stefano Ribes
+ *
+ * UPGMA on a working copy of the distance matrix. The cluster merged from
+ * slots i < j takes slot i, and slot j is retired.
+ */
+#include "guide_tree.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief      Finds the nearest active cluster of a slot.
+ */
+static int nearest(const double* D, const int n, const bool* active,
+    const int i) {
+  int best = -1;
+  for (int k = 0; k < n; ++k) {
+    if (k != i && active[k] &&
+        (best < 0 || D[(size_t)i * n + k] < D[(size_t)i * n + best])) {
+      best = k;
+    }
+  }
+  return best;
+}
+
+int upgma(const float* dist, const int n, tree_node_t* nodes) {
+  if (n == 0) {
+    return -1;
+  }
+  double* D = malloc(sizeof(double) * n * n);
+  bool* active = malloc(sizeof(bool) * n);
+  int* node_of = malloc(sizeof(int) * n); // Node of the cluster of each slot
+  int* near = malloc(sizeof(int) * n); // Nearest cluster of each slot
+  if (D == NULL || active == NULL || node_of == NULL || near == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the tree of %d sequences\n",
+      n);
+    exit(1);
+  }
+  for (size_t k = 0; k < (size_t)n * n; ++k) {
+    D[k] = dist[k];
+  }
+  for (int i = 0; i < n; ++i) {
+    active[i] = true;
+    node_of[i] = i;
+    nodes[i].left = -1;
+    nodes[i].right = -1;
+    nodes[i].size = 1;
+    nodes[i].height = 0;
+  }
+  for (int i = 0; i < n; ++i) {
+    near[i] = nearest(D, n, active, i);
+  }
+  for (int step = 0; step < n - 1; ++step) {
+    /*
+     * Closest pair of clusters, from the cached row minima
+     */
+    int i = -1;
+    for (int k = 0; k < n; ++k) {
+      if (active[k] && (i < 0 || D[(size_t)k * n + near[k]] <
+          D[(size_t)i * n + near[i]])) {
+        i = k;
+      }
+    }
+    int j = near[i];
+    if (j < i) {
+      const int tmp = i;
+      i = j;
+      j = tmp;
+    }
+    const int kNode = n + step;
+    const int kSizeI = nodes[node_of[i]].size;
+    const int kSizeJ = nodes[node_of[j]].size;
+    nodes[kNode].left = node_of[i];
+    nodes[kNode].right = node_of[j];
+    nodes[kNode].size = kSizeI + kSizeJ;
+    nodes[kNode].height = D[(size_t)i * n + j] / 2;
+    node_of[i] = kNode;
+    active[j] = false;
+    for (int k = 0; k < n; ++k) {
+      if (active[k] && k != i) {
+        const double kDist = (kSizeI * D[(size_t)i * n + k] +
+          kSizeJ * D[(size_t)j * n + k]) / (kSizeI + kSizeJ);
+        D[(size_t)i * n + k] = kDist;
+        D[(size_t)k * n + i] = kDist;
+      }
+    }
+    /*
+     * Only the rows whose nearest cluster was merged are rescanned, the other
+     * ones can only get closer to the new cluster
+     */
+    for (int k = 0; k < n; ++k) {
+      if (!active[k]) {
+        continue;
+      }
+      if (k == i || near[k] == i || near[k] == j) {
+        near[k] = nearest(D, n, active, k);
+      } else if (D[(size_t)k * n + i] < D[(size_t)k * n + near[k]]) {
+        near[k] = i;
+      }
+    }
+  }
+  free(D);
+  free(active);
+  free(node_of);
+  free(near);
+  return 2 * n - 2;
+}
@@ -0,0 +1,35 @@
+/*
+ * File:  guide_tree.h
+ * Author: Stefano Ribes
+ */
+#ifndef GUIDE_TREE_H_
+#define GUIDE_TREE_H_
+
+/*
+ * @brief      Node of a rooted binary tree. Leaves 0 .. n-1 are the
+ *             sequences, internal nodes n .. 2n-2 are created by the merges,
+ *             the root being the last one.
+ */
+typedef struct {
+  int left; // -1 for a leaf
+  int right;
+  int size; // Number of leaves
+  double height;
+} tree_node_t;
+
+/**
+ * @brief      Builds the UPGMA tree of a distance matrix: the two closest
+ *             clusters are merged at each step, and the distance of the new
+ *             cluster is the size-weighted mean of the merged ones. The row
+ *             minima are cached, so that a step only rescans the rows whose
+ *             nearest cluster was merged.
+ *
+ * @param[in]  dist   The n x n symmetric distance matrix, row-major
+ * @param[in]  n      The number of sequences
+ * @param      nodes  The 2n - 1 nodes of the tree
+ *
+ * @return     The root index, -1 if n is zero.
+ */
+int upgma(const float* dist, const int n, tree_node_t* nodes);
+
+#endif // end GUIDE_TREE_H_
@@ -0,0 +1,321 @@
+/*
+ * File:  hirschberg.c
+ * Author: Stefano Ribes
+ *
+ * Linear-space global alignment. Instead of splitting the problem at the
+ * middle column of the optimal path as in the textbook version, the forward
+ * pass propagates a "label" along the trace pointers, i.e. the cell where the
+ * trace of each cell leaves the middle row. This way the recovered path is the
+ * very same path followed by the full matrix traceback, ties included.
+ *
+ * Each sub-problem is a rectangle [i0, i1] x [j0, j1] of the full matrix whose
+ * first row (top) and first column (left) hold the exact scores of the full
+ * matrix. The traceback starts from its bottom-right cell and stops as soon as
+ * it reaches the first row or column of the rectangle.
+ */
+#include "hirschberg.h"
+
+#include <stdlib.h>
+
+typedef struct {
+  const char* X;
+  const char* Y;
+  const uint8_t* X_codes; // X and Y in the alphabet of the matrix
+  const uint8_t* Y_codes;
+  matrix_t matrix;
+  long leaf_cells;
+  char* alignX;
+  char* alignY;
+  int alignment_length;
+} hirschberg_t;
+
+static inline void emit(hirschberg_t* h, const char x, const char y) {
+  h->alignX[h->alignment_length] = x;
+  h->alignY[h->alignment_length] = y;
+  ++h->alignment_length;
+}
+
+/**
+ * @brief      Computes the score of cell (i, j) and its trace direction, using
+ *             the same tie breaking of the full matrix fill.
+ *
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  x       The encoded X symbol, i.e. X[i-1]
+ * @param[in]  y       The encoded Y symbol, i.e. Y[j-1]
+ * @param[in]  diag    The score of cell (i-1, j-1)
+ * @param[in]  up      The score of cell (i-1, j)
+ * @param[in]  left    The score of cell (i, j-1)
+ * @param      trace   The trace direction
+ *
+ * @return     The score of cell (i, j).
+ */
+static inline int cell_score(const matrix_t matrix, const uint8_t x,
+    const uint8_t y, const int diag, const int up, const int left,
+    int* trace) {
+  int score = diag + substitution_score(matrix, x, y);
+  *trace = DIAG;
+  if (up - GAP_PENALTY > score) {
+    score = up - GAP_PENALTY;
+    *trace = UP;
+  }
+  if (left - GAP_PENALTY > score) {
+    score = left - GAP_PENALTY;
+    *trace = LEFT;
+  }
+  return score;
+}
+
+/*
+ * The matrix parameter is a compile-time constant at every call site, so the
+ * compiler emits a specialised loop for each substitution matrix.
+ */
+static ALWAYS_INLINE void fill_row_matrix(const uint8_t* Y, const uint8_t x,
+    const int cols, const int* prev, int* curr, char* dirs,
+    const matrix_t matrix) {
+  for (int j = 1; j <= cols; ++j) {
+    int dir;
+    curr[j] = cell_score(matrix, x, Y[j-1], prev[j-1], prev[j], curr[j-1],
+      &dir);
+    dirs[j] = dir;
+  }
+}
+
+/**
+ * @brief      Fills columns 1 to cols of row i of a rectangle starting at
+ *             column j0. Column 0 of the row must be already set.
+ *
+ * @param[in]  h     The alignment state
+ * @param[in]  i     The row index in the full matrix
+ * @param[in]  j0    The first column of the rectangle
+ * @param[in]  cols  The number of columns to fill
+ * @param[in]  prev  The scores of row i - 1
+ * @param      curr  The scores of row i
+ * @param      dirs  The trace directions of row i
+ */
+static void fill_row(const hirschberg_t* h, const int i, const int j0,
+    const int cols, const int* prev, int* curr, char* dirs) {
+  const uint8_t* Y = h->Y_codes + j0;
+  const uint8_t x = h->X_codes[i-1];
+  switch (h->matrix) {
+    case MATRIX_DNA:
+      fill_row_matrix(Y, x, cols, prev, curr, dirs, MATRIX_DNA);
+      break;
+    case MATRIX_BLOSUM62:
+      fill_row_matrix(Y, x, cols, prev, curr, dirs, MATRIX_BLOSUM62);
+      break;
+    case MATRIX_PAM250:
+      fill_row_matrix(Y, x, cols, prev, curr, dirs, MATRIX_PAM250);
+      break;
+    default:
+      fill_row_matrix(Y, x, cols, prev, curr, dirs, MATRIX_IDENTITY);
+  }
+}
+
+/**
+ * @brief      Solves a small rectangle with a full score matrix.
+ *
+ * @return     The cell of the rectangle boundary reached by the traceback.
+ */
+static idx_t solve_full(hirschberg_t* h, const int i0, const int i1,
+    const int j0, const int j1, const int* top, const int* left) {
+  const int rows = i1 - i0;
+  const int cols = j1 - j0;
+  int* F = malloc(sizeof(int) * cell_idx(rows + 1, 0, cols));
+  char* trace = malloc(sizeof(char) * cell_idx(rows + 1, 0, cols));
+  for (int j = 0; j <= cols; ++j) {
+    F[cell_idx(0, j, cols)] = top[j];
+  }
+  for (int i = 1; i <= rows; ++i) {
+    F[cell_idx(i, 0, cols)] = left[i];
+    fill_row(h, i0 + i, j0, cols, F + cell_idx(i-1, 0, cols),
+      F + cell_idx(i, 0, cols), trace + cell_idx(i, 0, cols));
+  }
+  int i = rows;
+  int j = cols;
+  while (i > 0 && j > 0) {
+    switch (trace[cell_idx(i, j, cols)]) {
+      case DIAG:
+        emit(h, h->X[i0 + i - 1], h->Y[j0 + j - 1]);
+        --i;
+        --j;
+        break;
+      case LEFT:
+        emit(h, '-', h->Y[j0 + j - 1]);
+        --j;
+        break;
+      case UP:
+        emit(h, h->X[i0 + i - 1], '-');
+        --i;
+        break;
+    }
+  }
+  free(F);
+  free(trace);
+  idx_t end = {i0 + i, j0 + j};
+  return end;
+}
+
+/**
+ * @brief      Recursively solves a rectangle of the score matrix.
+ *
+ * @param      h     The alignment state
+ * @param[in]  i0    The first row of the rectangle
+ * @param[in]  i1    The last row of the rectangle
+ * @param[in]  j0    The first column of the rectangle
+ * @param[in]  j1    The last column of the rectangle
+ * @param[in]  top   The scores of row i0, columns j0 to j1
+ * @param[in]  left  The scores of column j0, rows i0 to i1
+ *
+ * @return     The cell of the rectangle boundary reached by the traceback.
+ */
+static idx_t solve(hirschberg_t* h, const int i0, const int i1, const int j0,
+    const int j1, const int* top, const int* left) {
+  if (i1 == i0 || j1 == j0) {
+    idx_t end = {i1, j1};
+    return end;
+  }
+  const int rows = i1 - i0;
+  const int cols = j1 - j0;
+  if (rows < 2 || (long)rows * (long)cols <= h->leaf_cells) {
+    return solve_full(h, i0, i1, j0, j1, top, left);
+  }
+  const int mid = i0 + rows / 2;
+  int* prev = malloc(sizeof(int) * (cols + 1));
+  int* curr = malloc(sizeof(int) * (cols + 1));
+  int* label_prev = malloc(sizeof(int) * (cols + 1));
+  int* label_curr = malloc(sizeof(int) * (cols + 1));
+  int* mid_row = malloc(sizeof(int) * (cols + 1));
+  char* dirs = malloc(sizeof(char) * (cols + 1));
+  /*
+   * Forward pass. A label >= 0 encodes the column (relative to j0) from which
+   * the trace leaves the middle row, together with the move (DIAG or UP). A
+   * negative label -(r + 1) means that the trace reaches the first column of
+   * the rectangle at row mid + r, without leaving the middle row.
+   */
+  for (int j = 0; j <= cols; ++j) {
+    prev[j] = top[j];
+  }
+  for (int i = i0 + 1; i <= i1; ++i) {
+    curr[0] = left[i - i0];
+    label_curr[0] = -(i - mid) - 1;
+    fill_row(h, i, j0, cols, prev, curr, dirs);
+    for (int j = 1; j <= cols && i >= mid; ++j) {
+      const int dir = dirs[j];
+      if (dir == LEFT) {
+        label_curr[j] = label_curr[j-1];
+      } else if (i == mid) {
+        label_curr[j] = j * 2 + (dir == DIAG);
+      } else {
+        label_curr[j] = (dir == DIAG) ? label_prev[j-1] : label_prev[j];
+      }
+    }
+    if (i == mid) {
+      for (int j = 0; j <= cols; ++j) {
+        mid_row[j] = curr[j];
+      }
+    }
+    int* tmp = prev;
+    prev = curr;
+    curr = tmp;
+    tmp = label_prev;
+    label_prev = label_curr;
+    label_curr = tmp;
+  }
+  const int label = label_prev[cols];
+  free(label_prev);
+  free(label_curr);
+  idx_t c;
+  if (label < 0) {
+    /*
+     * The trace never leaves the lower half: solve it and walk the middle row
+     * up to the first column.
+     */
+    free(prev);
+    free(curr);
+    free(dirs);
+    c = solve(h, mid, i1, j0, j1, mid_row, left + (mid - i0));
+    if (c.x == mid) {
+      for (int j = c.y; j > j0; --j) {
+        emit(h, '-', h->Y[j-1]);
+      }
+      c.y = j0;
+    }
+    free(mid_row);
+    return c;
+  }
+  const int k = label / 2;
+  const int jx = j0 + k;
+  const int is_diag = label & 1;
+  /*
+   * Second pass on the lower half, restricted to columns up to jx, in order to
+   * get the scores of column jx, i.e. the first column of the lower
+   * sub-problem.
+   */
+  int* mid_col = malloc(sizeof(int) * (i1 - mid + 1));
+  for (int j = 0; j <= k; ++j) {
+    prev[j] = mid_row[j];
+  }
+  mid_col[0] = mid_row[k];
+  for (int i = mid + 1; i <= i1; ++i) {
+    curr[0] = left[i - i0];
+    fill_row(h, i, j0, k, prev, curr, dirs);
+    mid_col[i - mid] = curr[k];
+    int* tmp = prev;
+    prev = curr;
+    curr = tmp;
+  }
+  free(prev);
+  free(curr);
+  free(dirs);
+  c = solve(h, mid, i1, jx, j1, mid_row + k, mid_col);
+  free(mid_row);
+  free(mid_col);
+  /*
+   * Walk to the exit cell (mid, jx) and leave the middle row.
+   */
+  for (int i = c.x; i > mid; --i) {
+    emit(h, h->X[i-1], '-');
+  }
+  for (int j = c.y; j > jx; --j) {
+    emit(h, '-', h->Y[j-1]);
+  }
+  int jy = jx;
+  if (is_diag) {
+    emit(h, h->X[mid-1], h->Y[jx-1]);
+    --jy;
+  } else {
+    emit(h, h->X[mid-1], '-');
+  }
+  return solve(h, i0, mid - 1, j0, jy, top, left);
+}
+
+int hirschberg_align(const char* X, const char* Y, const int m, const int n,
+    const matrix_t matrix, const long leaf_cells, char* alignX, char* alignY) {
+  uint8_t* X_codes = encode_sequence(matrix, X, m);
+  uint8_t* Y_codes = encode_sequence(matrix, Y, n);
+  hirschberg_t h = {X, Y, X_codes, Y_codes, matrix, leaf_cells, alignX, alignY,
+    0};
+  int* top = malloc(sizeof(int) * (n + 1));
+  int* left = malloc(sizeof(int) * (m + 1));
+  for (int j = 0; j <= n; ++j) {
+    top[j] = -GAP_PENALTY * j;
+  }
+  for (int i = 0; i <= m; ++i) {
+    left[i] = -GAP_PENALTY * i;
+  }
+  idx_t c = solve(&h, 0, m, 0, n, top, left);
+  free(top);
+  free(left);
+  free(X_codes);
+  free(Y_codes);
+  /*
+   * Unaligned beginning
+   */
+  for (int i = c.x; i > 0; --i) {
+    emit(&h, X[i-1], '-');
+  }
+  for (int j = c.y; j > 0; --j) {
+    emit(&h, '-', Y[j-1]);
+  }
+  return h.alignment_length;
+}
@@ -0,0 +1,38 @@
+/*
+ * File:  hirschberg.h
+ * Author: Stefano Ribes
+ */
+#ifndef HIRSCHBERG_H_
+#define HIRSCHBERG_H_
+
+#include "alignment.h"
+#include "scoring.h"
+
+/**
+ * @brief      Global alignment in linear space (Hirschberg's divide and
+ *             conquer). The matrix is never stored: the rows are recomputed
+ *             on the fly and only the sub-problems smaller than leaf_cells are
+ *             solved with a full (heap allocated) score matrix.
+ *
+ *             The returned alignment is exactly the one found by the full
+ *             matrix traceback of global_alignment.c, i.e. ties are broken
+ *             preferring DIAG, then UP, then LEFT.
+ *
+ * @param[in]  X           The X input sequence
+ * @param[in]  Y           The Y input sequence
+ * @param[in]  m           The length of the X sequence
+ * @param[in]  n           The length of the Y sequence
+ * @param[in]  matrix      The substitution matrix
+ * @param[in]  leaf_cells  The maximum number of cells of a sub-problem solved
+ *                         with a full matrix
+ * @param      alignX      The aligned X sequence, stored backwards (at least
+ *                         m + n characters)
+ * @param      alignY      The aligned Y sequence, stored backwards (at least
+ *                         m + n characters)
+ *
+ * @return     The alignment length.
+ */
+int hirschberg_align(const char* X, const char* Y, const int m, const int n,
+    const matrix_t matrix, const long leaf_cells, char* alignX, char* alignY);
+
+#endif // end HIRSCHBERG_H_
@@ -0,0 +1,239 @@
+/*
+ * File:  kmer_index.c
+ * Author: Stefano Ribes
+ *
+ * Sampled k-mer index. The entries are generated in position order and sorted
+ * by k-mer with a stable LSD radix sort, 8 bits per pass, so that the
+ * positions of each k-mer stay in ascending order.
+ */
+#include "kmer_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+/**
+ * @brief      Visits the indexed k-mers of a text, in position order.
+ *
+ * @param[in]  text     The text
+ * @param[in]  length   The length of the text
+ * @param[in]  k        The k-mer length
+ * @param[in]  step     The distance between indexed k-mers
+ * @param      entries  The entries to fill, NULL to only count them
+ *
+ * @return     The number of indexed k-mers.
+ */
+static size_t collect_kmers(const char* text, const size_t length, const int k,
+    const int step, uint64_t* entries) {
+  const uint32_t kMask = k == 16 ? 0xFFFFFFFFu : (1u << (2 * k)) - 1;
+  uint32_t kmer = 0;
+  int run = 0; // Number of valid characters ending at the current one
+  size_t num_entries = 0;
+  for (size_t p = 0; p < length; ++p) {
+    const int kCode = kmer_base_code(text[p]);
+    if (kCode < 0) {
+      run = 0;
+      continue;
+    }
+    kmer = ((kmer << 2) | kCode) & kMask;
+    ++run;
+    const size_t kStart = p + 1 - k;
+    if (run >= k && kStart % step == 0) {
+      if (entries != NULL) {
+        entries[num_entries] = ((uint64_t)kmer << 32) | kStart;
+      }
+      ++num_entries;
+    }
+  }
+  return num_entries;
+}
+
+/**
+ * @brief      Visits the indexed k-mers of the packed sequences of a store, in
+ *             position order. The position of symbol i of a sequence is its
+ *             first packed word times the symbols per word, plus i.
+ *
+ * @param[in]  store    The store, of DNA sequences
+ * @param[in]  k        The k-mer length
+ * @param[in]  step     The distance between indexed k-mers, within each
+ *                      sequence
+ * @param      entries  The entries to fill, NULL to only count them
+ *
+ * @return     The number of indexed k-mers.
+ */
+static size_t collect_store_kmers(const seq_store_t* store, const int k,
+    const int step, uint64_t* entries) {
+  const uint32_t kMask = k == 16 ? 0xFFFFFFFFu : (1u << (2 * k)) - 1;
+  const size_t kSymbols = seq_store_symbols_per_word(store);
+  size_t num_entries = 0;
+  for (int s = 0; s < store->num_sequences; ++s) {
+    const seq_view_t kView = seq_store_view(store, s);
+    const size_t kBase = store->records[s].word_offset * kSymbols;
+    uint32_t kmer = 0;
+    int run = 0;
+    size_t amb = 0; // Next ambiguous run
+    for (size_t i = 0; i < kView.length; ++i) {
+      if (amb < kView.num_amb && i == kView.amb[amb].start) {
+        i += kView.amb[amb].length - 1; // Skip the N
+        ++amb;
+        run = 0;
+        continue;
+      }
+      const int kCode = seq_view_code(&kView, i);
+      kmer = ((kmer << 2) | kCode) & kMask;
+      ++run;
+      const size_t kStart = i + 1 - k;
+      if (run >= k && kStart % step == 0) {
+        if (entries != NULL) {
+          entries[num_entries] = ((uint64_t)kmer << 32) | (kBase + kStart);
+        }
+        ++num_entries;
+      }
+    }
+  }
+  return num_entries;
+}
+
+/**
+ * @brief      Collects the k-mers of a text, or of a store if not NULL, and
+ *             sorts them.
+ *
+ * @return     Zero on success, non-zero if the allocation fails.
+ */
+static int sort_entries(kmer_index_t* index, const char* text,
+    const size_t length, const seq_store_t* store) {
+  const int kBits = 2 * index->k;
+  const int kPrefixBits = kBits - index->prefix_shift;
+  index->num_entries = store ?
+    collect_store_kmers(store, index->k, index->step, NULL) :
+    collect_kmers(text, length, index->k, index->step, NULL);
+  index->entries = malloc(sizeof(uint64_t) * (index->num_entries + 1));
+  uint64_t* tmp = malloc(sizeof(uint64_t) * (index->num_entries + 1));
+  index->prefixes = calloc(((size_t)1 << kPrefixBits) + 1, sizeof(size_t));
+  if (index->entries == NULL || tmp == NULL || index->prefixes == NULL) {
+    free(tmp);
+    kmer_index_free(index);
+    return 1;
+  }
+  if (store) {
+    collect_store_kmers(store, index->k, index->step, index->entries);
+  } else {
+    collect_kmers(text, length, index->k, index->step, index->entries);
+  }
+  /*
+   * LSD radix sort on the k-mer bits, i.e. bits 32 .. 32 + 2k of the entries
+   */
+  for (int shift = 32; shift < 32 + kBits; shift += RADIX_BITS) {
+    size_t counts[RADIX_SIZE + 1] = {0};
+    for (size_t e = 0; e < index->num_entries; ++e) {
+      ++counts[((index->entries[e] >> shift) & (RADIX_SIZE - 1)) + 1];
+    }
+    for (int r = 0; r < RADIX_SIZE; ++r) {
+      counts[r+1] += counts[r];
+    }
+    for (size_t e = 0; e < index->num_entries; ++e) {
+      const uint64_t kEntry = index->entries[e];
+      tmp[counts[(kEntry >> shift) & (RADIX_SIZE - 1)]++] = kEntry;
+    }
+    uint64_t* swap = index->entries;
+    index->entries = tmp;
+    tmp = swap;
+  }
+  free(tmp);
+  /*
+   * Prefix table: prefixes[p] is the first entry whose prefix is at least p
+   */
+  for (size_t e = 0; e < index->num_entries; ++e) {
+    ++index->prefixes[(index->entries[e] >> (32 + index->prefix_shift)) + 1];
+  }
+  for (size_t p = 0; p < ((size_t)1 << kPrefixBits); ++p) {
+    index->prefixes[p+1] += index->prefixes[p];
+  }
+  return 0;
+}
+
+/**
+ * @brief      Sets the parameters of an empty index.
+ *
+ * @return     Zero on success, non-zero on invalid parameters.
+ */
+static int init_index(kmer_index_t* index, const int k, const int step) {
+  memset(index, 0, sizeof(kmer_index_t));
+  if (k < 1 || k > KMER_MAX_K || step < 1) {
+    return 1;
+  }
+  const int kBits = 2 * k;
+  index->k = k;
+  index->step = step;
+  index->prefix_shift = kBits < KMER_PREFIX_BITS ? 0 :
+    kBits - KMER_PREFIX_BITS;
+  return 0;
+}
+
+int kmer_index_build(kmer_index_t* index, const char* text,
+    const size_t length, const int k, const int step) {
+  if (init_index(index, k, step) || length >= ((size_t)1 << 32)) {
+    return 1;
+  }
+  return sort_entries(index, text, length, NULL);
+}
+
+int kmer_index_build_store(kmer_index_t* index, const seq_store_t* store,
+    const int k, const int step) {
+  size_t end = 0; // Position past the last symbol
+  if (store->num_sequences > 0) {
+    const seq_record_t* kLast = &store->records[store->num_sequences - 1];
+    end = kLast->word_offset * seq_store_symbols_per_word(store) +
+      kLast->length;
+  }
+  if (init_index(index, k, step) || store->alphabet != MATRIX_DNA ||
+      end >= ((size_t)1 << 32)) {
+    return 1;
+  }
+  return sort_entries(index, NULL, 0, store);
+}
+
+size_t kmer_index_lookup(const kmer_index_t* index, const uint32_t kmer,
+    size_t* first) {
+  const uint32_t kPrefix = kmer >> index->prefix_shift;
+  size_t lo = index->prefixes[kPrefix];
+  size_t hi = index->prefixes[kPrefix + 1];
+  if (index->prefix_shift > 0) {
+    /*
+     * Binary search of the k-mer range within the prefix range
+     */
+    size_t a = lo;
+    size_t b = hi;
+    while (a < b) {
+      const size_t kMid = a + (b - a) / 2;
+      if ((uint32_t)(index->entries[kMid] >> 32) < kmer) {
+        a = kMid + 1;
+      } else {
+        b = kMid;
+      }
+    }
+    lo = a;
+    b = hi;
+    while (a < b) {
+      const size_t kMid = a + (b - a) / 2;
+      if ((uint32_t)(index->entries[kMid] >> 32) <= kmer) {
+        a = kMid + 1;
+      } else {
+        b = kMid;
+      }
+    }
+    hi = a;
+  }
+  *first = lo;
+  return hi - lo;
+}
+
+void kmer_index_free(kmer_index_t* index) {
+  free(index->entries);
+  free(index->prefixes);
+  index->entries = NULL;
+  index->prefixes = NULL;
+  index->num_entries = 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * File:  kmer_index.h
+ * Author: Stefano Ribes
+ */
+#ifndef KMER_INDEX_H_
+#define KMER_INDEX_H_
+
+#include "seq_store.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KMER_MAX_K 16 // A k-mer is packed in 2 bits per base, in 32 bits
+#define KMER_PREFIX_BITS 20 // Bits of the k-mer prefix table
+
+/**
+ * @brief      Gets the 2-bit code of a nucleotide: ACGT, either case, and U
+ *             as T.
+ *
+ * @param[in]  c     The nucleotide
+ *
+ * @return     The code, -1 for any other character.
+ */
+static inline int kmer_base_code(const char c) {
+  switch (c) {
+    case 'A': case 'a':
+      return 0;
+    case 'C': case 'c':
+      return 1;
+    case 'G': case 'g':
+      return 2;
+    case 'T': case 't': case 'U': case 'u':
+      return 3;
+    default:
+      return -1;
+  }
+}
+
+/*
+ * @brief      Index of the k-mers of a text: a sorted array of packed k-mers,
+ *             each one next to its position in the text. The array is sorted
+ *             by k-mer, then by position, and a table over the k-mer prefixes
+ *             narrows down the binary search of a lookup.
+ *
+ *             Only the k-mers starting at a multiple of step are indexed:
+ *             any exact match of at least k + step - 1 bases still contains
+ *             an indexed k-mer. The k-mers holding a character other than
+ *             ACGT are skipped.
+ */
+typedef struct {
+  int k;
+  int step;
+  int prefix_shift; // Shift from a k-mer to its prefix
+  uint64_t* entries; // (k-mer << 32) | position
+  size_t num_entries;
+  size_t* prefixes; // First entry of each prefix, plus one past the end
+} kmer_index_t;
+
+/**
+ * @brief      Builds the index of a text.
+ *
+ * @param      index   The index
+ * @param[in]  text    The text
+ * @param[in]  length  The length of the text, less than 2^32
+ * @param[in]  k       The k-mer length, at most KMER_MAX_K
+ * @param[in]  step    The distance between indexed k-mers
+ *
+ * @return     Zero on success, non-zero on invalid parameters or if the
+ *             allocation fails.
+ */
+int kmer_index_build(kmer_index_t* index, const char* text,
+    const size_t length, const int k, const int step);
+
+/**
+ * @brief      Builds the index of the packed sequences of a store. The
+ *             position of symbol i of a sequence is its first packed word
+ *             times seq_store_symbols_per_word(), plus i, so that no k-mer
+ *             spans two sequences. The k-mers overlapping an ambiguous run of
+ *             the store are skipped.
+ *
+ * @param      index  The index
+ * @param[in]  store  The store, of DNA sequences
+ * @param[in]  k      The k-mer length, at most KMER_MAX_K
+ * @param[in]  step   The distance between indexed k-mers, within each
+ *                    sequence
+ *
+ * @return     Zero on success, non-zero on invalid parameters, a protein
+ *             store, or if the allocation fails.
+ */
+int kmer_index_build_store(kmer_index_t* index, const seq_store_t* store,
+    const int k, const int step);
+
+/**
+ * @brief      Finds the positions of a k-mer.
+ *
+ * @param[in]  index  The index
+ * @param[in]  kmer   The packed k-mer
+ * @param      first  The first entry of the k-mer
+ *
+ * @return     The number of entries of the k-mer, whose positions are the low
+ *             32 bits of index->entries[*first ...].
+ */
+size_t kmer_index_lookup(const kmer_index_t* index, const uint32_t kmer,
+    size_t* first);
+
+/**
+ * @brief      Releases the index.
+ *
+ * @param      index  The index
+ */
+void kmer_index_free(kmer_index_t* index);
+
+#endif // end KMER_INDEX_H_
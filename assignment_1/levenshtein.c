@@ -5,12 +5,14 @@
  *
  * @details    To compile this C program, type:
  *
- *             gcc -O3 -std=c99 levenshtein.c -o levenshtein.exe
+ *             gcc -O3 -std=c99 levenshtein.c myers.c -o levenshtein.exe
  *
  *             To run the program, type:
  *
  *             ./levenshtein.exe
  */
+#include "myers.h"
+
 #include <stdio.h>
 
 #define MAX_LENGTH 100
@@ -24,39 +26,6 @@
 #define LEFT 2
 #define DIAG 3
 
-/**
- * @brief      Calculate Levenshtein distance between two sequences.
- *
- * @param[in]  length_a  The length of sequence a
- * @param[in]  length_b  The length of sequence b
- * @param[in]  start_a   The start index of a
- * @param[in]  start_b   The start index of b
- * @param      a         The a sequence
- * @param      b         The b sequence
- *
- * @return     The Levenshtein distance
- */
-int levenshtein(const int length_a, const int length_b, const int start_a,
-    const int start_b, char* const a, char* const b) {
-  // NOTE: Increasing the start index effectively translates to taking the tail
-  // of the string.
-  if (start_b == length_b) {
-    return length_a - start_a;
-  }
-  if (start_a == length_a) {
-    return length_b - start_b;
-  }
-  if (a[start_a] == b[start_b]) {
-    return levenshtein(length_a, length_b, start_a + 1, start_b + 1, a, b);
-  }
-  int min = levenshtein(length_a, length_b, start_a + 1, start_b, a, b);
-  int tmp = levenshtein(length_a, length_b, start_a, start_b + 1, a, b);
-  min = (tmp < min) ? tmp : min;
-  tmp = levenshtein(length_a, length_b, start_a + 1, start_b + 1, a, b);
-  min = (tmp < min) ? tmp : min;
-  return 1 + min;
-}
-
 int main() {
   int i, j;
   int m, n;
@@ -206,8 +175,9 @@ int main() {
   }
   printf("\n");
   const float perc_identity = (float)match_cnt / (float)alignment_length * 100.;
-  const int lev_dist = levenshtein(alignment_length, alignment_length, 0, 0,
-                                   alignX, alignY);
+  // NOTE: The distance is computed on the input sequences, not on the aligned
+  // ones, with the bit-parallel algorithm in myers.c.
+  const int lev_dist = myers_distance(X, m, Y, n, -1);
   printf("[INFO] Percent identity: %.2f%\n", perc_identity);
   printf("[INFO] Levenshtein dist: %d\n", lev_dist);
   return 0;
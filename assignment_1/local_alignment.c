@@ -5,62 +5,390 @@
  *
  * @details    To compile this C program, type:
  *
- *             gcc -O3 -std=c99 local_alignment.c -o local_alignment.exe
+ *             make local_alignment.exe
  *
  *             To run the program, type:
  *
- *             ./local_alignment.exe
+ *             ./local_alignment.exe [--mem-budget MB] [--threads N]
+ *               [--isa scalar|sse4.1|avx2|avx512bw]
+ *               [--matrix identity|dna|blosum62|pam250] [--gap-open O]
+ *               [--gap-extend E] [--top K [--min-score S]]
+ *               [--quiet] [--print-matrix] [--input FILE | X Y]
+ *
+ *             With --input, X and Y are the first two sequences of a FASTA
+ *             file (or of a file with one sequence per line), so that they
+ *             are not limited by the size of the command line.
+ *
+ *             The best score and its end cell are found with the striped SIMD
+ *             kernel, in linear space. A reverse pass from the end cell, also
+ *             in linear space, finds where the optimal alignments may start,
+ *             and the traceback only fills that L1xL2 region, in parallel by
+ *             tiles along the anti-diagonals, into a packed traceback of 4 bits
+ *             per cell: O(m + n + L1 L2) memory. When the packed traceback of
+ *             the region does not fit in the memory budget (in MB), the
+ *             alignment from the farthest start cell to the end cell is
+ *             computed in linear space with Hirschberg's algorithm instead: it
+ *             is an optimal local alignment, but it may break ties
+ *             differently.
+ *
+ *             The striped kernel is built for each instruction set and the
+ *             most capable one supported by the processor is used, unless
+ *             another one is picked with --isa.
+ *
+ *             A gap of length k costs O + k * E, by default O = 0 and
+ *             E = GAP_PENALTY. Any other gap cost is aligned with the affine
+ *             (Gotoh) engine, which replaces both the striped kernel and the
+ *             traceback fill.
+ *
+ *             With --top, the K best non-overlapping local alignments
+ *             scoring at least S (1 by default) are printed instead, as found
+ *             by the Waterman-Eggert search: each one is the best alignment
+ *             sharing no cell with the previous ones. It keeps the full score
+ *             matrix, which must fit in the memory budget, and only supports
+ *             the linear gap cost.
+ *
+ *             The substitution matrix defaults to the identity one, i.e.
+ *             MATCH_SCORE and MISMATCH_SCORE.
+ *
+ *             With --print-matrix, the score and trace matrices of short
+ *             sequences are printed. With --quiet, only the alignments are
+ *             printed, one "X x_start x_end Y y_start y_end score identity
+ *             CIGAR" record each (see align_output.h), the names being the
+ *             ones of the input file, if any, and all the records are written
+ *             at once.
  */
+#include "align_output.h"
+#include "alignment.h"
+#include "cpu_dispatch.h"
+#include "gotoh.h"
+#include "hirschberg.h"
+#include "sequence_io.h"
+#include "sw_reverse.h"
+#include "sw_striped.h"
+#include "waterman_eggert.h"
+#include "wavefront.h"
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
 
-#define MAX_LENGTH 100
+#define MAX_LENGTH 100 // Longest sequences whose matrices are printed
+#define DEFAULT_MEM_BUDGET_MB 256
 
-#define MATCH_SCORE 2
-#define MISMATCH_SCORE -1
-#define GAP_PENALTY 2
+#define USAGE "ERROR. Usage: %s [--mem-budget MB] [--threads N] " \
+  "[--isa scalar|sse4.1|avx2|avx512bw] " \
+  "[--matrix identity|dna|blosum62|pam250] [--gap-open O] [--gap-extend E] " \
+  "[--top K [--min-score S]] [--quiet] [--print-matrix] " \
+  "[--input FILE | X Y]\n"
+
+/**
+ * @brief      Gets the elapsed time in seconds since a given time point.
+ *
+ * @param[in]  start  The start time point
+ *
+ * @return     The elapsed time in seconds.
+ */
+static double elapsed_time(const struct timespec start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+/**
+ * @brief      Local alignment with affine gap costs. The best score and its
+ *             cell are found in linear space, then the traceback runs on the
+ *             window of the matrix ending at the best cell, doubling it until
+ *             it holds the whole alignment.
+ *
+ * @param[in]  X       The X input sequence
+ * @param[in]  m       The length of the X sequence
+ * @param[in]  Y       The Y input sequence
+ * @param[in]  n       The length of the Y sequence
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  gap     The gap costs
+ * @param[in]  x_name  The name of X
+ * @param[in]  y_name  The name of Y
+ * @param      out     The buffer of the alignment record, NULL to print the
+ *                     alignment instead
+ */
+static void align_affine(const char* X, const int m, const char* Y,
+    const int n, const matrix_t matrix, const gap_cost_t gap,
+    const char* x_name, const char* y_name, out_buffer_t* out) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  const gotoh_result_t best = gotoh_align(X, m, Y, n, matrix, gap, true,
+    NULL, NULL);
+  const double kSeconds = elapsed_time(start);
+  if (out == NULL) {
+    printf("[INFO] Best score %d at position (%d, %d)\n", best.score,
+      best.end_i, best.end_j);
+    printf("[INFO] GCUPS: %.3f (affine gaps, scalar, %.6f s)\n",
+      (double)m * (double)n / (kSeconds > 0 ? kSeconds : 1e-9) * 1e-9,
+      kSeconds);
+  }
+  char* alignX = malloc(sizeof(char) * (best.end_i + best.end_j + 1));
+  char* alignY = malloc(sizeof(char) * (best.end_i + best.end_j + 1));
+  int window = best.score + 1;
+  int i0, j0;
+  gotoh_result_t result;
+  while (true) {
+    i0 = best.end_i > window ? best.end_i - window : 0;
+    j0 = best.end_j > window ? best.end_j - window : 0;
+    result = gotoh_align(X + i0, best.end_i - i0, Y + j0, best.end_j - j0,
+      matrix, gap, true, alignX, alignY);
+    if (result.score == best.score || (i0 == 0 && j0 == 0)) {
+      break;
+    }
+    window *= 2;
+  }
+  if (out != NULL) {
+    out_alignment(out, x_name, i0 + result.start_i - 1, best.end_i, y_name,
+      j0 + result.start_j - 1, best.end_j, best.score, result.length, alignX,
+      alignY);
+  } else {
+    printf("[INFO] Alignment from (%d, %d) to (%d, %d)\n",
+      i0 + result.start_i - 1, j0 + result.start_j - 1, best.end_i,
+      best.end_j);
+    print_alignment(result.length, alignX, alignY);
+  }
+  free(alignX);
+  free(alignY);
+}
 
-#define STOP 0
-#define UP 1
-#define LEFT 2
-#define DIAG 3
+/**
+ * @brief      Prints the K best non-overlapping local alignments.
+ *
+ * @param[in]  X              The X input sequence
+ * @param[in]  m              The length of the X sequence
+ * @param[in]  Y              The Y input sequence
+ * @param[in]  n              The length of the Y sequence
+ * @param[in]  matrix         The substitution matrix
+ * @param[in]  k              The maximum number of alignments
+ * @param[in]  min_score      The minimum score of an alignment
+ * @param[in]  mem_budget_mb  The memory budget, in MB
+ * @param[in]  x_name         The name of X
+ * @param[in]  y_name         The name of Y
+ * @param      out            The buffer of the alignment records, NULL to
+ *                            print the alignments instead
+ */
+static void align_top(const char* X, const int m, const char* Y, const int n,
+    const matrix_t matrix, const int k, const int min_score,
+    const long mem_budget_mb, const char* x_name, const char* y_name,
+    out_buffer_t* out) {
+  if (waterman_eggert_bytes(m, n, k) > (size_t)mem_budget_mb * 1024 * 1024) {
+    fprintf(stderr, "ERROR. The %dx%d score matrix exceeds the %ld MB memory "
+      "budget\n", m, n, mem_budget_mb);
+    exit(1);
+  }
+  local_hit_t* hits = malloc(sizeof(local_hit_t) * (k + 1));
+  if (hits == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate %d alignments\n", k);
+    exit(1);
+  }
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  const int kNumHits = waterman_eggert(X, m, Y, n, matrix, k, min_score, hits);
+  if (out != NULL) {
+    for (int h = 0; h < kNumHits; ++h) {
+      out_alignment(out, x_name, hits[h].start_i, hits[h].end_i, y_name,
+        hits[h].start_j, hits[h].end_j, hits[h].score, hits[h].length,
+        hits[h].alignX, hits[h].alignY);
+    }
+    local_hits_free(hits, kNumHits);
+    free(hits);
+    return;
+  }
+  printf("[INFO] %d non-overlapping alignments found in %.6f s\n", kNumHits,
+    elapsed_time(start));
+  for (int h = 0; h < kNumHits; ++h) {
+    printf("[INFO] Alignment %d: score %d from (%d, %d) to (%d, %d)\n", h + 1,
+      hits[h].score, hits[h].start_i, hits[h].start_j, hits[h].end_i,
+      hits[h].end_j);
+    print_alignment(hits[h].length, hits[h].alignX, hits[h].alignY);
+  }
+  local_hits_free(hits, kNumHits);
+  free(hits);
+}
 
 int main(int argc, char** argv) {
   int i, j;
   int m, n;
-  int alignment_length, score;
-  char X[MAX_LENGTH + 1] = "PAWHEAE";
-  char Y[MAX_LENGTH + 1] = "HDAGAWGHEQ";
+  int alignment_length;
+  const char* X = "PAWHEAE";
+  const char* Y = "HDAGAWGHEQ";
+  long mem_budget_mb = DEFAULT_MEM_BUDGET_MB;
+  int num_threads = omp_get_max_threads();
+  gap_cost_t gap = {0, GAP_PENALTY};
+  matrix_t matrix = MATRIX_IDENTITY;
+  const char* filename = NULL;
+  int top = 0;
+  int min_score = 1;
+  bool quiet = false;
+  bool print_matrix = false;
 
-  int F[MAX_LENGTH + 1][MAX_LENGTH + 1]; // score matrix
-  int trace[MAX_LENGTH + 1][MAX_LENGTH + 1]; // trace matrix
-  char alignX[MAX_LENGTH * 2]; // aligned X sequence
-  char alignY[MAX_LENGTH * 2]; // aligned Y sequence
+  int num_seqs = 0;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--mem-budget") == 0 && arg + 1 < argc) {
+      mem_budget_mb = atol(argv[++arg]);
+    } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+      num_threads = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--isa") == 0 && arg + 1 < argc) {
+      if (cpu_select_isa(argv[++arg])) {
+        fprintf(stderr, "ERROR. Unknown or unsupported instruction set %s\n",
+          argv[arg]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--matrix") == 0 && arg + 1 < argc) {
+      if (parse_matrix(argv[++arg], &matrix)) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--gap-open") == 0 && arg + 1 < argc) {
+      gap.open = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--gap-extend") == 0 && arg + 1 < argc) {
+      gap.extend = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--top") == 0 && arg + 1 < argc) {
+      top = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--min-score") == 0 && arg + 1 < argc) {
+      min_score = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--quiet") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[arg], "--print-matrix") == 0) {
+      print_matrix = true;
+    } else if (strcmp(argv[arg], "--input") == 0 && arg + 1 < argc) {
+      filename = argv[++arg];
+    } else if (num_seqs == 0) {
+      X = argv[arg];
+      ++num_seqs;
+    } else if (num_seqs == 1) {
+      Y = argv[arg];
+      ++num_seqs;
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  if (num_seqs == 1 || (filename != NULL && num_seqs != 0) || top < 0 ||
+      min_score < 1 || (top > 0 && (gap.open != 0 ||
+      gap.extend != GAP_PENALTY))) {
+    fprintf(stderr, USAGE, argv[0]);
+    exit(1);
+  }
+  sequence_t* sequences = NULL;
+  int num_sequences = 0;
+  const char* x_name = "X";
+  const char* y_name = "Y";
+  if (filename != NULL) {
+    sequences = read_sequences(filename, &num_sequences);
+    if (num_sequences < 2) {
+      fprintf(stderr, "ERROR. Expected two sequences in %s\n", filename);
+      exit(1);
+    }
+    X = sequences[0].seq;
+    Y = sequences[1].seq;
+    x_name = sequences[0].name;
+    y_name = sequences[1].name;
+  }
+  // NOTE: When quiet, all the records are written at once at the end.
+  out_buffer_t out;
+  out_init(&out, stdout, OUT_BUFFER_BYTES);
+  out_buffer_t* records = quiet ? &out : NULL;
   /*
    * Find lengths of (null-terminated) strings X and Y
    */
-  m = 0;
-  n = 0;
-  while (X[m] != 0) {
-    ++m;
+  m = seq_length(X);
+  n = seq_length(Y);
+  if (top > 0) {
+    align_top(X, m, Y, n, matrix, top, min_score, mem_budget_mb, x_name,
+      y_name, records);
+    out_free(&out);
+    free_sequences(sequences, num_sequences);
+    return 0;
   }
-  while (Y[n] != 0) {
-    ++n;
+  if (gap.open != 0 || gap.extend != GAP_PENALTY) {
+    align_affine(X, m, Y, n, matrix, gap, x_name, y_name, records);
+    out_free(&out);
+    free_sequences(sequences, num_sequences);
+    return 0;
   }
   /*
-   * Initialise matrices
+   * Find the best score and its cell with the striped kernel
    */
-  F[0][0] = 0;
-  trace[0][0] = STOP;
-  for (int i = 1; i <= m; ++i) {
-    F[i][0] = F[i-1][0];
-    trace[i][0] = STOP;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  const sw_result_t best = sw_striped(X, m, Y, n, matrix);
+  const double kSeconds = elapsed_time(start);
+  const int max_score = best.score;
+  const int max_i = best.max_i;
+  const int max_j = best.max_j;
+  if (!quiet) {
+    printf("[INFO] Best score %d at position (%d, %d)\n", max_score, max_i,
+      max_j);
+    printf("[INFO] GCUPS: %.3f (%d-bit lanes, %s, %.6f s)\n",
+      (double)m * (double)n / (kSeconds > 0 ? kSeconds : 1e-9) * 1e-9,
+      best.score_bits, best.score_bits ? isa_name(cpu_isa()) : "scalar",
+      kSeconds);
   }
-  for (int j = 1; j <= n; j++) {
-    F[0][j] = F[0][j-1];
-    trace[0][j] = STOP;
+  /*
+   * The traceback region is the rectangle of the matrix holding the optimal
+   * alignments ending at the best cell, found by a reverse pass from it.
+   * Short sequences use the whole matrix, which is printed on request.
+   */
+  const bool kIsShort = m <= MAX_LENGTH && n <= MAX_LENGTH;
+  idx_t corner = {0, 0};
+  idx_t farthest = {0, 0};
+  if (!kIsShort) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    corner = sw_start_corner(X, Y, matrix, max_i, max_j, max_score, &farthest);
+    if (!quiet) {
+      printf("[INFO] Start recovered in %.6f s, traceback of %dx%d cells\n",
+        elapsed_time(start), max_i - corner.x, max_j - corner.y);
+    }
   }
+  const int i0 = corner.x;
+  const int j0 = corner.y;
+  const int rows = kIsShort ? m : max_i - i0;
+  const int cols = kIsShort ? n : max_j - j0;
+  char* alignX = malloc(sizeof(char) * (rows + cols + 1)); // aligned X sequence
+  char* alignY = malloc(sizeof(char) * (rows + cols + 1)); // aligned Y sequence
+  /*
+   * Pick the traceback strategy: the packed traceback is used as long as it
+   * fits in the memory budget, otherwise switch to linear space.
+   */
+  const size_t kMemBudget = (size_t)mem_budget_mb * 1024 * 1024;
+  if (!kIsShort && trace_store_bytes(rows, cols) > kMemBudget) {
+    const long kLeafCells = kMemBudget / (sizeof(int) + sizeof(char));
+    if (!quiet) {
+      printf("[INFO] Linear-space (Hirschberg) traceback: %dx%d cells exceed "
+        "the %ld MB memory budget\n", rows, cols, mem_budget_mb);
+    }
+    alignment_length = hirschberg_align(X + farthest.x, Y + farthest.y,
+      max_i - farthest.x, max_j - farthest.y, matrix, kLeafCells, alignX,
+      alignY);
+    i = farthest.x;
+    j = farthest.y;
+  } else {
+    // NOTE: The score matrix is only needed to print it, i.e. on request and
+    // for short sequences.
+    const bool kPrintMatrix = print_matrix && kIsShort && !quiet;
+    int* F = kPrintMatrix ? malloc(sizeof(int) * cell_idx(m + 1, 0, n)) :
+      NULL;
+    trace_store_t trace;
+    if ((kPrintMatrix && F == NULL) || trace_store_init(&trace, rows, cols)) {
+      fprintf(stderr, "ERROR. Unable to allocate the %dx%d traceback "
+        "region\n", rows, cols);
+      exit(1);
+    }
+    /*
+     * Fill matrices
+     */
+    wavefront_fill_local(X + i0, Y + j0, rows, cols, matrix, F, &trace,
+      WAVEFRONT_TILE, num_threads);
 
-#define PRINT_MATRIX(m, n, x, y, f) printf("      "); \
+#define PRINT_MATRIX(m, n, x, y, value) printf("      "); \
   for (int j = 0; j < n; ++j) { \
     printf("%5c", y[j]); \
   } \
@@ -72,108 +400,68 @@ int main(int argc, char** argv) {
       printf("%c", x[i-1]); \
     } \
     for (int j = 0; j <= n; j++) { \
-      printf("%5d", f[i][j]); \
+      printf("%5d", value); \
     } \
     printf("\n"); \
   } \
   printf("\n");
 
-  /*
-   * Fill matrices
-   */
-  int max_i = 0;
-  int max_j = 0;
-  int max_score = -((1 << 30) - 1); // Fairly small number
-  for (int i = 1; i <= m; ++i) {
-    for (int j = 1; j <= n; j++) {
-      if (X[i-1] == Y[j-1]) {
-        score = F[i-1][j-1] + MATCH_SCORE;
-      } else {
-        score = F[i-1][j-1] + MISMATCH_SCORE;
-      }
-      trace[i][j] = DIAG;
-      int tmp = F[i-1][j] - GAP_PENALTY;
-      if (tmp > score) {
-        score = tmp;
-        trace[i][j] = UP;
-      }
-      tmp = F[i][j-1] - GAP_PENALTY;
-      if(tmp > score) {
-        score = tmp;
-        trace[i][j] = LEFT;
-      }
-      score = score > 0 ? score : 0;
-      F[i][j] = score;
-      // Keep track of highest score.
-      if (score > max_score) {
-        max_score = score;
-        max_i = i;
-        max_j = j;
-      }
-      // Stop trace if score is equal to zero.
-      if (score == 0) {
-        trace[i][j] = STOP;
-      }
+    /*
+     * Print score matrix
+     */
+    if (kPrintMatrix) {
+      printf("[INFO] Score matrix:\n");
+      PRINT_MATRIX(m, n, X, Y, F[cell_idx(i, j, n)]);
+      printf("[INFO] Trace matrix:\n");
+      PRINT_MATRIX(m, n, X, Y, trace_move(&trace, i, j));
     }
-  }
-  /*
-   * Print score matrix
-   */
-  printf("[INFO] Best score %d at position (%d, %d)\n", max_score, max_i, max_j);
-  printf("[INFO] Score matrix:\n");
-  PRINT_MATRIX(m, n, X, Y, F);
-  printf("[INFO] Trace matrix:\n");
-  PRINT_MATRIX(m, n, X, Y, trace);
-  /*
-   * Trace back from the maximum score coordinates of the matrix
-   */
-  i = max_i;
-  j = max_j;
-  alignment_length = 0;
-  while (trace[i][j] != STOP) {
-    switch (trace[i][j]) {
-      case DIAG:
-        alignX[alignment_length] = X[i-1];
-        alignY[alignment_length] = Y[j-1];
-        --i;
-        --j;
-        ++alignment_length;
-        break;
-      case LEFT:
-        alignX[alignment_length] = '-';
-        alignY[alignment_length] = Y[j-1];
-        --j;
-        ++alignment_length;
-        break;
-      case UP:
-        alignX[alignment_length] = X[i-1];
-        alignY[alignment_length] = '-';
-        --i;
-        ++alignment_length;
+    /*
+     * Trace back from the maximum score coordinates of the matrix
+     */
+    i = max_i - i0;
+    j = max_j - j0;
+    alignment_length = 0;
+    while (trace_move(&trace, i, j) != STOP) {
+      switch (trace_move(&trace, i, j)) {
+        case DIAG:
+          alignX[alignment_length] = X[i0+i-1];
+          alignY[alignment_length] = Y[j0+j-1];
+          --i;
+          --j;
+          ++alignment_length;
+          break;
+        case LEFT:
+          alignX[alignment_length] = '-';
+          alignY[alignment_length] = Y[j0+j-1];
+          --j;
+          ++alignment_length;
+          break;
+        case UP:
+          alignX[alignment_length] = X[i0+i-1];
+          alignY[alignment_length] = '-';
+          --i;
+          ++alignment_length;
+      }
     }
+    i += i0;
+    j += j0;
+    free(F);
+    trace_store_free(&trace);
   }
   /*
    * Print alignment
    */
-  for (i = alignment_length - 1; i >= 0; --i) {
-    printf("%c", alignX[i]);
-  }
-  printf("\n");
-  int match_cnt = 0;
-  for (i = alignment_length - 1; i >= 0; --i) {
-    if (alignX[i] == alignY[i]) {
-      printf("|");
-      ++match_cnt;
-    } else {
-      printf(" ");
-    }
-  }
-  printf("\n");
-  for (i = alignment_length - 1; i >= 0; --i) {
-    printf("%c", alignY[i]);
+  if (quiet) {
+    out_alignment(&out, x_name, i, max_i, y_name, j, max_j, max_score,
+      alignment_length, alignX, alignY);
+  } else {
+    printf("[INFO] Alignment from (%d, %d) to (%d, %d)\n", i, j, max_i,
+      max_j);
+    print_alignment(alignment_length, alignX, alignY);
   }
-  printf("\n\n");
-  printf("[INFO] Percent identity: %.2f%\n", (float)match_cnt / (float)alignment_length * 100.0);
-  printf("[INFO] Hamming distance: %d\n", alignment_length - match_cnt);
+  out_free(&out);
+  free(alignX);
+  free(alignY);
+  free_sequences(sequences, num_sequences);
   return 0;
-}
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+/*
+ * @author     Stefano Ribes
+ *
+ * @brief      Local alignment of one query against many targets.
+ *
+ * @details    To compile this C program, type:
+ *
+ *             make local_batch.exe
+ *
+ *             To run the program, type:
+ *
+ *             ./local_batch.exe [--isa scalar|sse4.1|avx2|avx512bw]
+ *               [--both-strands] QUERY targets.txt
+ *
+ *             The targets file is either in FASTA format or it holds one
+ *             sequence per line. For each target, the program prints its name,
+ *             the best local score and its end cell (query, target). With
+ *             --both-strands, the reverse complement of the query is scored
+ *             in the same pass over the targets, and the best strand ('+' or
+ *             '-') is printed after the end cell, whose query position is then
+ *             on the reverse complement. The
+ *             kernel runs on the most capable instruction set of the
+ *             processor, unless another one is picked with --isa. The
+ *             number of targets scored at each lane width (8, 16 or 32 bits)
+ *             is printed on the standard error.
+ */
+#include "alignment.h"
+#include "cpu_dispatch.h"
+#include "sequence_io.h"
+#include "sw_batch.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define USAGE "ERROR. Usage: %s [--isa scalar|sse4.1|avx2|avx512bw] " \
+  "[--both-strands] QUERY targets.txt\n"
+
+int main(int argc, char** argv) {
+  const char* args[2] = {NULL, NULL};
+  int num_args = 0;
+  bool both_strands = false;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--isa") == 0 && arg + 1 < argc) {
+      if (cpu_select_isa(argv[++arg])) {
+        fprintf(stderr, "ERROR. Unknown or unsupported instruction set %s\n",
+          argv[arg]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--both-strands") == 0) {
+      both_strands = true;
+    } else if (num_args < 2) {
+      args[num_args++] = argv[arg];
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  if (num_args != 2) {
+    fprintf(stderr, USAGE, argv[0]);
+    exit(1);
+  }
+  const char* X = args[0];
+  const int m = seq_length(X);
+  int num_targets = 0;
+  sequence_t* targets = read_sequences(args[1], &num_targets);
+  const char** seqs = malloc(sizeof(char*) * (num_targets + 1));
+  int* lengths = malloc(sizeof(int) * (num_targets + 1));
+  sw_result_t* results = malloc(sizeof(sw_result_t) * (num_targets + 1));
+  double num_cells = 0;
+  for (int k = 0; k < num_targets; ++k) {
+    seqs[k] = targets[k].seq;
+    lengths[k] = targets[k].length;
+    num_cells += (both_strands ? 2.0 : 1.0) * m * (double)lengths[k];
+  }
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (both_strands) {
+    sw_batch_strands(X, m, seqs, lengths, num_targets, results);
+  } else {
+    sw_batch(X, m, seqs, lengths, num_targets, results);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  const double kSeconds = (end.tv_sec - start.tv_sec) +
+    (end.tv_nsec - start.tv_nsec) * 1e-9;
+  for (int k = 0; k < num_targets; ++k) {
+    printf("%s\t%d\t%d\t%d", targets[k].name, results[k].score,
+      results[k].max_i, results[k].max_j);
+    printf(both_strands ? "\t%c\n" : "\n", results[k].strand);
+  }
+  fprintf(stderr, "[INFO] Scored %d targets in %.6f s: %.1f targets/s, "
+    "%.3f GCUPS (%s)\n", num_targets, kSeconds,
+    num_targets / (kSeconds > 0 ? kSeconds : 1e-9),
+    num_cells / (kSeconds > 0 ? kSeconds : 1e-9) * 1e-9, isa_name(cpu_isa()));
+  const sw_width_stats_t kWidths = sw_width_stats(results, num_targets);
+  fprintf(stderr, "[INFO] Lane widths: %d 8-bit, %d 16-bit, %d 32-bit, %d "
+    "scalar (%.1f%% re-scored)\n", kWidths.num_8, kWidths.num_16,
+    kWidths.num_32, kWidths.num_scalar, num_targets > 0 ?
+    100.0 * (kWidths.num_16 + kWidths.num_32) / num_targets : 0.0);
+  free_sequences(targets, num_targets);
+  free(seqs);
+  free(lengths);
+  free(results);
+  return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * File:  msa.c
+ * Author: Stefano Ribes
+ *
+ * The profile of an alignment holds, for each column, the count of each
+ * symbol of the compact alphabet (the matrix codes found in the sequences)
+ * plus the count of gaps. For the merge of profiles A and B, each column of A
+ * is first turned into the vector w of its scores against a single symbol
+ * (or gap) of B, so that a column pair is scored with a dot product of
+ * num_symbols + 1 terms.
+ */
+#include "msa.h"
+#include "pairwise.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+/*
+ * @brief      Compact alphabet of the sequences and its substitution scores.
+ */
+typedef struct {
+  uint8_t codes[256]; // Character to matrix code
+  int symbol_of[256]; // Character to symbol, num_symbols for a gap
+  int num_symbols;
+  float* scores; // num_symbols x num_symbols
+} msa_alphabet_t;
+
+/*
+ * @brief      Alignment of the sequences of a subtree.
+ */
+typedef struct {
+  int num_rows;
+  int length;
+  int* members; // Sequence of each row
+  char** rows;
+} cluster_t;
+
+static void* checked_malloc(const size_t size) {
+  void* data = malloc(size > 0 ? size : 1);
+  if (data == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate %zu bytes for the "
+      "alignment\n", size);
+    exit(1);
+  }
+  return data;
+}
+
+float* msa_distances(const sequence_t* seqs, const int num_seqs,
+    const int num_threads) {
+  float* dist = checked_malloc(sizeof(float) * num_seqs * num_seqs);
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+  for (int i = 0; i < num_seqs; ++i) {
+    query_profile_t query;
+    query_profile_init(&query, (const uint8_t*)seqs[i].seq, seqs[i].length,
+      METRIC_IDENTITY, MATRIX_IDENTITY);
+    dist[(size_t)i * num_seqs + i] = 0;
+    for (int j = i + 1; j < num_seqs; ++j) {
+      const float kDist = 1.0 - query_profile_compare(&query,
+        (const uint8_t*)seqs[j].seq, seqs[j].length) / 100.0;
+      dist[(size_t)i * num_seqs + j] = kDist;
+      dist[(size_t)j * num_seqs + i] = kDist;
+    }
+    query_profile_free(&query);
+  }
+  return dist;
+}
+
+static void init_alphabet(const sequence_t* seqs, const int num_seqs,
+    const matrix_t matrix, msa_alphabet_t* alphabet) {
+  build_symbol_codes(matrix, alphabet->codes);
+  int symbol_of_code[256];
+  for (int c = 0; c < 256; ++c) {
+    symbol_of_code[c] = -1;
+  }
+  uint8_t code_of[256];
+  alphabet->num_symbols = 0;
+  for (int s = 0; s < num_seqs; ++s) {
+    for (int i = 0; i < seqs[s].length; ++i) {
+      const uint8_t kCode = alphabet->codes[(uint8_t)seqs[s].seq[i]];
+      if (symbol_of_code[kCode] < 0) {
+        code_of[alphabet->num_symbols] = kCode;
+        symbol_of_code[kCode] = alphabet->num_symbols++;
+      }
+    }
+  }
+  const int K = alphabet->num_symbols;
+  for (int c = 0; c < 256; ++c) {
+    alphabet->symbol_of[c] = c == '-' ? K :
+      symbol_of_code[alphabet->codes[c]];
+  }
+  alphabet->scores = checked_malloc(sizeof(float) * K * K);
+  for (int a = 0; a < K; ++a) {
+    for (int b = 0; b < K; ++b) {
+      alphabet->scores[a * K + b] = substitution_score(matrix, code_of[a],
+        code_of[b]);
+    }
+  }
+}
+
+/**
+ * @brief      Counts the symbols and gaps of each column of an alignment.
+ *
+ * @return     The heap allocated length x (num_symbols + 1) counts.
+ */
+static float* build_profile(const cluster_t* cluster,
+    const msa_alphabet_t* alphabet) {
+  const int kStride = alphabet->num_symbols + 1;
+  float* counts = checked_malloc(sizeof(float) * cluster->length * kStride);
+  memset(counts, 0, sizeof(float) * cluster->length * kStride);
+  for (int r = 0; r < cluster->num_rows; ++r) {
+    const char* kRow = cluster->rows[r];
+    for (int i = 0; i < cluster->length; ++i) {
+      counts[(size_t)i * kStride + alphabet->symbol_of[(uint8_t)kRow[i]]] += 1;
+    }
+  }
+  return counts;
+}
+
+/**
+ * @brief      Turns the counts of the columns of profile A into their scores
+ *             against each symbol (or the gap) of profile B.
+ */
+static void build_weights(const float* counts, const int length,
+    const msa_alphabet_t* alphabet, float* weights) {
+  const int K = alphabet->num_symbols;
+  for (int i = 0; i < length; ++i) {
+    const float* restrict kCounts = counts + (size_t)i * (K + 1);
+    float* restrict w = weights + (size_t)i * (K + 1);
+    float residues = 0;
+    for (int b = 0; b < K; ++b) {
+      w[b] = -GAP_PENALTY * kCounts[K];
+    }
+    for (int a = 0; a < K; ++a) {
+      if (kCounts[a] != 0) {
+        residues += kCounts[a];
+        for (int b = 0; b < K; ++b) {
+          w[b] += kCounts[a] * alphabet->scores[a * K + b];
+        }
+      }
+    }
+    w[K] = -GAP_PENALTY * residues;
+  }
+}
+
+static cluster_t* new_cluster(const int num_rows, const int length) {
+  cluster_t* cluster = checked_malloc(sizeof(cluster_t));
+  cluster->num_rows = num_rows;
+  cluster->length = length;
+  cluster->members = checked_malloc(sizeof(int) * num_rows);
+  cluster->rows = checked_malloc(sizeof(char*) * num_rows);
+  for (int r = 0; r < num_rows; ++r) {
+    cluster->rows[r] = checked_malloc(sizeof(char) * (length + 1));
+    cluster->rows[r][length] = '\0';
+  }
+  return cluster;
+}
+
+static void free_cluster(cluster_t* cluster) {
+  for (int r = 0; r < cluster->num_rows; ++r) {
+    free(cluster->rows[r]);
+  }
+  free(cluster->rows);
+  free(cluster->members);
+  free(cluster);
+}
+
+/**
+ * @brief      Copies the rows of an alignment into a merged one, inserting a
+ *             gap column wherever the path skips the alignment.
+ */
+static void copy_rows(const cluster_t* from, const uint8_t* path,
+    const int length, const uint8_t skip, cluster_t* to, const int offset) {
+  for (int r = 0; r < from->num_rows; ++r) {
+    const char* kRow = from->rows[r];
+    char* row = to->rows[offset + r];
+    int k = 0;
+    for (int c = 0; c < length; ++c) {
+      row[c] = path[c] == skip ? '-' : kRow[k++];
+    }
+    to->members[offset + r] = from->members[r];
+  }
+}
+
+/**
+ * @brief      Merges two alignments with the global alignment of their
+ *             profiles, which is the recurrence of global_alignment.c with
+ *             the score of a column pair in place of the substitution score.
+ *             The ties are broken in the same order: DIAG, UP, then LEFT.
+ *
+ * @return     The merged alignment, the two input ones are released.
+ */
+static cluster_t* merge(cluster_t* A, cluster_t* B,
+    const msa_alphabet_t* alphabet) {
+  const int m = A->length;
+  const int n = B->length;
+  const int K1 = alphabet->num_symbols + 1;
+  float* counts_a = build_profile(A, alphabet);
+  float* counts_b = build_profile(B, alphabet);
+  float* weights = checked_malloc(sizeof(float) * m * K1);
+  build_weights(counts_a, m, alphabet, weights);
+  const float kScale = 1.0f / ((float)A->num_rows * B->num_rows);
+  float* F = checked_malloc(sizeof(float) * (n + 1) * 2);
+  uint8_t* trace = checked_malloc(sizeof(uint8_t) * (m + 1) * (n + 1));
+  float* row = F;
+  float* next = F + n + 1;
+  for (int j = 0; j <= n; ++j) {
+    row[j] = -GAP_PENALTY * j;
+    trace[cell_idx(0, j, n)] = LEFT;
+  }
+  for (int i = 1; i <= m; ++i) {
+    const float* restrict w = weights + (size_t)(i - 1) * K1;
+    next[0] = -GAP_PENALTY * i;
+    trace[cell_idx(i, 0, n)] = UP;
+    for (int j = 1; j <= n; ++j) {
+      const float* restrict kCounts = counts_b + (size_t)(j - 1) * K1;
+      float pair = 0;
+      for (int k = 0; k < K1; ++k) {
+        pair += w[k] * kCounts[k];
+      }
+      const float kDiag = row[j-1] + pair * kScale;
+      const float kUp = row[j] - GAP_PENALTY;
+      const float kLeft = next[j-1] - GAP_PENALTY;
+      float best = kDiag;
+      uint8_t dir = DIAG;
+      if (kUp > best) {
+        best = kUp;
+        dir = UP;
+      }
+      if (kLeft > best) {
+        best = kLeft;
+        dir = LEFT;
+      }
+      next[j] = best;
+      trace[cell_idx(i, j, n)] = dir;
+    }
+    float* tmp = row;
+    row = next;
+    next = tmp;
+  }
+  /*
+   * Traceback, then the rows of both alignments along the path
+   */
+  uint8_t* path = checked_malloc(sizeof(uint8_t) * (m + n));
+  int length = 0;
+  for (int i = m, j = n; i > 0 || j > 0; ) {
+    const uint8_t kDir = trace[cell_idx(i, j, n)];
+    path[length++] = kDir;
+    i -= kDir != LEFT;
+    j -= kDir != UP;
+  }
+  for (int c = 0; c < length / 2; ++c) {
+    const uint8_t tmp = path[c];
+    path[c] = path[length - 1 - c];
+    path[length - 1 - c] = tmp;
+  }
+  cluster_t* merged = new_cluster(A->num_rows + B->num_rows, length);
+  copy_rows(A, path, length, LEFT, merged, 0);
+  copy_rows(B, path, length, UP, merged, A->num_rows);
+  free(counts_a);
+  free(counts_b);
+  free(weights);
+  free(F);
+  free(trace);
+  free(path);
+  free_cluster(A);
+  free_cluster(B);
+  return merged;
+}
+
+/**
+ * @brief      Aligns the sequences of a subtree. The left subtree is spawned
+ *             as a task while the right one is aligned by the current thread,
+ *             so that all independent merges can run concurrently.
+ */
+static cluster_t* align_subtree(const sequence_t* seqs,
+    const tree_node_t* nodes, const int node,
+    const msa_alphabet_t* alphabet) {
+  if (nodes[node].left < 0) {
+    cluster_t* leaf = new_cluster(1, seqs[node].length);
+    memcpy(leaf->rows[0], seqs[node].seq, seqs[node].length);
+    leaf->members[0] = node;
+    return leaf;
+  }
+  cluster_t* left = NULL;
+  cluster_t* right = NULL;
+  #pragma omp task shared(left) if(nodes[nodes[node].left].left >= 0)
+  left = align_subtree(seqs, nodes, nodes[node].left, alphabet);
+  right = align_subtree(seqs, nodes, nodes[node].right, alphabet);
+  #pragma omp taskwait
+  return merge(left, right, alphabet);
+}
+
+char** msa_progressive(const sequence_t* seqs, const int num_seqs,
+    const tree_node_t* nodes, const int root, const matrix_t matrix,
+    const int num_threads, int* num_columns) {
+  char** rows = checked_malloc(sizeof(char*) * num_seqs);
+  *num_columns = 0;
+  if (num_seqs == 0) {
+    return rows;
+  }
+  msa_alphabet_t alphabet;
+  init_alphabet(seqs, num_seqs, matrix, &alphabet);
+  cluster_t* alignment = NULL;
+  #pragma omp parallel num_threads(num_threads)
+  #pragma omp single
+  alignment = align_subtree(seqs, nodes, root, &alphabet);
+  for (int r = 0; r < alignment->num_rows; ++r) {
+    rows[alignment->members[r]] = alignment->rows[r];
+  }
+  *num_columns = alignment->length;
+  free(alignment->rows);
+  free(alignment->members);
+  free(alignment);
+  free(alphabet.scores);
+  return rows;
+}
+
+void msa_free(char** rows, const int num_seqs) {
+  for (int s = 0; s < num_seqs; ++s) {
+    free(rows[s]);
+  }
+  free(rows);
+}
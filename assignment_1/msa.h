@@ -0,0 +1,58 @@
+/*
+ * File:  msa.h
+ * Author: Stefano Ribes
+ */
+#ifndef MSA_H_
+#define MSA_H_
+
+#include "guide_tree.h"
+#include "scoring.h"
+#include "sequence_io.h"
+
+/**
+ * @brief      Computes the distances of all pairs of sequences, i.e. one minus
+ *             their fractional identity (see pairwise.h), from the edit
+ *             distance of the Myers pattern of each row.
+ *
+ * @param[in]  seqs         The sequences
+ * @param[in]  num_seqs     The number of sequences
+ * @param[in]  num_threads  The number of threads
+ *
+ * @return     The heap allocated num_seqs x num_seqs matrix, row-major.
+ */
+float* msa_distances(const sequence_t* seqs, const int num_seqs,
+    const int num_threads);
+
+/**
+ * @brief      Aligns the sequences progressively along a guide tree: the two
+ *             alignments of the children of each node are merged with the
+ *             global alignment of their profiles. A column pair is scored
+ *             with the average substitution score of its residue pairs, a
+ *             residue against a gap costing GAP_PENALTY, and a gap column
+ *             inserted in either profile costs GAP_PENALTY. The merges of
+ *             independent subtrees run in parallel, as OpenMP tasks.
+ *
+ * @param[in]  seqs         The sequences
+ * @param[in]  num_seqs     The number of sequences
+ * @param[in]  nodes        The guide tree
+ * @param[in]  root         The root of the guide tree
+ * @param[in]  matrix       The substitution matrix
+ * @param[in]  num_threads  The number of threads
+ * @param      num_columns  The number of columns of the alignment
+ *
+ * @return     The heap allocated rows of the alignment, in the order of the
+ *             sequences, to be released with msa_free().
+ */
+char** msa_progressive(const sequence_t* seqs, const int num_seqs,
+    const tree_node_t* nodes, const int root, const matrix_t matrix,
+    const int num_threads, int* num_columns);
+
+/**
+ * @brief      Releases the rows of an alignment.
+ *
+ * @param      rows      The rows
+ * @param[in]  num_seqs  The number of rows
+ */
+void msa_free(char** rows, const int num_seqs);
+
+#endif // end MSA_H_
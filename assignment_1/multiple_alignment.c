@@ -0,0 +1,107 @@
+/*
+ * @author     Stefano Ribes
+ *
+ * @brief      Progressive multiple sequence alignment.
+ *
+ * @details    To compile this C program, type:
+ *
+ *             make multiple_alignment.exe
+ *
+ *             To run the program, type:
+ *
+ *             ./multiple_alignment.exe [--threads N]
+ *               [--matrix identity|dna|blosum62|pam250] sequences.fa
+ *
+ *             The sequences file is either in FASTA format or it holds one
+ *             sequence per line. The distances of all pairs of sequences are
+ *             computed in parallel from their edit distance, then the UPGMA
+ *             guide tree is built and the sequences are merged along it, from
+ *             the leaves to the root, with the global alignment of the
+ *             profiles of the two children of each node. The merges of
+ *             independent subtrees run in parallel.
+ *
+ *             The alignment is printed in FASTA format, in the order of the
+ *             input sequences, with '-' for the gaps.
+ */
+#include "guide_tree.h"
+#include "msa.h"
+#include "scoring.h"
+#include "sequence_io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#define LINE_WIDTH 60
+
+#define USAGE "ERROR. Usage: %s [--threads N] " \
+  "[--matrix identity|dna|blosum62|pam250] sequences.fa\n"
+
+static double elapsed_time(const struct timespec start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+int main(int argc, char** argv) {
+  matrix_t matrix = MATRIX_IDENTITY;
+  int num_threads = omp_get_max_threads();
+  const char* filename = NULL;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--matrix") == 0 && arg + 1 < argc) {
+      if (parse_matrix(argv[++arg], &matrix)) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+      num_threads = atoi(argv[++arg]);
+    } else if (filename == NULL) {
+      filename = argv[arg];
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  if (filename == NULL || num_threads < 1) {
+    fprintf(stderr, USAGE, argv[0]);
+    exit(1);
+  }
+  int num_seqs = 0;
+  sequence_t* seqs = read_sequences(filename, &num_seqs);
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  float* dist = msa_distances(seqs, num_seqs, num_threads);
+  const double kDistSeconds = elapsed_time(start);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  tree_node_t* nodes = malloc(sizeof(tree_node_t) * (2 * num_seqs + 1));
+  if (nodes == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the guide tree\n");
+    exit(1);
+  }
+  const int kRoot = upgma(dist, num_seqs, nodes);
+  const double kTreeSeconds = elapsed_time(start);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int num_columns = 0;
+  char** rows = msa_progressive(seqs, num_seqs, nodes, kRoot, matrix,
+    num_threads, &num_columns);
+  const double kMergeSeconds = elapsed_time(start);
+  fprintf(stderr, "[INFO] %d sequences aligned in %d columns: distances "
+    "%.3f s, guide tree %.3f s, profile merges %.3f s (%d threads)\n",
+    num_seqs, num_columns, kDistSeconds, kTreeSeconds, kMergeSeconds,
+    num_threads);
+  for (int s = 0; s < num_seqs; ++s) {
+    printf(">%s\n", seqs[s].name);
+    for (int c = 0; c < num_columns; c += LINE_WIDTH) {
+      const int kWidth = num_columns - c < LINE_WIDTH ? num_columns - c :
+        LINE_WIDTH;
+      printf("%.*s\n", kWidth, rows[s] + c);
+    }
+  }
+  msa_free(rows, num_seqs);
+  free(nodes);
+  free(dist);
+  free_sequences(seqs, num_seqs);
+  return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * File:  myers.c
+ * Author: Stefano Ribes
+ *
+ * Bit-parallel edit distance (Myers, J. ACM 46(3), 1999; Hyyrö, 2003). Each
+ * word holds the vertical deltas of 64 consecutive cells of a column of the
+ * DP matrix, as a positive (Pv) and a negative (Mv) bit vector, so that a
+ * column block is advanced with a handful of word operations.
+ *
+ * With a distance limit k, a cell (i, j) with |i - j| > k holds more than k,
+ * so the blocks outside of the band are not computed. Blocks entering the band
+ * at the bottom start from an upper bound of their scores (a vertical gap from
+ * the block above), and the block at the top of the band assumes the cell
+ * above it grows by one per column. Both are upper bounds, hence every cell
+ * whose distance is at most k is still exact.
+ */
+#include "myers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORD_BITS 64
+
+/**
+ * @brief      Advances a block of the column by one text character.
+ *
+ * @param      Pv    The positive vertical deltas of the block
+ * @param      Mv    The negative vertical deltas of the block
+ * @param[in]  Eq    The pattern positions matching the text character
+ * @param[in]  hin   The horizontal delta entering the top of the block
+ * @param[in]  last  The bit of the last row of the block
+ *
+ * @return     The horizontal delta leaving the last row of the block.
+ */
+static inline int advance_block(uint64_t* Pv, uint64_t* Mv, uint64_t Eq,
+    const int hin, const uint64_t last) {
+  const uint64_t kPv = *Pv;
+  const uint64_t kMv = *Mv;
+  const uint64_t Xv = Eq | kMv;
+  Eq |= hin < 0 ? 1 : 0;
+  const uint64_t Xh = (((Eq & kPv) + kPv) ^ kPv) | Eq;
+  uint64_t Ph = kMv | ~(Xh | kPv);
+  uint64_t Mh = kPv & Xh;
+  const int hout = (Ph & last) ? 1 : ((Mh & last) ? -1 : 0);
+  Ph = (Ph << 1) | (hin > 0 ? 1 : 0);
+  Mh = (Mh << 1) | (hin < 0 ? 1 : 0);
+  *Pv = Mh | ~(Xv | Ph);
+  *Mv = Ph & Xv;
+  return hout;
+}
+
+/**
+ * @brief      Edit distance of a pattern of at most 64 characters, given the
+ *             match vectors of its characters.
+ */
+static int distance_word(const uint64_t* peq, const int m, const char* T,
+    const int n, const int k) {
+  const uint64_t kLast = (uint64_t)1 << (m - 1);
+  uint64_t Pv = ~(uint64_t)0;
+  uint64_t Mv = 0;
+  int score = m;
+  for (int j = 0; j < n; ++j) {
+    score += advance_block(&Pv, &Mv, peq[(uint8_t)T[j]], 1, kLast);
+    // The column minimum is at least score - (m - 1).
+    if (score - m + 1 > k) {
+      return k + 1;
+    }
+  }
+  return score <= k ? score : k + 1;
+}
+
+/**
+ * @brief      Edit distance of a pattern of any length, one word per block,
+ *             given the match vectors of its characters (kNumBlocks words per
+ *             character).
+ */
+static int distance_blocks(const uint64_t* peq, const int m, const char* T,
+    const int n, const int k) {
+  const int kNumBlocks = (m + WORD_BITS - 1) / WORD_BITS;
+  uint64_t* Pv = malloc(sizeof(uint64_t) * kNumBlocks);
+  uint64_t* Mv = malloc(sizeof(uint64_t) * kNumBlocks);
+  int* score = malloc(sizeof(int) * kNumBlocks); // Score of the last row
+  if (Pv == NULL || Mv == NULL || score == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate %d pattern blocks\n",
+      kNumBlocks);
+    exit(1);
+  }
+  const int kLastRows = m - (kNumBlocks - 1) * WORD_BITS;
+  int first = 0;
+  int last = -1;
+  int dist = -1;
+  for (int j = 1; j <= n && dist < 0; ++j) {
+    /*
+     * Blocks holding the rows of the band [j - k, j + k].
+     */
+    const int kTop = j - k > 1 ? j - k : 1;
+    const int kBottom = j + k < m ? j + k : m;
+    const int kFirst = (kTop - 1) / WORD_BITS;
+    const int kLast = (kBottom - 1) / WORD_BITS;
+    while (last < kLast) {
+      ++last;
+      const int kRows = last == kNumBlocks - 1 ? kLastRows : WORD_BITS;
+      Pv[last] = ~(uint64_t)0;
+      Mv[last] = 0;
+      score[last] = (last > 0 ? score[last - 1] : 0) + kRows;
+    }
+    first = kFirst > first ? kFirst : first;
+    const uint64_t* kEq = peq + (uint8_t)T[j-1] * kNumBlocks;
+    int h = 1;
+    int lower_bound = m + n;
+    for (int b = first; b <= last; ++b) {
+      const int kRows = b == kNumBlocks - 1 ? kLastRows : WORD_BITS;
+      h = advance_block(Pv + b, Mv + b, kEq[b], h,
+        (uint64_t)1 << (kRows - 1));
+      score[b] += h;
+      lower_bound = score[b] - kRows + 1 < lower_bound ?
+        score[b] - kRows + 1 : lower_bound;
+    }
+    if (lower_bound > k) {
+      dist = k + 1;
+    }
+  }
+  if (dist < 0) {
+    dist = score[kNumBlocks - 1] <= k ? score[kNumBlocks - 1] : k + 1;
+  }
+  free(Pv);
+  free(Mv);
+  free(score);
+  return dist;
+}
+
+/**
+ * @brief      Sets the match vectors of a pattern. Only the entries of the
+ *             text characters are cleared, when a text is given, otherwise all
+ *             of them.
+ */
+static void build_peq(const char* P, const int m, const char* T, const int n,
+    uint64_t* peq) {
+  const int kNumBlocks = (m + WORD_BITS - 1) / WORD_BITS;
+  if (T != NULL) {
+    for (int j = 0; j < n; ++j) {
+      for (int b = 0; b < kNumBlocks; ++b) {
+        peq[(uint8_t)T[j] * kNumBlocks + b] = 0;
+      }
+    }
+  } else {
+    memset(peq, 0, sizeof(uint64_t) * 256 * kNumBlocks);
+  }
+  for (int i = 0; i < m; ++i) {
+    peq[(uint8_t)P[i] * kNumBlocks + i / WORD_BITS] |=
+      (uint64_t)1 << (i % WORD_BITS);
+  }
+}
+
+int myers_distance(const char* X, const int m, const char* Y, const int n,
+    const int max_dist) {
+  const int k = max_dist < 0 || max_dist > m + n ? m + n : max_dist;
+  if (m - n > k || n - m > k) {
+    return k + 1;
+  }
+  // The shorter sequence is the pattern, so that it takes fewer blocks.
+  const char* P = m <= n ? X : Y;
+  const char* T = m <= n ? Y : X;
+  const int kPatternLength = m <= n ? m : n;
+  const int kTextLength = m <= n ? n : m;
+  if (kPatternLength == 0) {
+    return kTextLength;
+  }
+  if (kPatternLength <= WORD_BITS) {
+    uint64_t peq[256];
+    build_peq(P, kPatternLength, T, kTextLength, peq);
+    return distance_word(peq, kPatternLength, T, kTextLength, k);
+  }
+  const int kNumBlocks = (kPatternLength + WORD_BITS - 1) / WORD_BITS;
+  uint64_t* peq = malloc(sizeof(uint64_t) * 256 * kNumBlocks);
+  if (peq == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate %d pattern blocks\n",
+      kNumBlocks);
+    exit(1);
+  }
+  build_peq(P, kPatternLength, T, kTextLength, peq);
+  const int kDist = distance_blocks(peq, kPatternLength, T, kTextLength, k);
+  free(peq);
+  return kDist;
+}
+
+int myers_pattern_init(myers_pattern_t* pattern, const char* P, const int m) {
+  const int kNumBlocks = m > 0 ? (m + WORD_BITS - 1) / WORD_BITS : 1;
+  pattern->length = m;
+  pattern->peq = malloc(sizeof(uint64_t) * 256 * kNumBlocks);
+  if (pattern->peq == NULL) {
+    return 1;
+  }
+  build_peq(P, m, NULL, 0, pattern->peq);
+  return 0;
+}
+
+int myers_pattern_distance(const myers_pattern_t* pattern, const char* T,
+    const int n, const int max_dist) {
+  const int m = pattern->length;
+  const int k = max_dist < 0 || max_dist > m + n ? m + n : max_dist;
+  if (m - n > k || n - m > k) {
+    return k + 1;
+  }
+  if (m == 0) {
+    return n;
+  }
+  if (m <= WORD_BITS) {
+    return distance_word(pattern->peq, m, T, n, k);
+  }
+  return distance_blocks(pattern->peq, m, T, n, k);
+}
+
+void myers_pattern_free(myers_pattern_t* pattern) {
+  free(pattern->peq);
+  pattern->peq = NULL;
+}
@@ -0,0 +1,74 @@
+/*
+ * File:  myers.h
+ * Author: Stefano Ribes
+ */
+#ifndef MYERS_H_
+#define MYERS_H_
+
+#include <stdint.h>
+
+/*
+ * @brief      Pattern prepared for myers_pattern_distance(): the match vectors
+ *             of its characters, built once and reused across texts.
+ */
+typedef struct {
+  int length;
+  uint64_t* peq; // 256 characters x one word per block of 64 characters
+} myers_pattern_t;
+
+/**
+ * @brief      Edit (Levenshtein) distance with Myers' bit-parallel algorithm,
+ *             in the formulation of Hyyrö for the global distance. The shorter
+ *             sequence is the pattern, packed 64 characters per word, and the
+ *             longer one is scanned one character at a time. Patterns longer
+ *             than 64 characters are split in blocks of one word.
+ *
+ *             With a distance limit k, only the blocks crossing the diagonal
+ *             band of width 2k + 1 are computed (Ukkonen's cut-off), and the
+ *             scan stops as soon as every cell of a column exceeds k.
+ *
+ * @param[in]  X         The X sequence
+ * @param[in]  m         The length of the X sequence
+ * @param[in]  Y         The Y sequence
+ * @param[in]  n         The length of the Y sequence
+ * @param[in]  max_dist  The distance limit, negative for no limit
+ *
+ * @return     The edit distance, or max_dist + 1 if it exceeds the limit.
+ */
+int myers_distance(const char* X, const int m, const char* Y, const int n,
+    const int max_dist);
+
+/**
+ * @brief      Prepares a pattern for many distance computations.
+ *
+ * @param      pattern  The pattern
+ * @param[in]  P        The pattern sequence
+ * @param[in]  m        The length of the pattern sequence
+ *
+ * @return     Zero on success, non-zero if the allocation fails.
+ */
+int myers_pattern_init(myers_pattern_t* pattern, const char* P, const int m);
+
+/**
+ * @brief      Edit distance between a prepared pattern and a text, see
+ *             myers_distance(). The pattern is not swapped with the text when
+ *             it is the longer sequence.
+ *
+ * @param[in]  pattern   The pattern
+ * @param[in]  T         The text
+ * @param[in]  n         The length of the text
+ * @param[in]  max_dist  The distance limit, negative for no limit
+ *
+ * @return     The edit distance, or max_dist + 1 if it exceeds the limit.
+ */
+int myers_pattern_distance(const myers_pattern_t* pattern, const char* T,
+    const int n, const int max_dist);
+
+/**
+ * @brief      Releases a pattern.
+ *
+ * @param      pattern  The pattern
+ */
+void myers_pattern_free(myers_pattern_t* pattern);
+
+#endif // end MYERS_H_
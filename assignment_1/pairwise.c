@@ -0,0 +1,115 @@
+/*
+ * File:  pairwise.c
+ * Author: Stefano Ribes
+ */
+#include "pairwise.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const kMetricNames[NUM_METRICS] = {
+  "score",
+  "edit",
+  "identity"
+};
+
+int parse_metric(const char* name, metric_t* metric) {
+  for (int k = 0; k < NUM_METRICS; ++k) {
+    if (strcmp(name, kMetricNames[k]) == 0) {
+      *metric = (metric_t)k;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+const char* metric_name(const metric_t metric) {
+  return kMetricNames[metric];
+}
+
+void query_profile_init(query_profile_t* query, const uint8_t* X, const int m,
+    const metric_t metric, const matrix_t matrix) {
+  memset(query, 0, sizeof(query_profile_t));
+  query->metric = metric;
+  query->matrix = matrix;
+  query->length = m;
+  int error = 0;
+  if (metric == METRIC_SCORE) {
+    query->num_codes = matrix_num_codes(matrix);
+    query->profile = malloc(sizeof(int8_t) * query->num_codes * (m + 1));
+    query->row = malloc(sizeof(int) * 2 * (m + 1));
+    error = query->profile == NULL || query->row == NULL;
+    for (int c = 0; c < query->num_codes && !error; ++c) {
+      for (int j = 0; j < m; ++j) {
+        query->profile[(size_t)c * m + j] = substitution_score(matrix,
+          (uint8_t)c, X[j]);
+      }
+    }
+  } else {
+    error = myers_pattern_init(&query->pattern, (const char*)X, m);
+  }
+  if (error) {
+    fprintf(stderr, "ERROR. Unable to allocate the profile of a query of "
+      "length %d\n", m);
+    exit(1);
+  }
+}
+
+/**
+ * @brief      Global alignment score, one row per target symbol: row i holds
+ *             the scores of Y[0 .. i-1] against each prefix of the query. The
+ *             diagonal and vertical moves of a row do not depend on each
+ *             other, so they are computed in a first (vectorised) pass, and
+ *             the horizontal gaps in a second one.
+ */
+static int profile_score(const query_profile_t* query, const uint8_t* Y,
+    const int n) {
+  const int m = query->length;
+  int* restrict row = query->row;
+  int* restrict next = query->row + m + 1;
+  for (int j = 0; j <= m; ++j) {
+    row[j] = -GAP_PENALTY * j;
+  }
+  for (int i = 1; i <= n; ++i) {
+    const int8_t* restrict kScores = query->profile + (size_t)Y[i-1] * m;
+    next[0] = -GAP_PENALTY * i;
+    for (int j = 1; j <= m; ++j) {
+      const int kDiag = row[j-1] + kScores[j-1];
+      const int kUp = row[j] - GAP_PENALTY;
+      next[j] = kUp > kDiag ? kUp : kDiag;
+    }
+    for (int j = 1; j <= m; ++j) {
+      const int kLeft = next[j-1] - GAP_PENALTY;
+      next[j] = kLeft > next[j] ? kLeft : next[j];
+    }
+    int* tmp = row;
+    row = next;
+    next = tmp;
+  }
+  return row[m];
+}
+
+double query_profile_compare(query_profile_t* query, const uint8_t* Y,
+    const int n) {
+  if (query->metric == METRIC_SCORE) {
+    return profile_score(query, Y, n);
+  }
+  const int kDist = myers_pattern_distance(&query->pattern, (const char*)Y, n,
+    -1);
+  if (query->metric == METRIC_EDIT) {
+    return kDist;
+  }
+  const int kLength = query->length > n ? query->length : n;
+  return kLength > 0 ? 100.0 * (1.0 - (double)kDist / kLength) : 100.0;
+}
+
+void query_profile_free(query_profile_t* query) {
+  free(query->profile);
+  free(query->row);
+  if (query->metric != METRIC_SCORE) {
+    myers_pattern_free(&query->pattern);
+  }
+  query->profile = NULL;
+  query->row = NULL;
+}
@@ -0,0 +1,94 @@
+/*
+ * File:  pairwise.h
+ * Author: Stefano Ribes
+ */
+#ifndef PAIRWISE_H_
+#define PAIRWISE_H_
+
+#include "myers.h"
+#include "scoring.h"
+
+#include <stdint.h>
+
+/*
+ * @brief      Pairwise metrics: global alignment score, edit distance and
+ *             percent identity, i.e. 100 (1 - d / max(m, n)) with d the edit
+ *             distance.
+ */
+typedef enum {
+  METRIC_SCORE,
+  METRIC_EDIT,
+  METRIC_IDENTITY,
+  NUM_METRICS
+} metric_t;
+
+/*
+ * @brief      Query prepared once and compared with many targets: the score
+ *             profile of the global alignment (row c holds the scores of code
+ *             c against each query symbol) or the pattern of the edit
+ *             distance.
+ */
+typedef struct {
+  metric_t metric;
+  matrix_t matrix;
+  int length;
+  int num_codes;
+  int8_t* profile;
+  int* row; // Two score rows of the global alignment
+  myers_pattern_t pattern;
+} query_profile_t;
+
+/**
+ * @brief      Gets a metric from its name: score, edit or identity.
+ *
+ * @param[in]  name    The metric name
+ * @param      metric  The metric
+ *
+ * @return     Zero on success, non-zero if the name is unknown.
+ */
+int parse_metric(const char* name, metric_t* metric);
+
+/**
+ * @brief      Gets the name of a metric.
+ *
+ * @param[in]  metric  The metric
+ *
+ * @return     The metric name.
+ */
+const char* metric_name(const metric_t metric);
+
+/**
+ * @brief      Prepares a query.
+ *
+ * @param      query   The query profile
+ * @param[in]  X       The query sequence: encoded with encode_sequence() for
+ *                     METRIC_SCORE, raw characters otherwise
+ * @param[in]  m       The length of the query
+ * @param[in]  metric  The metric
+ * @param[in]  matrix  The substitution matrix of METRIC_SCORE
+ */
+void query_profile_init(query_profile_t* query, const uint8_t* X, const int m,
+    const metric_t metric, const matrix_t matrix);
+
+/**
+ * @brief      Compares a prepared query with a target. The global alignment
+ *             score is the one of global_alignment.c, computed in linear
+ *             space with the profile row of each target symbol.
+ *
+ * @param[in]  query  The query profile
+ * @param[in]  Y      The target, encoded as the query
+ * @param[in]  n      The length of the target
+ *
+ * @return     The value of the metric.
+ */
+double query_profile_compare(query_profile_t* query, const uint8_t* Y,
+    const int n);
+
+/**
+ * @brief      Releases a query profile.
+ *
+ * @param      query  The query profile
+ */
+void query_profile_free(query_profile_t* query);
+
+#endif // end PAIRWISE_H_
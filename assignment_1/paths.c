@@ -0,0 +1,161 @@
+/*
+ * File:  paths.c
+ * Author: Stefano Ribes
+ *
+ * Co-optimal paths of a global alignment. The tie flags of the traceback form
+ * a DAG in which a cell points to the neighbours reached by its traced move
+ * and by any other move of equal score. The number of paths grows
+ * exponentially with the ties, so they are counted with a DP over the DAG and
+ * listed lazily, one at a time.
+ */
+#include "paths.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief      Gets the moves leaving a cell, the traced one first. Ties are
+ *             broken preferring DIAG, then UP, then LEFT.
+ *
+ * @param[in]  ties   The tie flags of the cell
+ * @param      moves  The moves
+ *
+ * @return     The number of moves, zero for a STOP cell.
+ */
+static inline int tied_moves(const int ties, int8_t* moves) {
+  int num_moves = 0;
+  if (ties & TIE_DIAG) {
+    moves[num_moves++] = DIAG;
+  }
+  if (ties & TIE_UP) {
+    moves[num_moves++] = UP;
+  }
+  if (ties & TIE_LEFT) {
+    moves[num_moves++] = LEFT;
+  }
+  return num_moves;
+}
+
+static inline uint64_t saturating_add(const uint64_t a, const uint64_t b) {
+  const uint64_t kSum = a + b;
+  return kSum < a ? PATHS_SATURATED : kSum;
+}
+
+uint64_t count_optimal_paths(const trace_store_t* trace) {
+  const int m = trace->m;
+  const int n = trace->n;
+  // Paths from (i, j) only go through cells of rows i and i - 1, which are
+  // filled before it in row-major order.
+  uint64_t* prev = malloc(sizeof(uint64_t) * (n + 1));
+  uint64_t* curr = malloc(sizeof(uint64_t) * (n + 1));
+  if (prev == NULL || curr == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the path counts\n");
+    exit(1);
+  }
+  for (int i = 0; i <= m; ++i) {
+    for (int j = 0; j <= n; ++j) {
+      int8_t moves[3];
+      const int kNumMoves = tied_moves(trace_ties(trace, i, j), moves);
+      uint64_t count = kNumMoves == 0 ? 1 : 0;
+      for (int k = 0; k < kNumMoves; ++k) {
+        switch (moves[k]) {
+          case DIAG:
+            count = saturating_add(count, prev[j-1]);
+            break;
+          case UP:
+            count = saturating_add(count, prev[j]);
+            break;
+          case LEFT:
+            count = saturating_add(count, curr[j-1]);
+            break;
+        }
+      }
+      curr[j] = count;
+    }
+    uint64_t* tmp = prev;
+    prev = curr;
+    curr = tmp;
+  }
+  const uint64_t kCount = prev[n];
+  free(prev);
+  free(curr);
+  return kCount;
+}
+
+/**
+ * @brief      Pushes a cell on the iterator stack, i.e. appends it to the
+ *             current path.
+ */
+static void push_cell(path_iter_t* iter, const idx_t c) {
+  path_frame_t* frame = &iter->stack[iter->length];
+  frame->cell = c;
+  frame->next_move = 0;
+  frame->num_moves = tied_moves(trace_ties(iter->trace, c.x, c.y),
+    frame->moves);
+  iter->path[iter->length] = c;
+  ++iter->length;
+}
+
+/**
+ * @brief      Extends the current path with the first untried moves, until a
+ *             STOP cell is reached.
+ */
+static void descend(path_iter_t* iter) {
+  path_frame_t* top = &iter->stack[iter->length - 1];
+  while (top->next_move < top->num_moves) {
+    idx_t c = top->cell;
+    switch (top->moves[top->next_move++]) {
+      case DIAG:
+        --c.x;
+        --c.y;
+        break;
+      case UP:
+        --c.x;
+        break;
+      case LEFT:
+        --c.y;
+        break;
+    }
+    push_cell(iter, c);
+    top = &iter->stack[iter->length - 1];
+  }
+}
+
+void path_iter_init(path_iter_t* iter, const trace_store_t* trace,
+    const idx_t src) {
+  iter->trace = trace;
+  iter->stack = malloc(sizeof(path_frame_t) * (src.x + src.y + 1));
+  iter->path = malloc(sizeof(idx_t) * (src.x + src.y + 1));
+  if (iter->stack == NULL || iter->path == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the path stack\n");
+    exit(1);
+  }
+  iter->length = 0;
+  iter->started = false;
+  push_cell(iter, src);
+}
+
+bool path_iter_next(path_iter_t* iter) {
+  if (!iter->started) {
+    iter->started = true;
+    descend(iter);
+    return true;
+  }
+  // Backtrack to the deepest cell with an untried move.
+  while (iter->length > 0) {
+    const path_frame_t* kTop = &iter->stack[iter->length - 1];
+    if (kTop->next_move < kTop->num_moves) {
+      descend(iter);
+      return true;
+    }
+    --iter->length;
+  }
+  return false;
+}
+
+void path_iter_free(path_iter_t* iter) {
+  free(iter->stack);
+  free(iter->path);
+  iter->stack = NULL;
+  iter->path = NULL;
+}
@@ -0,0 +1,81 @@
+/*
+ * File:  paths.h
+ * Author: Stefano Ribes
+ */
+#ifndef PATHS_H_
+#define PATHS_H_
+
+#include "alignment.h"
+#include "trace_store.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PATHS_SATURATED UINT64_MAX // Path counts saturate at this value
+
+/*
+ * @brief      A cell of the path being enumerated, with the tied moves leaving
+ *             it and the next one to follow.
+ */
+typedef struct {
+  idx_t cell;
+  int8_t moves[3]; // UP, LEFT or DIAG, in visiting order
+  int8_t num_moves;
+  int8_t next_move;
+} path_frame_t;
+
+/*
+ * @brief      Pull-based iterator over the co-optimal paths of a global
+ *             alignment. The depth-first search keeps an explicit stack of at
+ *             most m + n + 1 frames, i.e. the current path, instead of
+ *             recursing.
+ */
+typedef struct {
+  const trace_store_t* trace;
+  path_frame_t* stack;
+  idx_t* path; // Cells of the current path, from the source cell
+  int length; // Number of cells of the current path
+  bool started;
+} path_iter_t;
+
+/**
+ * @brief      Counts the co-optimal paths from cell (m, n) to a STOP cell in
+ *             O(mn) time and O(n) space. A cell is left through every move
+ *             flagged in the traceback. The count saturates at
+ *             PATHS_SATURATED.
+ *
+ * @param[in]  trace  The packed traceback
+ *
+ * @return     The number of co-optimal paths.
+ */
+uint64_t count_optimal_paths(const trace_store_t* trace);
+
+/**
+ * @brief      Initialises an iterator over the co-optimal paths starting at
+ *             a cell. The paths are visited in the order of the former
+ *             recursive search: the traced move first, then the tied ones.
+ *
+ * @param      iter   The iterator
+ * @param[in]  trace  The packed traceback
+ * @param[in]  src    The starting cell
+ */
+void path_iter_init(path_iter_t* iter, const trace_store_t* trace,
+    const idx_t src);
+
+/**
+ * @brief      Advances the iterator to the next path, stored in iter->path.
+ *
+ * @param      iter  The iterator
+ *
+ * @return     False when all the paths have been visited.
+ */
+bool path_iter_next(path_iter_t* iter);
+
+/**
+ * @brief      Releases the iterator stack.
+ *
+ * @param      iter  The iterator
+ */
+void path_iter_free(path_iter_t* iter);
+
+#endif // end PATHS_H_
@@ -0,0 +1,195 @@
+/*
+ * File:  query_trie.c
+ * Author: Stefano Ribes
+ *
+ * The trie is walked with an explicit stack: the subtree of a node is done
+ * before any of its siblings is popped, so the row of depth d - 1 is always
+ * the one of the parent of the node being filled.
+ */
+#include "query_trie.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int new_node(query_trie_t* trie, const char symbol, const int depth) {
+  if (trie->num_nodes == trie->capacity) {
+    trie->capacity = trie->capacity ? trie->capacity * 2 : 256;
+    trie->nodes = realloc(trie->nodes, sizeof(trie_node_t) * trie->capacity);
+    if (trie->nodes == NULL) {
+      fprintf(stderr, "ERROR. Unable to allocate the query trie\n");
+      exit(1);
+    }
+  }
+  trie_node_t* node = &trie->nodes[trie->num_nodes];
+  node->first_child = -1;
+  node->next_sibling = -1;
+  node->depth = depth;
+  node->symbol = symbol;
+  node->is_end = false;
+  trie->max_depth = depth > trie->max_depth ? depth : trie->max_depth;
+  return trie->num_nodes++;
+}
+
+void trie_build(query_trie_t* trie, const char* const* queries,
+    const int* lengths, const int num_queries) {
+  trie->nodes = NULL;
+  trie->num_nodes = 0;
+  trie->capacity = 0;
+  trie->max_depth = 0;
+  trie->num_queries = num_queries;
+  trie->query_node = malloc(sizeof(int) * (num_queries + 1));
+  if (trie->query_node == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the query trie\n");
+    exit(1);
+  }
+  new_node(trie, 0, 0);
+  for (int q = 0; q < num_queries; ++q) {
+    int node = 0;
+    for (int i = 0; i < lengths[q]; ++i) {
+      int child = trie->nodes[node].first_child;
+      while (child >= 0 && trie->nodes[child].symbol != queries[q][i]) {
+        child = trie->nodes[child].next_sibling;
+      }
+      if (child < 0) {
+        child = new_node(trie, queries[q][i], i + 1);
+        trie->nodes[child].next_sibling = trie->nodes[node].first_child;
+        trie->nodes[node].first_child = child;
+      }
+      node = child;
+    }
+    trie->nodes[node].is_end = true;
+    trie->query_node[q] = node;
+  }
+}
+
+void trie_free(query_trie_t* trie) {
+  free(trie->nodes);
+  free(trie->query_node);
+}
+
+/**
+ * @brief      Fills a row from the row above, given the scores of its symbol
+ *             against the target. The clamping at zero is a compile-time
+ *             constant at the call sites.
+ *
+ * @return     The highest score of the row.
+ */
+static ALWAYS_INLINE int fill_row(const int* restrict prev,
+    int* restrict curr, const int* restrict profile, const int n,
+    const int first, const bool clamp) {
+  curr[0] = first;
+  int row_max = first;
+  for (int j = 1; j <= n; ++j) {
+    int score = prev[j-1] + profile[j-1];
+    score = prev[j] - GAP_PENALTY > score ? prev[j] - GAP_PENALTY : score;
+    score = curr[j-1] - GAP_PENALTY > score ? curr[j-1] - GAP_PENALTY : score;
+    if (clamp) {
+      score = score > 0 ? score : 0;
+    }
+    curr[j] = score;
+    row_max = score > row_max ? score : row_max;
+  }
+  return row_max;
+}
+
+void trie_align(const query_trie_t* trie, const char* Y, const int n,
+    const matrix_t matrix, const align_mode_t mode, int* scores) {
+  const bool kFreeX = mode == MODE_LOCAL || mode == MODE_SEMI_GLOBAL ||
+    mode == MODE_OVERLAP;
+  const bool kFreeY = mode == MODE_LOCAL || mode == MODE_SEMI_GLOBAL ||
+    mode == MODE_GLOCAL;
+  const bool kClamp = mode == MODE_LOCAL;
+  const bool kEndRow = mode == MODE_SEMI_GLOBAL || mode == MODE_OVERLAP ||
+    mode == MODE_GLOCAL;
+  const bool kEndCol = mode == MODE_SEMI_GLOBAL;
+  /*
+   * Profile of the target: one row of scores per symbol of the trie.
+   */
+  uint8_t codes[256];
+  build_symbol_codes(matrix, codes);
+  int slot[256];
+  int num_slots = 0;
+  for (int c = 0; c < 256; ++c) {
+    slot[c] = -1;
+  }
+  for (int v = 1; v < trie->num_nodes; ++v) {
+    const uint8_t kSymbol = (uint8_t)trie->nodes[v].symbol;
+    if (slot[kSymbol] < 0) {
+      slot[kSymbol] = num_slots++;
+    }
+  }
+  uint8_t* Y_codes = encode_sequence(matrix, Y, n);
+  int* profile = malloc(sizeof(int) * ((size_t)num_slots * n + 1));
+  int* rows = malloc(sizeof(int) * (size_t)(trie->max_depth + 1) * (n + 1));
+  // Best score of the rows (local) and of the last column (semi-global) along
+  // the current path, by depth.
+  int* path_best = malloc(sizeof(int) * (trie->max_depth + 1));
+  int* stack = malloc(sizeof(int) * trie->num_nodes);
+  int* node_score = malloc(sizeof(int) * trie->num_nodes);
+  if (profile == NULL || rows == NULL || path_best == NULL || stack == NULL ||
+      node_score == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the DP rows of the trie\n");
+    exit(1);
+  }
+  for (int c = 0; c < 256; ++c) {
+    if (slot[c] >= 0) {
+      int* p = profile + (size_t)slot[c] * n;
+      for (int j = 0; j < n; ++j) {
+        p[j] = substitution_score(matrix, codes[c], Y_codes[j]);
+      }
+    }
+  }
+  /*
+   * Row 0, the one of the root (the empty prefix).
+   */
+  for (int j = 0; j <= n; ++j) {
+    rows[j] = kFreeY || kClamp ? 0 : -GAP_PENALTY * j;
+  }
+  int row_max = rows[0]; // The first score is the highest one of row 0
+  path_best[0] = kClamp ? 0 : rows[n];
+  int num_stacked = 0;
+  stack[num_stacked++] = 0;
+  while (num_stacked > 0) {
+    const int v = stack[--num_stacked];
+    const trie_node_t* node = &trie->nodes[v];
+    const int d = node->depth;
+    int* row = rows + (size_t)d * (n + 1);
+    if (v > 0) {
+      const int* kProfile = profile +
+        (size_t)slot[(uint8_t)node->symbol] * n;
+      const int kFirst = kFreeX || kClamp ? 0 : -GAP_PENALTY * d;
+      row_max = kClamp ?
+        fill_row(row - (n + 1), row, kProfile, n, kFirst, true) :
+        fill_row(row - (n + 1), row, kProfile, n, kFirst, false);
+      if (kClamp) {
+        path_best[d] = row_max > path_best[d-1] ? row_max : path_best[d-1];
+      } else if (kEndCol) {
+        path_best[d] = row[n] > path_best[d-1] ? row[n] : path_best[d-1];
+      }
+    }
+    if (node->is_end) {
+      if (kClamp) {
+        node_score[v] = path_best[d];
+      } else if (kEndRow) {
+        node_score[v] = kEndCol && path_best[d] > row_max ? path_best[d] :
+          row_max;
+      } else {
+        node_score[v] = row[n];
+      }
+    }
+    for (int child = node->first_child; child >= 0;
+        child = trie->nodes[child].next_sibling) {
+      stack[num_stacked++] = child;
+    }
+  }
+  for (int q = 0; q < trie->num_queries; ++q) {
+    scores[q] = node_score[trie->query_node[q]];
+  }
+  free(Y_codes);
+  free(profile);
+  free(rows);
+  free(path_best);
+  free(stack);
+  free(node_score);
+}
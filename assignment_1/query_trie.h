@@ -0,0 +1,77 @@
+/*
+ * File:  query_trie.h
+ * Author: Stefano Ribes
+ */
+#ifndef QUERY_TRIE_H_
+#define QUERY_TRIE_H_
+
+#include "dp_core.h"
+#include "scoring.h"
+
+#include <stdbool.h>
+
+/*
+ * @brief      Node of the query trie: the node at depth d stands for a query
+ *             prefix of length d, the root for the empty prefix.
+ */
+typedef struct {
+  int first_child;
+  int next_sibling;
+  int depth;
+  char symbol; // Last symbol of the prefix
+  bool is_end; // Whether a query ends here
+} trie_node_t;
+
+/*
+ * @brief      Trie of a set of queries. Identical queries share their node.
+ */
+typedef struct {
+  trie_node_t* nodes; // The root is node 0
+  int num_nodes;
+  int capacity;
+  int max_depth;
+  int* query_node; // Node of each query
+  int num_queries;
+} query_trie_t;
+
+/**
+ * @brief      Builds the trie of a set of queries.
+ *
+ * @param      trie         The trie, to be released with trie_free()
+ * @param[in]  queries      The queries
+ * @param[in]  lengths      The lengths of the queries
+ * @param[in]  num_queries  The number of queries
+ */
+void trie_build(query_trie_t* trie, const char* const* queries,
+    const int* lengths, const int num_queries);
+
+/**
+ * @brief      Releases a trie.
+ *
+ * @param      trie  The trie
+ */
+void trie_free(query_trie_t* trie);
+
+/**
+ * @brief      Scores every query of a trie against a target, with the linear
+ *             gap penalty and the boundary policy of dp_align(). The trie is
+ *             walked depth first and each node fills one DP row (a query
+ *             symbol against the whole target) from the row of its parent, so
+ *             a prefix shared by several queries is computed once. Only the
+ *             rows of the current path are kept, i.e. (max_depth + 1) rows.
+ *
+ *             The scores of the target against each symbol of the trie are
+ *             computed once (a profile of the target), so the inner loop does
+ *             not look up the substitution matrix.
+ *
+ * @param[in]  trie    The trie of the queries
+ * @param[in]  Y       The target sequence
+ * @param[in]  n       The length of the target
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  mode    The alignment mode
+ * @param      scores  The score of each query, in the input order
+ */
+void trie_align(const query_trie_t* trie, const char* Y, const int n,
+    const matrix_t matrix, const align_mode_t mode, int* scores);
+
+#endif // end QUERY_TRIE_H_
@@ -0,0 +1,178 @@
+/*
+ * File:  scoring.c
+ * Author: Stefano Ribes
+ */
+#include "scoring.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Symbols of the encoded alphabets, in code order. Characters outside of an
+ * alphabet are encoded as N (DNA) or X (proteins).
+ */
+static const char* const kAlphabet[NUM_MATRICES] = {
+  NULL,
+  "ACGTN",
+  "ARNDCQEGHILKMFPSTWYVBZX*",
+  "ARNDCQEGHILKMFPSTWYVBZX*"
+};
+
+static const char* const kNames[NUM_MATRICES] = {
+  "identity",
+  "dna",
+  "blosum62",
+  "pam250"
+};
+
+const int8_t SUBSTITUTION_SCORES[NUM_MATRICES][ALPHABET_CODES]
+    [ALPHABET_CODES] = {
+  {{0}}, // MATRIX_IDENTITY, scored with MATCH_SCORE and MISMATCH_SCORE
+  { // MATRIX_DNA, from NUC.4.4
+    // A  C  G  T  N
+    { 5,-4,-4,-4,-2},
+    {-4, 5,-4,-4,-2},
+    {-4,-4, 5,-4,-2},
+    {-4,-4,-4, 5,-2},
+    {-2,-2,-2,-2,-1},
+  },
+  { // MATRIX_BLOSUM62, from NCBI
+    // A  R  N  D  C  Q  E  G  H  I  L  K  M  F  P  S  T  W  Y  V  B  Z  X  *
+    { 4,-1,-2,-2, 0,-1,-1, 0,-2,-1,-1,-1,-1,-2,-1, 1, 0,-3,-2, 0,-2,-1, 0,-4},
+    {-1, 5, 0,-2,-3, 1, 0,-2, 0,-3,-2, 2,-1,-3,-2,-1,-1,-3,-2,-3,-1, 0,-1,-4},
+    {-2, 0, 6, 1,-3, 0, 0, 0, 1,-3,-3, 0,-2,-3,-2, 1, 0,-4,-2,-3, 3, 0,-1,-4},
+    {-2,-2, 1, 6,-3, 0, 2,-1,-1,-3,-4,-1,-3,-3,-1, 0,-1,-4,-3,-3, 4, 1,-1,-4},
+    { 0,-3,-3,-3, 9,-3,-4,-3,-3,-1,-1,-3,-1,-2,-3,-1,-1,-2,-2,-1,-3,-3,-2,-4},
+    {-1, 1, 0, 0,-3, 5, 2,-2, 0,-3,-2, 1, 0,-3,-1, 0,-1,-2,-1,-2, 0, 3,-1,-4},
+    {-1, 0, 0, 2,-4, 2, 5,-2, 0,-3,-3, 1,-2,-3,-1, 0,-1,-3,-2,-2, 1, 4,-1,-4},
+    { 0,-2, 0,-1,-3,-2,-2, 6,-2,-4,-4,-2,-3,-3,-2, 0,-2,-2,-3,-3,-1,-2,-1,-4},
+    {-2, 0, 1,-1,-3, 0, 0,-2, 8,-3,-3,-1,-2,-1,-2,-1,-2,-2, 2,-3, 0, 0,-1,-4},
+    {-1,-3,-3,-3,-1,-3,-3,-4,-3, 4, 2,-3, 1, 0,-3,-2,-1,-3,-1, 3,-3,-3,-1,-4},
+    {-1,-2,-3,-4,-1,-2,-3,-4,-3, 2, 4,-2, 2, 0,-3,-2,-1,-2,-1, 1,-4,-3,-1,-4},
+    {-1, 2, 0,-1,-3, 1, 1,-2,-1,-3,-2, 5,-1,-3,-1, 0,-1,-3,-2,-2, 0, 1,-1,-4},
+    {-1,-1,-2,-3,-1, 0,-2,-3,-2, 1, 2,-1, 5, 0,-2,-1,-1,-1,-1, 1,-3,-1,-1,-4},
+    {-2,-3,-3,-3,-2,-3,-3,-3,-1, 0, 0,-3, 0, 6,-4,-2,-2, 1, 3,-1,-3,-3,-1,-4},
+    {-1,-2,-2,-1,-3,-1,-1,-2,-2,-3,-3,-1,-2,-4, 7,-1,-1,-4,-3,-2,-2,-1,-2,-4},
+    { 1,-1, 1, 0,-1, 0, 0, 0,-1,-2,-2, 0,-1,-2,-1, 4, 1,-3,-2,-2, 0, 0, 0,-4},
+    { 0,-1, 0,-1,-1,-1,-1,-2,-2,-1,-1,-1,-1,-2,-1, 1, 5,-2,-2, 0,-1,-1, 0,-4},
+    {-3,-3,-4,-4,-2,-2,-3,-2,-2,-3,-2,-3,-1, 1,-4,-3,-2,11, 2,-3,-4,-3,-2,-4},
+    {-2,-2,-2,-3,-2,-1,-2,-3, 2,-1,-1,-2,-1, 3,-3,-2,-2, 2, 7,-1,-3,-2,-1,-4},
+    { 0,-3,-3,-3,-1,-2,-2,-3,-3, 3, 1,-2, 1,-1,-2,-2, 0,-3,-1, 4,-3,-2,-1,-4},
+    {-2,-1, 3, 4,-3, 0, 1,-1, 0,-3,-4, 0,-3,-3,-2, 0,-1,-4,-3,-3, 4, 1,-1,-4},
+    {-1, 0, 0, 1,-3, 3, 4,-2, 0,-3,-3, 1,-1,-3,-1, 0,-1,-3,-2,-2, 1, 4,-1,-4},
+    { 0,-1,-1,-1,-2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-2, 0, 0,-2,-1,-1,-1,-1,-1,-4},
+    {-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4, 1},
+  },
+  { // MATRIX_PAM250, from NCBI
+    // A  R  N  D  C  Q  E  G  H  I  L  K  M  F  P  S  T  W  Y  V  B  Z  X  *
+    { 2,-2, 0, 0,-2, 0, 0, 1,-1,-1,-2,-1,-1,-3, 1, 1, 1,-6,-3, 0, 0, 0, 0,-8},
+    {-2, 6, 0,-1,-4, 1,-1,-3, 2,-2,-3, 3, 0,-4, 0, 0,-1, 2,-4,-2,-1, 0,-1,-8},
+    { 0, 0, 2, 2,-4, 1, 1, 0, 2,-2,-3, 1,-2,-3, 0, 1, 0,-4,-2,-2, 2, 1, 0,-8},
+    { 0,-1, 2, 4,-5, 2, 3, 1, 1,-2,-4, 0,-3,-6,-1, 0, 0,-7,-4,-2, 3, 3,-1,-8},
+    {-2,-4,-4,-5,12,-5,-5,-3,-3,-2,-6,-5,-5,-4,-3, 0,-2,-8, 0,-2,-4,-5,-3,-8},
+    { 0, 1, 1, 2,-5, 4, 2,-1, 3,-2,-2, 1,-1,-5, 0,-1,-1,-5,-4,-2, 1, 3,-1,-8},
+    { 0,-1, 1, 3,-5, 2, 4, 0, 1,-2,-3, 0,-2,-5,-1, 0, 0,-7,-4,-2, 3, 3,-1,-8},
+    { 1,-3, 0, 1,-3,-1, 0, 5,-2,-3,-4,-2,-3,-5, 0, 1, 0,-7,-5,-1, 0, 0,-1,-8},
+    {-1, 2, 2, 1,-3, 3, 1,-2, 6,-2,-2, 0,-2,-2, 0,-1,-1,-3, 0,-2, 1, 2,-1,-8},
+    {-1,-2,-2,-2,-2,-2,-2,-3,-2, 5, 2,-2, 2, 1,-2,-1, 0,-5,-1, 4,-2,-2,-1,-8},
+    {-2,-3,-3,-4,-6,-2,-3,-4,-2, 2, 6,-3, 4, 2,-3,-3,-2,-2,-1, 2,-3,-3,-1,-8},
+    {-1, 3, 1, 0,-5, 1, 0,-2, 0,-2,-3, 5, 0,-5,-1, 0, 0,-3,-4,-2, 1, 0,-1,-8},
+    {-1, 0,-2,-3,-5,-1,-2,-3,-2, 2, 4, 0, 6, 0,-2,-2,-1,-4,-2, 2,-2,-2,-1,-8},
+    {-3,-4,-3,-6,-4,-5,-5,-5,-2, 1, 2,-5, 0, 9,-5,-3,-3, 0, 7,-1,-4,-5,-2,-8},
+    { 1, 0, 0,-1,-3, 0,-1, 0, 0,-2,-3,-1,-2,-5, 6, 1, 0,-6,-5,-1,-1, 0,-1,-8},
+    { 1, 0, 1, 0, 0,-1, 0, 1,-1,-1,-3, 0,-2,-3, 1, 2, 1,-2,-3,-1, 0, 0, 0,-8},
+    { 1,-1, 0, 0,-2,-1, 0, 0,-1, 0,-2, 0,-1,-3, 0, 1, 3,-5,-3, 0, 0,-1, 0,-8},
+    {-6, 2,-4,-7,-8,-5,-7,-7,-3,-5,-2,-3,-4, 0,-6,-2,-5,17, 0,-6,-5,-6,-4,-8},
+    {-3,-4,-2,-4, 0,-4,-4,-5, 0,-1,-1,-4,-2, 7,-5,-3,-3, 0,10,-2,-3,-4,-2,-8},
+    { 0,-2,-2,-2,-2,-2,-2,-1,-2, 4, 2,-2, 2,-1,-1,-1, 0,-6,-2, 4,-2,-2,-1,-8},
+    { 0,-1, 2, 3,-4, 1, 3, 0, 1,-2,-3, 1,-2,-4,-1, 0, 0,-5,-3,-2, 3, 2,-1,-8},
+    { 0, 0, 1, 3,-5, 3, 3, 0, 2,-2,-3, 0,-2,-5, 0, 0,-1,-6,-4,-2, 2, 3,-1,-8},
+    { 0,-1, 0,-1,-3,-1,-1,-1,-1,-1,-1,-1,-1,-2,-1, 0, 0,-4,-2,-1,-1,-1,-1,-8},
+    {-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8, 1},
+  },
+};
+
+int parse_matrix(const char* name, matrix_t* matrix) {
+  for (int k = 0; k < NUM_MATRICES; ++k) {
+    if (strcmp(name, kNames[k]) == 0) {
+      *matrix = (matrix_t)k;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+const char* matrix_name(const matrix_t matrix) {
+  return kNames[matrix];
+}
+
+int matrix_num_codes(const matrix_t matrix) {
+  return matrix == MATRIX_IDENTITY ? 256 : (int)strlen(kAlphabet[matrix]);
+}
+
+int matrix_min_score(const matrix_t matrix) {
+  if (matrix == MATRIX_IDENTITY) {
+    return MATCH_SCORE < MISMATCH_SCORE ? MATCH_SCORE : MISMATCH_SCORE;
+  }
+  const int kNumCodes = matrix_num_codes(matrix);
+  int score = SUBSTITUTION_SCORES[matrix][0][0];
+  for (int x = 0; x < kNumCodes; ++x) {
+    for (int y = 0; y < kNumCodes; ++y) {
+      score = SUBSTITUTION_SCORES[matrix][x][y] < score ?
+        SUBSTITUTION_SCORES[matrix][x][y] : score;
+    }
+  }
+  return score;
+}
+
+int matrix_max_score(const matrix_t matrix) {
+  if (matrix == MATRIX_IDENTITY) {
+    return MATCH_SCORE > MISMATCH_SCORE ? MATCH_SCORE : MISMATCH_SCORE;
+  }
+  const int kNumCodes = matrix_num_codes(matrix);
+  int score = SUBSTITUTION_SCORES[matrix][0][0];
+  for (int x = 0; x < kNumCodes; ++x) {
+    for (int y = 0; y < kNumCodes; ++y) {
+      score = SUBSTITUTION_SCORES[matrix][x][y] > score ?
+        SUBSTITUTION_SCORES[matrix][x][y] : score;
+    }
+  }
+  return score;
+}
+
+void build_symbol_codes(const matrix_t matrix, uint8_t* codes) {
+  if (matrix == MATRIX_IDENTITY) {
+    for (int c = 0; c < 256; ++c) {
+      codes[c] = (uint8_t)c;
+    }
+    return;
+  }
+  const char* kSymbols = kAlphabet[matrix];
+  const int kNumCodes = strlen(kSymbols);
+  const uint8_t kUnknown = matrix == MATRIX_DNA ? kNumCodes - 1 : kNumCodes - 2;
+  memset(codes, kUnknown, 256);
+  for (int k = 0; k < kNumCodes; ++k) {
+    codes[(uint8_t)kSymbols[k]] = k;
+    codes[(uint8_t)tolower(kSymbols[k])] = k;
+  }
+  if (matrix == MATRIX_DNA) {
+    codes['U'] = codes['u'] = codes['T'];
+  }
+}
+
+uint8_t* encode_sequence(const matrix_t matrix, const char* X, const int m) {
+  uint8_t codes[256];
+  build_symbol_codes(matrix, codes);
+  uint8_t* X_codes = malloc(sizeof(uint8_t) * (m + 1));
+  if (X_codes == NULL) {
+    fprintf(stderr, "ERROR. Unable to encode a sequence of length %d\n", m);
+    exit(1);
+  }
+  for (int i = 0; i < m; ++i) {
+    X_codes[i] = codes[(uint8_t)X[i]];
+  }
+  X_codes[m] = 0;
+  return X_codes;
+}
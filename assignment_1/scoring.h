@@ -0,0 +1,117 @@
+/*
+ * File:  scoring.h
+ * Author: Stefano Ribes
+ */
+#ifndef SCORING_H_
+#define SCORING_H_
+
+#include "alignment.h"
+
+#include <stdint.h>
+
+#define ALPHABET_CODES 32 // Encoded symbols fit in 5 bits
+
+/*
+ * @brief      Substitution matrices. Except for MATRIX_IDENTITY, which scores
+ *             the raw characters with MATCH_SCORE and MISMATCH_SCORE, the
+ *             sequences are first encoded: DNA in 5 codes (ACGT, plus one code
+ *             for N and any other character) and proteins in 5 bits.
+ */
+typedef enum {
+  MATRIX_IDENTITY,
+  MATRIX_DNA,
+  MATRIX_BLOSUM62,
+  MATRIX_PAM250,
+  NUM_MATRICES
+} matrix_t;
+
+extern const int8_t SUBSTITUTION_SCORES[NUM_MATRICES][ALPHABET_CODES]
+  [ALPHABET_CODES];
+
+/**
+ * @brief      Gets the score of aligning two encoded symbols. The kernels call
+ *             it with a compile-time constant matrix, so that it reduces to a
+ *             branch-free table lookup (or compare and select).
+ *
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  x       The encoded X symbol
+ * @param[in]  y       The encoded Y symbol
+ *
+ * @return     The substitution score.
+ */
+static inline int substitution_score(const matrix_t matrix, const uint8_t x,
+    const uint8_t y) {
+  if (matrix == MATRIX_IDENTITY) {
+    return x == y ? MATCH_SCORE : MISMATCH_SCORE;
+  }
+  return SUBSTITUTION_SCORES[matrix][x][y];
+}
+
+/**
+ * @brief      Gets a substitution matrix from its name: identity, dna,
+ *             blosum62 or pam250.
+ *
+ * @param[in]  name    The matrix name
+ * @param      matrix  The matrix
+ *
+ * @return     Zero on success, non-zero if the name is unknown.
+ */
+int parse_matrix(const char* name, matrix_t* matrix);
+
+/**
+ * @brief      Gets the name of a substitution matrix.
+ *
+ * @param[in]  matrix  The matrix
+ *
+ * @return     The matrix name.
+ */
+const char* matrix_name(const matrix_t matrix);
+
+/**
+ * @brief      Gets the number of symbol codes of a matrix alphabet.
+ *
+ * @param[in]  matrix  The matrix
+ *
+ * @return     The number of codes, 256 for MATRIX_IDENTITY.
+ */
+int matrix_num_codes(const matrix_t matrix);
+
+/**
+ * @brief      Gets the lowest score of a matrix.
+ *
+ * @param[in]  matrix  The matrix
+ *
+ * @return     The lowest substitution score.
+ */
+int matrix_min_score(const matrix_t matrix);
+
+/**
+ * @brief      Gets the highest score of a matrix.
+ *
+ * @param[in]  matrix  The matrix
+ *
+ * @return     The highest substitution score.
+ */
+int matrix_max_score(const matrix_t matrix);
+
+/**
+ * @brief      Builds the lookup table from characters to the codes of a matrix
+ *             alphabet. Lowercase letters are encoded as uppercase ones.
+ *
+ * @param[in]  matrix  The matrix
+ * @param      codes   The 256-entry lookup table
+ */
+void build_symbol_codes(const matrix_t matrix, uint8_t* codes);
+
+/**
+ * @brief      Encodes a sequence in the alphabet of a matrix.
+ *
+ * @param[in]  matrix  The matrix
+ * @param[in]  X       The sequence
+ * @param[in]  m       The length of the sequence
+ *
+ * @return     The heap allocated codes, to be freed by the caller.
+ */
+uint8_t* encode_sequence(const matrix_t matrix, const char* X, const int m);
+
+#endif // end SCORING_H_
@@ -0,0 +1,466 @@
+/*
+ * @author     Stefano Ribes
+ *
+ * @brief      Seed-and-extend local alignment of many queries against a
+ *             reference.
+ *
+ * @details    To compile this C program, type:
+ *
+ *             make seed_extend.exe
+ *
+ *             To run the program, type:
+ *
+ *             ./seed_extend.exe [--k K] [--step S] [--max-occ N]
+ *               [--min-seeds C] [--xdrop X] [--zdrop Z] [--min-score M]
+ *               [--max-hits H] [--threads N] [--matrix identity|dna]
+ *               reference.fa queries.fa
+ *
+ *             The reference is a nucleotide FASTA file, opened through the
+ *             sequence store: its .fai index and packed targets are built by
+ *             the first run and then only mapped. The queries are either in
+ *             FASTA format or one sequence per line. The k-mers of the
+ *             reference starting every S bases are indexed (K = 15 and S = 4
+ *             by default), then each query looks up all of its k-mers,
+ *             skipping those occurring more than N times in the reference.
+ *             The seed hits are chained along the diagonals and each chain of
+ *             at least C seeds (2 by default) is extended from one of its
+ *             seeds in both directions with the X-drop recurrence, so that
+ *             only the cells around the alignment are filled. With the default
+ *             scores, the alignment of two random sequences drifts upwards, so
+ *             a lone seed would be extended over the whole query.
+ *
+ *             For each alignment scoring at least M, at most H per query, the
+ *             program prints a tab-separated line: query name, length, start
+ *             and end, target name, length, start and end (0-based, end
+ *             excluded), score and number of seeds of its chain.
+ */
+#include "alignment.h"
+#include "kmer_index.h"
+#include "scoring.h"
+#include "seq_store.h"
+#include "sequence_io.h"
+#include "xdrop.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#define DEFAULT_K 15
+#define DEFAULT_STEP 4
+#define DEFAULT_MAX_OCC 256 // Seeds occurring more often are skipped
+#define DEFAULT_XDROP 30
+#define DEFAULT_ZDROP 100
+#define DEFAULT_MIN_SCORE 40
+#define DEFAULT_MAX_HITS 5
+#define DEFAULT_MIN_SEEDS 2 // Chains with fewer seeds are not extended
+#define CHAIN_BAND 16 // Largest diagonal gap between two seeds of a chain
+
+#define USAGE "ERROR. Usage: %s [--k K] [--step S] [--max-occ N] " \
+  "[--min-seeds C] [--xdrop X] [--zdrop Z] [--min-score M] [--max-hits H] " \
+  "[--threads N] [--matrix identity|dna] reference.fa queries.fa\n"
+
+/*
+ * @brief      Reference: the packed targets of a sequence store. The text
+ *             position of symbol i of a target is starts[target] + i, as in
+ *             the k-mer index.
+ */
+typedef struct {
+  seq_store_t store;
+  size_t* starts;
+} reference_t;
+
+/*
+ * @brief      Seed hit: a k-mer of the query found in the text.
+ */
+typedef struct {
+  long diag; // Text position minus query position
+  int q; // Query position
+} seed_t;
+
+/*
+ * @brief      Chain of seeds on nearby diagonals.
+ */
+typedef struct {
+  int q; // Anchor seed, i.e. the first one of the chain
+  size_t t;
+  int num_seeds;
+} chain_t;
+
+/*
+ * @brief      Local alignment of a query, in target coordinates.
+ */
+typedef struct {
+  int target;
+  int q_start;
+  int q_end;
+  int t_start;
+  int t_end;
+  int score;
+  int num_seeds;
+} hit_t;
+
+/*
+ * @brief      Alignment parameters.
+ */
+typedef struct {
+  matrix_t matrix;
+  int max_occ;
+  int min_seeds;
+  int xdrop;
+  int zdrop;
+  int min_score;
+  int max_hits;
+  uint8_t codes[256]; // Nucleotide codes of the store
+} params_t;
+
+/**
+ * @brief      Gets the elapsed time in seconds since a given time point.
+ *
+ * @param[in]  start  The start time point
+ *
+ * @return     The elapsed time in seconds.
+ */
+static double elapsed_time(const struct timespec start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+static int compare_seeds(const void* a, const void* b) {
+  const seed_t* x = a;
+  const seed_t* y = b;
+  if (x->diag != y->diag) {
+    return x->diag < y->diag ? -1 : 1;
+  }
+  return (x->q > y->q) - (x->q < y->q);
+}
+
+static int compare_chains(const void* a, const void* b) {
+  const chain_t* x = a;
+  const chain_t* y = b;
+  return (y->num_seeds > x->num_seeds) - (y->num_seeds < x->num_seeds);
+}
+
+static int compare_hits(const void* a, const void* b) {
+  const hit_t* x = a;
+  const hit_t* y = b;
+  return (y->score > x->score) - (y->score < x->score);
+}
+
+/**
+ * @brief      Opens the reference, i.e. maps its packed targets.
+ *
+ * @param[in]  filename  The FASTA filename
+ * @param      ref       The reference
+ */
+static void open_reference(const char* filename, reference_t* ref) {
+  if (seq_store_open(&ref->store, filename)) {
+    exit(1);
+  }
+  if (ref->store.alphabet != MATRIX_DNA) {
+    fprintf(stderr, "ERROR. %s is not a nucleotide FASTA file\n", filename);
+    exit(1);
+  }
+  ref->starts = malloc(sizeof(size_t) * (ref->store.num_sequences + 1));
+  if (ref->starts == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the reference targets\n");
+    exit(1);
+  }
+  for (int t = 0; t < ref->store.num_sequences; ++t) {
+    ref->starts[t] = ref->store.records[t].word_offset *
+      seq_store_symbols_per_word(&ref->store);
+  }
+}
+
+/**
+ * @brief      Gets the target holding a text position.
+ *
+ * @param[in]  ref   The reference
+ * @param[in]  pos   The text position
+ *
+ * @return     The target index.
+ */
+static int find_target(const reference_t* ref, const size_t pos) {
+  int lo = 0;
+  int hi = ref->store.num_sequences - 1;
+  while (lo < hi) {
+    const int kMid = lo + (hi - lo + 1) / 2;
+    if (ref->starts[kMid] <= pos) {
+      lo = kMid;
+    } else {
+      hi = kMid - 1;
+    }
+  }
+  return lo;
+}
+
+/**
+ * @brief      Finds the seed hits of a query, skipping the k-mers occurring
+ *             more than max_occ times.
+ *
+ * @param[in]  index    The index
+ * @param[in]  Q        The query
+ * @param[in]  m        The length of the query
+ * @param[in]  max_occ  The largest number of occurrences of a seed
+ * @param      seeds    The seeds, reallocated as needed
+ * @param      size     The capacity of the seeds array
+ *
+ * @return     The number of seeds.
+ */
+static size_t find_seeds(const kmer_index_t* index, const char* Q, const int m,
+    const int max_occ, seed_t** seeds, size_t* size) {
+  const int k = index->k;
+  const uint32_t kMask = k == 16 ? 0xFFFFFFFFu : (1u << (2 * k)) - 1;
+  uint32_t kmer = 0;
+  int run = 0;
+  size_t num_seeds = 0;
+  for (int q = 0; q < m; ++q) {
+    const int kCode = kmer_base_code(Q[q]);
+    if (kCode < 0) {
+      run = 0;
+      continue;
+    }
+    kmer = ((kmer << 2) | kCode) & kMask;
+    if (++run < k) {
+      continue;
+    }
+    size_t first;
+    const size_t kCount = kmer_index_lookup(index, kmer, &first);
+    if (kCount == 0 || kCount > (size_t)max_occ) {
+      continue;
+    }
+    if (num_seeds + kCount > *size) {
+      *size = 2 * (num_seeds + kCount);
+      *seeds = realloc(*seeds, sizeof(seed_t) * *size);
+      if (*seeds == NULL) {
+        fprintf(stderr, "ERROR. Unable to allocate %zu seeds\n", *size);
+        exit(1);
+      }
+    }
+    for (size_t e = first; e < first + kCount; ++e) {
+      const size_t kPos = (uint32_t)index->entries[e];
+      (*seeds)[num_seeds].diag = (long)kPos - (q + 1 - k);
+      (*seeds)[num_seeds].q = q + 1 - k;
+      ++num_seeds;
+    }
+  }
+  return num_seeds;
+}
+
+/**
+ * @brief      Aligns a query against the reference: its seeds are chained,
+ *             then the chains are extended from the largest one, skipping
+ *             those whose anchor lies within an alignment already found.
+ *
+ * @param[in]  ref       The reference
+ * @param[in]  index     The index of the reference
+ * @param[in]  params    The alignment parameters
+ * @param[in]  Q         The query
+ * @param[in]  m         The length of the query
+ * @param      num_hits  The number of alignments found
+ *
+ * @return     The alignments, sorted by score, to be freed by the caller.
+ */
+static hit_t* align_query(const reference_t* ref, const kmer_index_t* index,
+    const params_t* params, const char* Q, const int m, int* num_hits) {
+  size_t size = 0;
+  seed_t* seeds = NULL;
+  const size_t kNumSeeds = find_seeds(index, Q, m, params->max_occ, &seeds,
+    &size);
+  *num_hits = 0;
+  if (kNumSeeds == 0) {
+    free(seeds);
+    return NULL;
+  }
+  qsort(seeds, kNumSeeds, sizeof(seed_t), compare_seeds);
+  /*
+   * Chain the seeds whose diagonals are at most CHAIN_BAND apart, on the same
+   * target
+   */
+  chain_t* chains = malloc(sizeof(chain_t) * kNumSeeds);
+  if (chains == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate %zu chains\n", kNumSeeds);
+    exit(1);
+  }
+  size_t num_chains = 0;
+  int prev_target = -1;
+  for (size_t s = 0; s < kNumSeeds; ++s) {
+    const size_t kPos = seeds[s].diag + seeds[s].q;
+    const int kTarget = find_target(ref, kPos);
+    if (s == 0 || kTarget != prev_target ||
+        seeds[s].diag - seeds[s-1].diag > CHAIN_BAND) {
+      chains[num_chains].q = seeds[s].q;
+      chains[num_chains].t = kPos;
+      chains[num_chains].num_seeds = 0;
+      ++num_chains;
+    }
+    ++chains[num_chains-1].num_seeds;
+    prev_target = kTarget;
+  }
+  free(seeds);
+  qsort(chains, num_chains, sizeof(chain_t), compare_chains);
+  uint8_t* Q_codes = malloc(sizeof(uint8_t) * (m + 1));
+  hit_t* hits = malloc(sizeof(hit_t) * num_chains);
+  if (Q_codes == NULL || hits == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the hits of a query\n");
+    exit(1);
+  }
+  for (int i = 0; i < m; ++i) {
+    Q_codes[i] = params->codes[(uint8_t)Q[i]];
+  }
+  int kept = 0;
+  for (size_t c = 0; c < num_chains; ++c) {
+    const int kTarget = find_target(ref, chains[c].t);
+    const int q = chains[c].q;
+    const int t = chains[c].t - ref->starts[kTarget];
+    bool covered = false;
+    for (int h = 0; h < kept && !covered; ++h) {
+      covered = hits[h].target == kTarget && q >= hits[h].q_start &&
+        q < hits[h].q_end && t >= hits[h].t_start && t < hits[h].t_end;
+    }
+    if (covered || chains[c].num_seeds < params->min_seeds) {
+      continue;
+    }
+    const seq_view_t kView = seq_store_view(&ref->store, kTarget);
+    const xdrop_result_t kRight = xdrop_extend_view(Q_codes + q, m - q,
+      &kView, t, kView.length - t, 1, params->matrix, params->xdrop,
+      params->zdrop);
+    const xdrop_result_t kLeft = q > 0 && t > 0 ?
+      xdrop_extend_view(Q_codes + q - 1, q, &kView, t - 1, t, -1,
+        params->matrix,
+        params->xdrop, params->zdrop) : (xdrop_result_t){0, 0, 0};
+    hit_t hit;
+    hit.target = kTarget;
+    hit.q_start = q - kLeft.length_a;
+    hit.q_end = q + kRight.length_a;
+    hit.t_start = t - kLeft.length_b;
+    hit.t_end = t + kRight.length_b;
+    hit.score = kLeft.score + kRight.score;
+    hit.num_seeds = chains[c].num_seeds;
+    bool duplicate = false;
+    for (int h = 0; h < kept && !duplicate; ++h) {
+      duplicate = hits[h].target == hit.target &&
+        hits[h].q_start == hit.q_start && hits[h].q_end == hit.q_end &&
+        hits[h].t_start == hit.t_start && hits[h].t_end == hit.t_end;
+    }
+    if (!duplicate && hit.score >= params->min_score) {
+      hits[kept++] = hit;
+    }
+  }
+  free(chains);
+  free(Q_codes);
+  qsort(hits, kept, sizeof(hit_t), compare_hits);
+  *num_hits = kept < params->max_hits ? kept : params->max_hits;
+  return hits;
+}
+
+int main(int argc, char** argv) {
+  int k = DEFAULT_K;
+  int step = DEFAULT_STEP;
+  int num_threads = omp_get_max_threads();
+  params_t params = {MATRIX_IDENTITY, DEFAULT_MAX_OCC, DEFAULT_MIN_SEEDS,
+    DEFAULT_XDROP, DEFAULT_ZDROP, DEFAULT_MIN_SCORE, DEFAULT_MAX_HITS, {0}};
+  const char* filenames[2] = {NULL, NULL};
+  int num_files = 0;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--k") == 0 && arg + 1 < argc) {
+      k = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--step") == 0 && arg + 1 < argc) {
+      step = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--max-occ") == 0 && arg + 1 < argc) {
+      params.max_occ = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--min-seeds") == 0 && arg + 1 < argc) {
+      params.min_seeds = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--xdrop") == 0 && arg + 1 < argc) {
+      params.xdrop = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--zdrop") == 0 && arg + 1 < argc) {
+      params.zdrop = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--min-score") == 0 && arg + 1 < argc) {
+      params.min_score = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--max-hits") == 0 && arg + 1 < argc) {
+      params.max_hits = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+      num_threads = atoi(argv[++arg]);
+    } else if (strcmp(argv[arg], "--matrix") == 0 && arg + 1 < argc) {
+      if (parse_matrix(argv[++arg], &params.matrix) ||
+          (params.matrix != MATRIX_IDENTITY && params.matrix != MATRIX_DNA)) {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+      }
+    } else if (num_files < 2) {
+      filenames[num_files++] = argv[arg];
+    } else {
+      fprintf(stderr, USAGE, argv[0]);
+      exit(1);
+    }
+  }
+  if (num_files != 2 || k < 1 || k > KMER_MAX_K || step < 1) {
+    fprintf(stderr, USAGE, argv[0]);
+    exit(1);
+  }
+  /*
+   * Open the reference and index its packed targets
+   */
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  reference_t ref;
+  open_reference(filenames[0], &ref);
+  const double kOpenSeconds = elapsed_time(start);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  kmer_index_t index;
+  if (kmer_index_build_store(&index, &ref.store, k, step)) {
+    fprintf(stderr, "ERROR. Unable to index the reference\n");
+    exit(1);
+  }
+  size_t num_bases = 0;
+  for (int t = 0; t < ref.store.num_sequences; ++t) {
+    num_bases += ref.store.records[t].length;
+  }
+  // The identity matrix compares the codes, as the packed targets.
+  build_symbol_codes(MATRIX_DNA, params.codes);
+  fprintf(stderr, "[INFO] Indexed %d targets, %zu bases, %zu %d-mers in "
+    "%.3f s (opened in %.3f s)\n", ref.store.num_sequences, num_bases,
+    index.num_entries, k, elapsed_time(start), kOpenSeconds);
+  /*
+   * Align the queries in parallel, then print their alignments in order
+   */
+  int num_queries = 0;
+  sequence_t* queries = read_sequences(filenames[1], &num_queries);
+  hit_t** hits = malloc(sizeof(hit_t*) * (num_queries + 1));
+  int* num_hits = malloc(sizeof(int) * (num_queries + 1));
+  if (hits == NULL || num_hits == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the results of %d queries\n",
+      num_queries);
+    exit(1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+  for (int q = 0; q < num_queries; ++q) {
+    hits[q] = align_query(&ref, &index, &params, queries[q].seq,
+      queries[q].length, &num_hits[q]);
+  }
+  const double kSeconds = elapsed_time(start);
+  for (int q = 0; q < num_queries; ++q) {
+    for (int h = 0; h < num_hits[q]; ++h) {
+      const hit_t* kHit = &hits[q][h];
+      printf("%s\t%d\t%d\t%d\t%s\t%d\t%d\t%d\t%d\t%d\n", queries[q].name,
+        queries[q].length, kHit->q_start, kHit->q_end,
+        ref.store.records[kHit->target].name,
+        (int)ref.store.records[kHit->target].length, kHit->t_start,
+        kHit->t_end, kHit->score, kHit->num_seeds);
+    }
+    free(hits[q]);
+  }
+  fprintf(stderr, "[INFO] %d queries in %.3f s: %.1f queries/s\n",
+    num_queries, kSeconds, num_queries / (kSeconds > 0 ? kSeconds : 1e-9));
+  free(hits);
+  free(num_hits);
+  free_sequences(queries, num_queries);
+  kmer_index_free(&index);
+  free(ref.starts);
+  seq_store_close(&ref.store);
+  return 0;
+}
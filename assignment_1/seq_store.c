@@ -0,0 +1,528 @@
+/*
+ * File:  seq_store.c
+ * Author: Stefano Ribes
+ *
+ * Memory-mapped FASTA store. The packed file starts with a header of
+ * PACK_HEADER_WORDS words: magic, bits per symbol, alphabet, number of
+ * sequences, number of packed words, size of the FASTA file and number of
+ * ambiguous runs. Each sequence then starts on a word boundary, so that its
+ * view is a plain pointer into the mapping. The packed words are followed by
+ * the first ambiguous run of each sequence (plus the total) and by the runs,
+ * two words each. Opening a store with an up-to-date index only parses the
+ * .fai file and maps the two files, whatever their size.
+ */
+#include "seq_store.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PACK_HEADER_WORDS 7
+#define DNA_FRACTION 0.9 // Least fraction of ACGTUN symbols of a DNA file
+
+static bool is_newer(const struct stat* a, const struct stat* b) {
+  if (a->st_mtim.tv_sec != b->st_mtim.tv_sec) {
+    return a->st_mtim.tv_sec > b->st_mtim.tv_sec;
+  }
+  return a->st_mtim.tv_nsec > b->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief      Maps a whole file read-only.
+ *
+ * @param[in]  filename  The filename
+ * @param      size      The file size
+ *
+ * @return     The mapping, NULL on failure. An empty file is mapped to a
+ *             static empty string.
+ */
+static const void* map_file(const char* filename, size_t* size) {
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return NULL;
+  }
+  *size = st.st_size;
+  if (*size == 0) {
+    close(fd);
+    return "";
+  }
+  void* data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  return data;
+}
+
+static void unmap_file(const void* data, const size_t size) {
+  if (data != NULL && size > 0) {
+    munmap((void*)data, size);
+  }
+}
+
+/**
+ * @brief      Assigns the first packed word of each sequence.
+ *
+ * @return     The total number of packed words.
+ */
+static size_t assign_words(seq_store_t* store) {
+  const size_t kSymbols = seq_store_symbols_per_word(store);
+  size_t num_words = 0;
+  for (int s = 0; s < store->num_sequences; ++s) {
+    store->records[s].word_offset = num_words;
+    num_words += (store->records[s].length + kSymbols - 1) / kSymbols;
+  }
+  return num_words;
+}
+
+static void free_records(seq_store_t* store) {
+  for (int s = 0; s < store->num_sequences; ++s) {
+    free(store->records[s].name);
+  }
+  free(store->records);
+  store->records = NULL;
+  store->num_sequences = 0;
+}
+
+/**
+ * @brief      Gets the size of a packed file, in words.
+ */
+static size_t pack_words(const int num_sequences, const size_t num_words,
+    const size_t num_amb) {
+  return PACK_HEADER_WORDS + num_words + (num_sequences + 1) + 2 * num_amb;
+}
+
+/**
+ * @brief      Points the store to the sections of its packed file.
+ */
+static void set_sections(seq_store_t* store, const size_t num_words) {
+  store->words = store->pack + PACK_HEADER_WORDS;
+  store->amb_first = store->words + num_words;
+  store->amb = (const seq_amb_t*)(store->amb_first + store->num_sequences + 1);
+}
+
+/**
+ * @brief      Loads the .fai index and maps the packed file, checking that
+ *             they describe the mapped FASTA file.
+ *
+ * @return     Zero on success.
+ */
+static int load_index(seq_store_t* store, const char* fai_name,
+    const char* pack_name) {
+  FILE* stream = fopen(fai_name, "r");
+  if (stream == NULL) {
+    return 1;
+  }
+  int num_allocated = 0;
+  char* line = NULL;
+  size_t line_capacity = 0;
+  int error = 0;
+  while (!error && getline(&line, &line_capacity, stream) != -1) {
+    if (store->num_sequences == num_allocated) {
+      num_allocated = num_allocated ? num_allocated * 2 : 64;
+      store->records = realloc(store->records,
+        sizeof(seq_record_t) * num_allocated);
+    }
+    seq_record_t* r = &store->records[store->num_sequences];
+    char* tab = strchr(line, '\t');
+    if (tab == NULL) {
+      error = 1;
+      break;
+    }
+    *tab = 0;
+    r->name = strdup(line);
+    ++store->num_sequences;
+    error = sscanf(tab + 1, "%zu\t%zu\t%d\t%d", &r->length, &r->offset,
+      &r->line_symbols, &r->line_bytes) != 4;
+  }
+  free(line);
+  fclose(stream);
+  store->pack = map_file(pack_name, &store->pack_size);
+  if (error || store->pack == NULL ||
+      store->pack_size < PACK_HEADER_WORDS * sizeof(uint64_t) ||
+      memcmp(store->pack, SEQ_STORE_MAGIC, sizeof(uint64_t)) != 0) {
+    return 1;
+  }
+  store->bits = (int)store->pack[1];
+  store->alphabet = (matrix_t)store->pack[2];
+  if (store->bits != (store->alphabet == MATRIX_DNA ? 2 : 5) ||
+      store->pack[3] != (uint64_t)store->num_sequences ||
+      store->pack[5] != store->fasta_size) {
+    return 1;
+  }
+  const size_t kNumWords = assign_words(store);
+  const size_t kNumAmb = store->pack[6];
+  if (store->pack[4] != kNumWords || store->pack_size !=
+      pack_words(store->num_sequences, kNumWords, kNumAmb) *
+      sizeof(uint64_t)) {
+    return 1;
+  }
+  set_sections(store, kNumWords);
+  return store->amb_first[store->num_sequences] != kNumAmb;
+}
+
+/**
+ * @brief      Scans the FASTA file for the .fai records and the alphabet.
+ *
+ * @return     Zero on success, non-zero if the lines are irregular.
+ */
+static int scan_fasta(seq_store_t* store) {
+  const char* data = store->fasta;
+  const size_t kSize = store->fasta_size;
+  int num_allocated = 0;
+  size_t counts[256] = {0};
+  seq_record_t* r = NULL;
+  bool last_line = false; // Whether a short line ended the sequence
+  size_t pos = 0;
+  while (pos < kSize) {
+    const char* kEnd = memchr(data + pos, '\n', kSize - pos);
+    const size_t kNext = kEnd ? (size_t)(kEnd - data) + 1 : kSize;
+    size_t len = kNext - pos - (kEnd != NULL);
+    while (len > 0 && data[pos + len - 1] == '\r') {
+      --len;
+    }
+    if (data[pos] == '>') {
+      if (store->num_sequences == num_allocated) {
+        num_allocated = num_allocated ? num_allocated * 2 : 64;
+        store->records = realloc(store->records,
+          sizeof(seq_record_t) * num_allocated);
+      }
+      r = &store->records[store->num_sequences++];
+      size_t name_len = 0;
+      while (name_len + 1 < len &&
+          !isspace((uint8_t)data[pos + 1 + name_len])) {
+        ++name_len;
+      }
+      r->name = strndup(data + pos + 1, name_len);
+      r->length = 0;
+      r->offset = kNext;
+      r->line_symbols = 0;
+      r->line_bytes = 0;
+      last_line = false;
+    } else if (r != NULL && len > 0) {
+      if (last_line) {
+        fprintf(stderr, "ERROR. Irregular lines in sequence %s\n", r->name);
+        return 1;
+      }
+      if (r->line_symbols == 0) {
+        r->line_symbols = (int)len;
+        r->line_bytes = (int)(kNext - pos);
+      } else if ((int)len != r->line_symbols ||
+          (int)(kNext - pos) != r->line_bytes) {
+        if ((int)len > r->line_symbols) {
+          fprintf(stderr, "ERROR. Irregular lines in sequence %s\n", r->name);
+          return 1;
+        }
+        last_line = true;
+      }
+      for (size_t i = pos; i < pos + len; ++i) {
+        ++counts[(uint8_t)data[i]];
+      }
+      r->length += len;
+    } else if (r != NULL) {
+      last_line = r->length > 0; // A blank line ends the sequence
+    }
+    pos = kNext;
+  }
+  /*
+   * Alphabet: mostly nucleotides in 2 bits, with the other symbols as N in the
+   * ambiguous runs, otherwise protein in 5 bits
+   */
+  size_t acgt = 0;
+  size_t n = counts['N'] + counts['n'];
+  size_t total = 0;
+  for (int c = 0; c < 256; ++c) {
+    total += counts[c];
+    acgt += c != 0 && strchr("ACGTUacgtu", c) ? counts[c] : 0;
+  }
+  store->alphabet = acgt + n >= DNA_FRACTION * total ? MATRIX_DNA :
+    MATRIX_BLOSUM62;
+  store->bits = store->alphabet == MATRIX_DNA ? 2 : 5;
+  return 0;
+}
+
+/**
+ * @brief      Packs a sequence of the FASTA file. The ambiguous symbols of a
+ *             DNA sequence are packed as A, and their runs are appended to a
+ *             list.
+ *
+ * @param[in]  store    The store
+ * @param[in]  r        The record of the sequence
+ * @param[in]  codes    The codes of the symbols
+ * @param      w        The packed words of the sequence, zeroed
+ * @param      amb      The ambiguous runs, to be freed by the caller
+ *
+ * @return     The number of ambiguous runs.
+ */
+static size_t pack_sequence(const seq_store_t* store, const seq_record_t* r,
+    const uint8_t* codes, uint64_t* w, seq_amb_t** amb) {
+  const size_t kSymbols = seq_store_symbols_per_word(store);
+  // Code of N, i.e. of any symbol other than ACGT (and U)
+  const int kAmbiguous = store->alphabet == MATRIX_DNA ?
+    matrix_num_codes(MATRIX_DNA) - 1 : -1;
+  size_t num_amb = 0;
+  size_t num_allocated = 0;
+  bool in_run = false;
+  size_t i = 0;
+  *amb = NULL;
+  for (size_t line = 0; i < r->length; ++line) {
+    const char* kLine = store->fasta + r->offset + line * r->line_bytes;
+    for (int c = 0; c < r->line_symbols && i < r->length; ++c, ++i) {
+      uint8_t code = codes[(uint8_t)kLine[c]];
+      const bool kIsAmbiguous = code == kAmbiguous;
+      if (kIsAmbiguous) {
+        if (!in_run) {
+          if (num_amb == num_allocated) {
+            num_allocated = num_allocated ? num_allocated * 2 : 16;
+            *amb = realloc(*amb, sizeof(seq_amb_t) * num_allocated);
+          }
+          (*amb)[num_amb].start = i;
+          (*amb)[num_amb].length = 0;
+          ++num_amb;
+        }
+        ++(*amb)[num_amb-1].length;
+        code = 0;
+      }
+      in_run = kIsAmbiguous;
+      w[i / kSymbols] |= (uint64_t)code << ((i % kSymbols) * store->bits);
+    }
+  }
+  return num_amb;
+}
+
+/**
+ * @brief      Packs the sequences of the FASTA file.
+ *
+ * @return     The packed file, header included, to be freed by the caller.
+ */
+static uint64_t* pack_sequences(seq_store_t* store, size_t* num_words,
+    size_t* size) {
+  *num_words = assign_words(store);
+  const int kNumSequences = store->num_sequences;
+  uint64_t* pack = calloc(pack_words(kNumSequences, *num_words, 0),
+    sizeof(uint64_t));
+  seq_amb_t** amb = calloc(kNumSequences + 1, sizeof(seq_amb_t*));
+  size_t* num_amb = calloc(kNumSequences + 1, sizeof(size_t));
+  if (pack == NULL || amb == NULL || num_amb == NULL) {
+    free(pack);
+    free(amb);
+    free(num_amb);
+    return NULL;
+  }
+  uint8_t codes[256];
+  build_symbol_codes(store->alphabet, codes);
+  uint64_t* words = pack + PACK_HEADER_WORDS;
+  #pragma omp parallel for schedule(dynamic)
+  for (int s = 0; s < kNumSequences; ++s) {
+    const seq_record_t* r = &store->records[s];
+    num_amb[s] = pack_sequence(store, r, codes, words + r->word_offset,
+      &amb[s]);
+  }
+  /*
+   * Append the ambiguous runs, sequence by sequence
+   */
+  size_t total_amb = 0;
+  for (int s = 0; s < kNumSequences; ++s) {
+    total_amb += num_amb[s];
+  }
+  *size = pack_words(kNumSequences, *num_words, total_amb) * sizeof(uint64_t);
+  uint64_t* grown = realloc(pack, *size);
+  if (grown == NULL) {
+    free(pack);
+    pack = NULL;
+  } else {
+    pack = grown;
+    memcpy(pack, SEQ_STORE_MAGIC, sizeof(uint64_t));
+    pack[1] = store->bits;
+    pack[2] = store->alphabet;
+    pack[3] = kNumSequences;
+    pack[4] = *num_words;
+    pack[5] = store->fasta_size;
+    pack[6] = total_amb;
+    uint64_t* amb_first = pack + PACK_HEADER_WORDS + *num_words;
+    seq_amb_t* runs = (seq_amb_t*)(amb_first + kNumSequences + 1);
+    size_t first = 0;
+    for (int s = 0; s < kNumSequences; ++s) {
+      amb_first[s] = first;
+      if (num_amb[s] > 0) {
+        memcpy(runs + first, amb[s], sizeof(seq_amb_t) * num_amb[s]);
+      }
+      first += num_amb[s];
+    }
+    amb_first[kNumSequences] = first;
+  }
+  for (int s = 0; s < kNumSequences; ++s) {
+    free(amb[s]);
+  }
+  free(amb);
+  free(num_amb);
+  return pack;
+}
+
+/**
+ * @brief      Writes a file through a temporary one, so that a concurrent
+ *             open never sees a partial file.
+ *
+ * @return     Zero on success.
+ */
+static int write_file(const char* filename, const void* data,
+    const size_t size) {
+  const size_t kLength = strlen(filename) + 8;
+  char* tmp_name = malloc(kLength);
+  snprintf(tmp_name, kLength, "%s.tmp", filename);
+  FILE* stream = fopen(tmp_name, "wb");
+  int error = stream == NULL;
+  if (!error) {
+    error = fwrite(data, 1, size, stream) != size;
+    error |= fclose(stream) != 0;
+    error = error || rename(tmp_name, filename) != 0;
+    if (error) {
+      remove(tmp_name);
+    }
+  }
+  free(tmp_name);
+  return error;
+}
+
+/**
+ * @brief      Builds the .fai index and the packed file, and writes them next
+ *             to the FASTA file.
+ *
+ * @return     Zero on success.
+ */
+static int build_index(seq_store_t* store, const char* fai_name,
+    const char* pack_name) {
+  if (scan_fasta(store)) {
+    return 1;
+  }
+  size_t num_words;
+  size_t pack_size;
+  uint64_t* pack = pack_sequences(store, &num_words, &pack_size);
+  if (pack == NULL) {
+    fprintf(stderr, "ERROR. Unable to pack %zu words\n", num_words);
+    return 1;
+  }
+  size_t fai_capacity = 64;
+  for (int s = 0; s < store->num_sequences; ++s) {
+    fai_capacity += strlen(store->records[s].name) + 96;
+  }
+  char* fai = malloc(fai_capacity);
+  size_t fai_size = 0;
+  for (int s = 0; s < store->num_sequences; ++s) {
+    const seq_record_t* r = &store->records[s];
+    fai_size += snprintf(fai + fai_size, fai_capacity - fai_size,
+      "%s\t%zu\t%zu\t%d\t%d\n", r->name, r->length, r->offset,
+      r->line_symbols, r->line_bytes);
+  }
+  const bool kWritten = write_file(pack_name, pack, pack_size) == 0 &&
+    write_file(fai_name, fai, fai_size) == 0;
+  free(fai);
+  if (kWritten) {
+    free(pack);
+    store->pack = map_file(pack_name, &store->pack_size);
+  }
+  if (!kWritten || store->pack == NULL) {
+    fprintf(stderr, "[INFO] Unable to write the index of the FASTA file, "
+      "keeping it in memory\n");
+    store->pack = pack;
+    store->pack_size = 0; // Owned, not mapped
+  }
+  set_sections(store, num_words);
+  return 0;
+}
+
+int seq_store_open(seq_store_t* store, const char* filename) {
+  memset(store, 0, sizeof(seq_store_t));
+  store->fasta = map_file(filename, &store->fasta_size);
+  if (store->fasta == NULL) {
+    fprintf(stderr, "ERROR. Unable to open %s\n", filename);
+    return 1;
+  }
+  const size_t kLength = strlen(filename) + 8;
+  char* fai_name = malloc(kLength);
+  char* pack_name = malloc(kLength);
+  snprintf(fai_name, kLength, "%s.fai", filename);
+  snprintf(pack_name, kLength, "%s.pack", filename);
+  struct stat fasta_st, fai_st, pack_st;
+  int error = 1;
+  if (stat(filename, &fasta_st) == 0 && stat(fai_name, &fai_st) == 0 &&
+      stat(pack_name, &pack_st) == 0 && !is_newer(&fasta_st, &fai_st) &&
+      !is_newer(&fasta_st, &pack_st)) {
+    error = load_index(store, fai_name, pack_name);
+  }
+  if (error) {
+    unmap_file(store->pack, store->pack_size);
+    store->pack = NULL;
+    free_records(store);
+    error = build_index(store, fai_name, pack_name);
+  }
+  free(fai_name);
+  free(pack_name);
+  if (error) {
+    seq_store_close(store);
+  }
+  return error;
+}
+
+void seq_store_close(seq_store_t* store) {
+  unmap_file(store->fasta, store->fasta_size);
+  if (store->pack_size > 0) {
+    unmap_file(store->pack, store->pack_size);
+  } else {
+    free((void*)store->pack);
+  }
+  free_records(store);
+  memset(store, 0, sizeof(seq_store_t));
+}
+
+seq_view_t seq_store_view(const seq_store_t* store, const int s) {
+  seq_view_t view;
+  view.words = store->words + store->records[s].word_offset;
+  view.length = store->records[s].length;
+  view.bits = store->bits;
+  view.amb = store->amb + store->amb_first[s];
+  view.num_amb = store->amb_first[s+1] - store->amb_first[s];
+  return view;
+}
+
+void seq_store_fetch(const seq_store_t* store, const int s, const size_t start,
+    const size_t length, char* out) {
+  const seq_record_t* r = &store->records[s];
+  size_t i = start;
+  size_t k = 0;
+  while (k < length) {
+    const size_t kColumn = i % r->line_symbols;
+    size_t chunk = r->line_symbols - kColumn;
+    chunk = chunk < length - k ? chunk : length - k;
+    memcpy(out + k, store->fasta + r->offset +
+      (i / r->line_symbols) * r->line_bytes + kColumn, chunk);
+    i += chunk;
+    k += chunk;
+  }
+  out[length] = 0;
+}
+
+size_t seq_view_next_amb(const seq_view_t* view, const size_t i) {
+  size_t lo = 0;
+  size_t hi = view->num_amb;
+  while (lo < hi) {
+    const size_t kMid = lo + (hi - lo) / 2;
+    if (view->amb[kMid].start + view->amb[kMid].length <= i) {
+      lo = kMid + 1;
+    } else {
+      hi = kMid;
+    }
+  }
+  return lo;
+}
@@ -0,0 +1,153 @@
+/*
+ * File:  seq_store.h
+ * Author: Stefano Ribes
+ */
+#ifndef SEQ_STORE_H_
+#define SEQ_STORE_H_
+
+#include "scoring.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SEQ_STORE_MAGIC "SEQPACK2"
+
+/*
+ * @brief      Entry of the .fai index of a FASTA file, as in samtools faidx.
+ */
+typedef struct {
+  char* name; // Header up to the first whitespace
+  size_t length; // Number of symbols
+  size_t offset; // File offset of the first symbol
+  int line_symbols; // Symbols per line (except the last one)
+  int line_bytes; // Bytes per line, newline included
+  size_t word_offset; // First word of the packed sequence
+} seq_record_t;
+
+/*
+ * @brief      Run of ambiguous symbols of a DNA sequence, i.e. of symbols
+ *             other than ACGT (and U), such as N. As in the .amb file of BWA,
+ *             they are packed as A and listed aside.
+ */
+typedef struct {
+  uint64_t start; // First symbol, within the sequence
+  uint64_t length;
+} seq_amb_t;
+
+/*
+ * @brief      Zero-copy view of a packed sequence. Symbol i is the code of
+ *             the store alphabet, as encoded by encode_sequence(): 2 bits for
+ *             DNA, 32 symbols per word, with the ambiguous runs listed aside,
+ *             and 5 bits for proteins, 12 symbols per word.
+ */
+typedef struct {
+  const uint64_t* words;
+  size_t length;
+  int bits;
+  const seq_amb_t* amb; // Ambiguous runs, by increasing start
+  size_t num_amb;
+} seq_view_t;
+
+/*
+ * @brief      FASTA file opened for random access. The FASTA file, its .fai
+ *             index and the packed sequences (FASTA.pack) are memory-mapped.
+ *             The index and the packed file are built by the first open and
+ *             rebuilt whenever the FASTA file is newer. The packed file ends
+ *             with the ambiguous runs of the DNA sequences.
+ */
+typedef struct {
+  const char* fasta; // Mapped FASTA file
+  size_t fasta_size;
+  const uint64_t* pack; // Mapped packed file, header included
+  size_t pack_size; // Zero if the packed file is only held in memory
+  const uint64_t* words; // Packed sequences
+  const uint64_t* amb_first; // First ambiguous run of each sequence, and end
+  const seq_amb_t* amb; // Ambiguous runs of the DNA sequences
+  int bits; // Bits per symbol, 2 (DNA) or 5 (proteins)
+  matrix_t alphabet; // MATRIX_DNA or MATRIX_BLOSUM62 (and PAM250) codes
+  int num_sequences;
+  seq_record_t* records;
+} seq_store_t;
+
+/**
+ * @brief      Opens a FASTA file, building its index and packed file if they
+ *             are missing or older than it. When they cannot be written next
+ *             to the FASTA file, they are built in memory.
+ *
+ * @param      store     The store
+ * @param[in]  filename  The FASTA filename
+ *
+ * @return     Zero on success, non-zero if the file cannot be mapped or its
+ *             lines are irregular, i.e. the lines of a sequence (except the
+ *             last one) have different lengths.
+ */
+int seq_store_open(seq_store_t* store, const char* filename);
+
+/**
+ * @brief      Closes the store.
+ *
+ * @param      store  The store
+ */
+void seq_store_close(seq_store_t* store);
+
+/**
+ * @brief      Gets the packed view of a sequence.
+ *
+ * @param[in]  store  The store
+ * @param[in]  s      The sequence index
+ *
+ * @return     The view, valid until the store is closed.
+ */
+seq_view_t seq_store_view(const seq_store_t* store, const int s);
+
+/**
+ * @brief      Copies a range of a sequence as characters, read through the
+ *             .fai offsets.
+ *
+ * @param[in]  store   The store
+ * @param[in]  s       The sequence index
+ * @param[in]  start   The first symbol
+ * @param[in]  length  The number of symbols
+ * @param      out     The characters, at least length + 1 of them
+ */
+void seq_store_fetch(const seq_store_t* store, const int s, const size_t start,
+    const size_t length, char* out);
+
+/**
+ * @brief      Gets the number of symbols packed in a word.
+ *
+ * @param[in]  store  The store
+ *
+ * @return     32 with 2 bits per symbol, 12 with 5 bits.
+ */
+static inline size_t seq_store_symbols_per_word(const seq_store_t* store) {
+  return store->bits == 2 ? 32 : 12;
+}
+
+/**
+ * @brief      Gets the packed code of a symbol of a sequence. The ambiguous
+ *             symbols of a DNA sequence read as A: see seq_view_next_amb().
+ *
+ * @param[in]  view  The view
+ * @param[in]  i     The symbol index
+ *
+ * @return     The code.
+ */
+static inline uint8_t seq_view_code(const seq_view_t* view, const size_t i) {
+  if (view->bits == 2) {
+    return (view->words[i >> 5] >> ((i & 31) * 2)) & 3;
+  }
+  return (view->words[i / 12] >> ((i % 12) * 5)) & 31;
+}
+
+/**
+ * @brief      Finds the first ambiguous run of a sequence ending past a symbol.
+ *
+ * @param[in]  view  The view
+ * @param[in]  i     The symbol index
+ *
+ * @return     The index of the run, view->num_amb if there is none.
+ */
+size_t seq_view_next_amb(const seq_view_t* view, const size_t i);
+
+#endif // end SEQ_STORE_H_
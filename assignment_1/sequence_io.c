@@ -0,0 +1,110 @@
+/*
+ * File:  sequence_io.c
+ * Author: Stefano Ribes
+ */
+#include "sequence_io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Strips the trailing newline (and carriage return) of a line.
+ */
+static size_t chomp(char* line, size_t len) {
+  while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')) {
+    line[--len] = 0;
+  }
+  return len;
+}
+
+static void append(sequence_t* s, int* capacity, const char* data,
+    const size_t len) {
+  if (s->length + (int)len + 1 > *capacity) {
+    while (s->length + (int)len + 1 > *capacity) {
+      *capacity = *capacity ? *capacity * 2 : 256;
+    }
+    s->seq = realloc(s->seq, *capacity);
+  }
+  memcpy(s->seq + s->length, data, len);
+  s->length += (int)len;
+  s->seq[s->length] = 0;
+}
+
+sequence_t* read_sequences(const char* filename, int* num_sequences) {
+  FILE* stream;
+  if ((stream = fopen(filename, "r")) == NULL) {
+    fprintf(stderr, "Unable to open %s\n", filename);
+    exit(1);
+  }
+  sequence_t* sequences = NULL;
+  int num_allocated = 0;
+  int num_read = 0;
+  int seq_capacity = 0;
+  int line_num = 0;
+  char* line = NULL;
+  size_t line_capacity = 0;
+  ssize_t read;
+  while ((read = getline(&line, &line_capacity, stream)) != -1) {
+    ++line_num;
+    const size_t len = chomp(line, (size_t)read);
+    if (len == 0) {
+      continue;
+    }
+    const int is_header = line[0] == '>';
+    const int is_fasta = num_read > 0 && sequences[num_read-1].name[0] != '#';
+    if (is_header || !is_fasta) {
+      if (num_read == num_allocated) {
+        num_allocated = num_allocated ? num_allocated * 2 : 64;
+        sequences = realloc(sequences, sizeof(sequence_t) * num_allocated);
+      }
+      sequence_t* s = &sequences[num_read++];
+      s->seq = NULL;
+      s->length = 0;
+      seq_capacity = 0;
+      if (is_header) {
+        s->name = strdup(line + 1);
+        append(s, &seq_capacity, "", 0);
+        continue;
+      }
+      // Raw sequence: named after its line number.
+      s->name = malloc(16);
+      snprintf(s->name, 16, "#%d", line_num);
+    }
+    append(&sequences[num_read-1], &seq_capacity, line, len);
+  }
+  free(line);
+  fclose(stream);
+  *num_sequences = num_read;
+  return sequences;
+}
+
+void free_sequences(sequence_t* sequences, const int num_sequences) {
+  for (int i = 0; i < num_sequences; ++i) {
+    free(sequences[i].name);
+    free(sequences[i].seq);
+  }
+  free(sequences);
+}
+
+char* reverse_complement(const char* seq, const int length) {
+  static const char kFrom[] = "ACGTURYKMBVDHSWNacgturykmbvdhswn";
+  static const char kTo[] = "TGCAAYRMKVBHDSWNtgcaayrmkvbhdswn";
+  char complement[256];
+  for (int c = 0; c < 256; ++c) {
+    complement[c] = (char)c;
+  }
+  for (int k = 0; kFrom[k]; ++k) {
+    complement[(unsigned char)kFrom[k]] = kTo[k];
+  }
+  char* rc = malloc(sizeof(char) * (length + 1));
+  if (rc == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate a sequence\n");
+    exit(1);
+  }
+  for (int i = 0; i < length; ++i) {
+    rc[i] = complement[(unsigned char)seq[length - 1 - i]];
+  }
+  rc[length] = 0;
+  return rc;
+}
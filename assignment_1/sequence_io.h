@@ -0,0 +1,50 @@
+/*
+ * File:  sequence_io.h
+ * Author: Stefano Ribes
+ */
+#ifndef SEQUENCE_IO_H_
+#define SEQUENCE_IO_H_
+
+/*
+ * @brief      A named sequence read from file.
+ */
+typedef struct {
+  char* name;
+  char* seq;
+  int length;
+} sequence_t;
+
+/**
+ * @brief      Reads all the sequences of a file. The file is either in FASTA
+ *             format or it holds one raw sequence per line (empty lines are
+ *             skipped). Raw sequences are named after their line number.
+ *
+ * @param[in]  filename       The filename
+ * @param      num_sequences  The number of sequences read
+ *
+ * @return     The sequences, to be released with free_sequences().
+ */
+sequence_t* read_sequences(const char* filename, int* num_sequences);
+
+/**
+ * @brief      Releases the sequences returned by read_sequences().
+ *
+ * @param      sequences      The sequences
+ * @param[in]  num_sequences  The number of sequences
+ */
+void free_sequences(sequence_t* sequences, const int num_sequences);
+
+/**
+ * @brief      Gets the reverse complement of a nucleotide sequence. The IUPAC
+ *             codes are complemented and their case kept, U is complemented to
+ *             A and the other characters are copied as they are.
+ *
+ * @param[in]  seq     The sequence
+ * @param[in]  length  The length of the sequence
+ *
+ * @return     The reverse complement, NUL-terminated, to be released with
+ *             free().
+ */
+char* reverse_complement(const char* seq, const int length);
+
+#endif // end SEQUENCE_IO_H_
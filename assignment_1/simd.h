@@ -0,0 +1,336 @@
+/*
+ * File:  simd.h
+ * Author: Stefano Ribes
+ *
+ * Thin wrappers around the SSE4.1, AVX2 and AVX-512BW integer intrinsics used
+ * by the vectorised DP kernels, so that the kernels are written once. The
+ * instruction set is picked at compile time (-msse4.1, -mavx2 or -mavx512bw).
+ * A kernel compiled with -DSIMD_SUFFIX=isa names its exported functions with
+ * SIMD_NAME(), so that one binary can link a variant per instruction set and
+ * pick one at run time (see cpu_dispatch.h).
+ *
+ * The 8-bit operations work on unsigned saturated lanes, the 16-bit operations
+ * on signed saturated lanes and the 32-bit operations on signed wrapping lanes,
+ * as wide as the scalar scores.
+ */
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(SIMD_SUFFIX)
+#define SIMD_CONCAT_(name, suffix) name##_##suffix
+#define SIMD_CONCAT(name, suffix) SIMD_CONCAT_(name, suffix)
+#define SIMD_NAME(name) SIMD_CONCAT(name, SIMD_SUFFIX)
+#else
+#define SIMD_NAME(name) name
+#endif
+
+#if defined(__AVX512BW__)
+#include <immintrin.h>
+
+#define SIMD_ISA "avx512bw"
+#define VEC_BYTES 64
+
+typedef __m512i vec_t;
+typedef uint64_t vec_mask_t; // One bit per byte
+
+static inline vec_t vec_zero(void) { return _mm512_setzero_si512(); }
+static inline vec_t vec_load(const vec_t* p) { return _mm512_load_si512(p); }
+static inline void vec_store(vec_t* p, const vec_t a) { _mm512_store_si512(p, a); }
+static inline vec_t vec_loadu(const void* p) { return _mm512_loadu_si512(p); }
+static inline vec_t vec_set1_u8(const uint8_t a) { return _mm512_set1_epi8((char)a); }
+static inline vec_t vec_set1_i16(const int16_t a) { return _mm512_set1_epi16(a); }
+static inline vec_t vec_set1_i32(const int32_t a) { return _mm512_set1_epi32(a); }
+
+/*
+ * The comparisons return mask registers: they are expanded back to byte (or
+ * word) lanes, as with SSE and AVX2.
+ */
+static inline vec_t v8_adds(const vec_t a, const vec_t b) { return _mm512_adds_epu8(a, b); }
+static inline vec_t v8_subs(const vec_t a, const vec_t b) { return _mm512_subs_epu8(a, b); }
+static inline vec_t v8_max(const vec_t a, const vec_t b) { return _mm512_max_epu8(a, b); }
+static inline vec_t v8_eq(const vec_t a, const vec_t b) {
+  return _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a, b));
+}
+static inline vec_t v8_blend(const vec_t a, const vec_t b, const vec_t mask) {
+  return _mm512_mask_blend_epi8(_mm512_movepi8_mask(mask), a, b);
+}
+static inline vec_t v16_adds(const vec_t a, const vec_t b) { return _mm512_adds_epi16(a, b); }
+static inline vec_t v16_subs(const vec_t a, const vec_t b) { return _mm512_subs_epi16(a, b); }
+static inline vec_t v16_max(const vec_t a, const vec_t b) { return _mm512_max_epi16(a, b); }
+static inline vec_t v16_gt(const vec_t a, const vec_t b) {
+  return _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(a, b));
+}
+static inline vec_t v16_eq(const vec_t a, const vec_t b) {
+  return _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a, b));
+}
+static inline vec_t v32_add(const vec_t a, const vec_t b) { return _mm512_add_epi32(a, b); }
+static inline vec_t v32_sub(const vec_t a, const vec_t b) { return _mm512_sub_epi32(a, b); }
+static inline vec_t v32_max(const vec_t a, const vec_t b) { return _mm512_max_epi32(a, b); }
+// _mm512_movm_epi32 needs AVX512DQ, a masked move only AVX512F.
+static inline vec_t v32_gt(const vec_t a, const vec_t b) {
+  return _mm512_maskz_mov_epi32(_mm512_cmpgt_epi32_mask(a, b),
+    _mm512_set1_epi32(-1));
+}
+static inline vec_t v32_eq(const vec_t a, const vec_t b) {
+  return _mm512_maskz_mov_epi32(_mm512_cmpeq_epi32_mask(a, b),
+    _mm512_set1_epi32(-1));
+}
+
+static inline vec_mask_t vec_movemask(const vec_t a) {
+  return _mm512_movepi8_mask(a);
+}
+
+/*
+ * Lanes of b where x equals y, lanes of a elsewhere.
+ */
+static inline vec_t v8_select_eq(const vec_t a, const vec_t b, const vec_t x,
+    const vec_t y) {
+  return _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(x, y), a, b);
+}
+static inline vec_t v16_select_eq(const vec_t a, const vec_t b,
+    const vec_t x, const vec_t y) {
+  return _mm512_mask_blend_epi16(_mm512_cmpeq_epi16_mask(x, y), a, b);
+}
+static inline vec_t v32_select_eq(const vec_t a, const vec_t b,
+    const vec_t x, const vec_t y) {
+  return _mm512_mask_blend_epi32(_mm512_cmpeq_epi32_mask(x, y), a, b);
+}
+
+/*
+ * The previous 128-bit lane of each lane (zero for the first one) supplies
+ * the byte shifted into it.
+ */
+static inline vec_t vec_prev_lanes(const vec_t a) {
+  return _mm512_maskz_permutexvar_epi64(0xFC, _mm512_set_epi64(5, 4, 3, 2, 1,
+    0, 0, 0), a);
+}
+static inline vec_t v8_shift_lane(const vec_t a) {
+  return _mm512_alignr_epi8(a, vec_prev_lanes(a), 15);
+}
+static inline vec_t v16_shift_lane(const vec_t a) {
+  return _mm512_alignr_epi8(a, vec_prev_lanes(a), 14);
+}
+static inline vec_t v32_shift_lane(const vec_t a) {
+  return _mm512_alignr_epi8(a, vec_prev_lanes(a), 12);
+}
+
+#define VEC_ALL_ONES (~(vec_mask_t)0)
+
+#elif defined(__AVX2__)
+#include <immintrin.h>
+
+#define SIMD_ISA "avx2"
+#define VEC_BYTES 32
+
+typedef __m256i vec_t;
+typedef uint32_t vec_mask_t; // One bit per byte
+
+static inline vec_t vec_zero(void) { return _mm256_setzero_si256(); }
+static inline vec_t vec_load(const vec_t* p) { return _mm256_load_si256(p); }
+static inline void vec_store(vec_t* p, const vec_t a) { _mm256_store_si256(p, a); }
+static inline vec_t vec_loadu(const void* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline vec_t vec_set1_u8(const uint8_t a) { return _mm256_set1_epi8((char)a); }
+static inline vec_t vec_set1_i16(const int16_t a) { return _mm256_set1_epi16(a); }
+static inline vec_t vec_set1_i32(const int32_t a) { return _mm256_set1_epi32(a); }
+
+static inline vec_t v8_adds(const vec_t a, const vec_t b) { return _mm256_adds_epu8(a, b); }
+static inline vec_t v8_subs(const vec_t a, const vec_t b) { return _mm256_subs_epu8(a, b); }
+static inline vec_t v8_max(const vec_t a, const vec_t b) { return _mm256_max_epu8(a, b); }
+static inline vec_t v8_eq(const vec_t a, const vec_t b) { return _mm256_cmpeq_epi8(a, b); }
+static inline vec_t v8_blend(const vec_t a, const vec_t b, const vec_t mask) {
+  return _mm256_blendv_epi8(a, b, mask);
+}
+static inline vec_t v16_adds(const vec_t a, const vec_t b) { return _mm256_adds_epi16(a, b); }
+static inline vec_t v16_subs(const vec_t a, const vec_t b) { return _mm256_subs_epi16(a, b); }
+static inline vec_t v16_max(const vec_t a, const vec_t b) { return _mm256_max_epi16(a, b); }
+static inline vec_t v16_gt(const vec_t a, const vec_t b) { return _mm256_cmpgt_epi16(a, b); }
+static inline vec_t v16_eq(const vec_t a, const vec_t b) { return _mm256_cmpeq_epi16(a, b); }
+static inline vec_t v32_add(const vec_t a, const vec_t b) { return _mm256_add_epi32(a, b); }
+static inline vec_t v32_sub(const vec_t a, const vec_t b) { return _mm256_sub_epi32(a, b); }
+static inline vec_t v32_max(const vec_t a, const vec_t b) { return _mm256_max_epi32(a, b); }
+static inline vec_t v32_gt(const vec_t a, const vec_t b) { return _mm256_cmpgt_epi32(a, b); }
+static inline vec_t v32_eq(const vec_t a, const vec_t b) { return _mm256_cmpeq_epi32(a, b); }
+
+/*
+ * Byte mask of a comparison result: one bit per byte.
+ */
+static inline vec_mask_t vec_movemask(const vec_t a) {
+  return (vec_mask_t)_mm256_movemask_epi8(a);
+}
+
+/*
+ * Shifts the whole register left by one lane (towards higher lanes), shifting
+ * in zeros. Unlike _mm256_slli_si256, it crosses the two 128-bit halves.
+ */
+static inline vec_t v8_shift_lane(const vec_t a) {
+  return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 15);
+}
+static inline vec_t v16_shift_lane(const vec_t a) {
+  return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 14);
+}
+static inline vec_t v32_shift_lane(const vec_t a) {
+  return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 12);
+}
+
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+
+#define SIMD_ISA "sse4.1"
+#define VEC_BYTES 16
+
+typedef __m128i vec_t;
+typedef uint32_t vec_mask_t; // One bit per byte
+
+static inline vec_t vec_zero(void) { return _mm_setzero_si128(); }
+static inline vec_t vec_load(const vec_t* p) { return _mm_load_si128(p); }
+static inline void vec_store(vec_t* p, const vec_t a) { _mm_store_si128(p, a); }
+static inline vec_t vec_loadu(const void* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline vec_t vec_set1_u8(const uint8_t a) { return _mm_set1_epi8((char)a); }
+static inline vec_t vec_set1_i16(const int16_t a) { return _mm_set1_epi16(a); }
+static inline vec_t vec_set1_i32(const int32_t a) { return _mm_set1_epi32(a); }
+
+static inline vec_t v8_adds(const vec_t a, const vec_t b) { return _mm_adds_epu8(a, b); }
+static inline vec_t v8_subs(const vec_t a, const vec_t b) { return _mm_subs_epu8(a, b); }
+static inline vec_t v8_max(const vec_t a, const vec_t b) { return _mm_max_epu8(a, b); }
+static inline vec_t v8_eq(const vec_t a, const vec_t b) { return _mm_cmpeq_epi8(a, b); }
+static inline vec_t v8_blend(const vec_t a, const vec_t b, const vec_t mask) {
+  return _mm_blendv_epi8(a, b, mask);
+}
+static inline vec_t v16_adds(const vec_t a, const vec_t b) { return _mm_adds_epi16(a, b); }
+static inline vec_t v16_subs(const vec_t a, const vec_t b) { return _mm_subs_epi16(a, b); }
+static inline vec_t v16_max(const vec_t a, const vec_t b) { return _mm_max_epi16(a, b); }
+static inline vec_t v16_gt(const vec_t a, const vec_t b) { return _mm_cmpgt_epi16(a, b); }
+static inline vec_t v16_eq(const vec_t a, const vec_t b) { return _mm_cmpeq_epi16(a, b); }
+static inline vec_t v32_add(const vec_t a, const vec_t b) { return _mm_add_epi32(a, b); }
+static inline vec_t v32_sub(const vec_t a, const vec_t b) { return _mm_sub_epi32(a, b); }
+static inline vec_t v32_max(const vec_t a, const vec_t b) { return _mm_max_epi32(a, b); }
+static inline vec_t v32_gt(const vec_t a, const vec_t b) { return _mm_cmpgt_epi32(a, b); }
+static inline vec_t v32_eq(const vec_t a, const vec_t b) { return _mm_cmpeq_epi32(a, b); }
+
+static inline vec_mask_t vec_movemask(const vec_t a) {
+  return (vec_mask_t)_mm_movemask_epi8(a);
+}
+
+static inline vec_t v8_shift_lane(const vec_t a) { return _mm_slli_si128(a, 1); }
+static inline vec_t v16_shift_lane(const vec_t a) { return _mm_slli_si128(a, 2); }
+static inline vec_t v32_shift_lane(const vec_t a) { return _mm_slli_si128(a, 4); }
+
+#else
+#error "simd.h requires SSE4.1, AVX2 or AVX-512BW (e.g. -mavx2)"
+#endif
+
+#if !defined(__AVX512BW__)
+/*
+ * Lanes of b where x equals y, lanes of a elsewhere.
+ */
+static inline vec_t v8_select_eq(const vec_t a, const vec_t b, const vec_t x,
+    const vec_t y) {
+  return v8_blend(a, b, v8_eq(x, y));
+}
+static inline vec_t v16_select_eq(const vec_t a, const vec_t b,
+    const vec_t x, const vec_t y) {
+  return v8_blend(a, b, v16_eq(x, y));
+}
+static inline vec_t v32_select_eq(const vec_t a, const vec_t b,
+    const vec_t x, const vec_t y) {
+  return v8_blend(a, b, v32_eq(x, y));
+}
+#endif
+
+#define V8_LANES VEC_BYTES
+#define V16_LANES (VEC_BYTES / 2)
+#define V32_LANES (VEC_BYTES / 4)
+#ifndef VEC_ALL_ONES
+#define VEC_ALL_ONES ((vec_mask_t)(((uint64_t)1 << VEC_BYTES) - 1))
+#endif
+
+/*
+ * Index of the lowest set bit of a non-zero mask.
+ */
+static inline int vec_ctz(const vec_mask_t mask) {
+  return __builtin_ctzll(mask);
+}
+
+/*
+ * Returns true if any unsigned 8-bit lane of a is greater than the one of b.
+ */
+static inline int v8_any_gt(const vec_t a, const vec_t b) {
+  return vec_movemask(v8_eq(v8_subs(a, b), vec_zero())) != VEC_ALL_ONES;
+}
+
+/*
+ * Returns true if any unsigned 8-bit lane of a is greater or equal than the
+ * one of b.
+ */
+static inline int v8_any_ge(const vec_t a, const vec_t b) {
+  return vec_movemask(v8_eq(v8_max(a, b), a)) != 0;
+}
+
+static inline int v16_any_gt(const vec_t a, const vec_t b) {
+  return vec_movemask(v16_gt(a, b)) != 0;
+}
+
+static inline int v16_any_ge(const vec_t a, const vec_t b) {
+  return vec_movemask(v16_gt(b, a)) != VEC_ALL_ONES;
+}
+
+static inline int v32_any_gt(const vec_t a, const vec_t b) {
+  return vec_movemask(v32_gt(a, b)) != 0;
+}
+
+static inline int v32_any_ge(const vec_t a, const vec_t b) {
+  return vec_movemask(v32_gt(b, a)) != VEC_ALL_ONES;
+}
+
+/*
+ * Horizontal maxima.
+ */
+static inline uint8_t v8_hmax(const vec_t a) {
+  uint8_t lanes[VEC_BYTES] __attribute__((aligned(VEC_BYTES)));
+  vec_store((vec_t*)lanes, a);
+  uint8_t max = 0;
+  for (int i = 0; i < V8_LANES; ++i) {
+    max = lanes[i] > max ? lanes[i] : max;
+  }
+  return max;
+}
+
+static inline int16_t v16_hmax(const vec_t a) {
+  int16_t lanes[V16_LANES] __attribute__((aligned(VEC_BYTES)));
+  vec_store((vec_t*)lanes, a);
+  int16_t max = INT16_MIN;
+  for (int i = 0; i < V16_LANES; ++i) {
+    max = lanes[i] > max ? lanes[i] : max;
+  }
+  return max;
+}
+
+static inline int32_t v32_hmax(const vec_t a) {
+  int32_t lanes[V32_LANES] __attribute__((aligned(VEC_BYTES)));
+  vec_store((vec_t*)lanes, a);
+  int32_t max = INT32_MIN;
+  for (int i = 0; i < V32_LANES; ++i) {
+    max = lanes[i] > max ? lanes[i] : max;
+  }
+  return max;
+}
+
+/**
+ * @brief      Allocates an array of vectors, aligned to the vector size.
+ *
+ * @param[in]  num_vecs  The number of vectors
+ *
+ * @return     The allocated array, to be released with free().
+ */
+static inline vec_t* vec_alloc(const size_t num_vecs) {
+  void* p = NULL;
+  if (posix_memalign(&p, VEC_BYTES, sizeof(vec_t) * (num_vecs ? num_vecs : 1))) {
+    return NULL;
+  }
+  return (vec_t*)p;
+}
+
+#endif // end SIMD_H_
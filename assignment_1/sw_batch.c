@@ -0,0 +1,441 @@
+/*
+ * File:  sw_batch.c
+ * Author: Stefano Ribes
+ *
+ * Inter-sequence SIMD Smith-Waterman: lane k of every vector holds a cell of
+ * the matrix of the k-th target of a group, so the recurrence is exactly the
+ * scalar one of local_alignment.c, run on V8_LANES (or V16_LANES, V32_LANES)
+ * targets at once. The matrix is filled row by row (one row per query
+ * character), which keeps the row-major tie breaking of the scalar fill for
+ * the end cell.
+ *
+ * With both strands, the rows of the query and of its reverse complement are
+ * filled side by side, so each vector of the target profile is loaded once
+ * for the two matrices.
+ *
+ * The file is compiled once per instruction set, see simd.h.
+ */
+#include "sw_batch.h"
+#include "simd.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SW_BIAS (MISMATCH_SCORE < 0 ? -MISMATCH_SCORE : 0)
+#define MAX_STRANDS 2
+
+typedef struct {
+  int length;
+  int index;
+} target_ref_t;
+
+/*
+ * @brief      Queries scored against each target, the query and possibly its
+ *             reverse complement, and their results.
+ */
+typedef struct {
+  const char* seq[MAX_STRANDS];
+  sw_result_t* results[MAX_STRANDS];
+  int m;
+} batch_query_t;
+
+static int compare_length_desc(const void* a, const void* b) {
+  const target_ref_t* ta = (const target_ref_t*)a;
+  const target_ref_t* tb = (const target_ref_t*)b;
+  if (ta->length != tb->length) {
+    return tb->length - ta->length;
+  }
+  return ta->index - tb->index;
+}
+
+/**
+ * @brief      Records the cells improving the best score of their lane in the
+ *             current row. Only called when at least one lane improved.
+ *
+ * @param[in]  H           The current row
+ * @param[in]  L           The number of columns of the row
+ * @param[in]  row_max     The row maxima
+ * @param[in]  improved    The byte mask of the improved lanes
+ * @param[in]  lane_bytes  The lane width in bytes
+ * @param[in]  i           The row index
+ * @param[in]  group       The target indices of the lanes
+ * @param      results     The results
+ */
+static void record_row_best(const vec_t* H, const int L, const vec_t row_max,
+    const vec_mask_t improved, const int lane_bytes, const int i,
+    const int* group, sw_result_t* results) {
+  vec_mask_t found = 0;
+  for (int j = 1; j <= L && found != improved; ++j) {
+    const vec_t eq = lane_bytes == 1 ? v8_eq(vec_load(H + j), row_max) :
+      lane_bytes == 2 ? v16_eq(vec_load(H + j), row_max) :
+      v32_eq(vec_load(H + j), row_max);
+    vec_mask_t mask = vec_movemask(eq) & improved & ~found;
+    while (mask) {
+      const int bit = vec_ctz(mask);
+      const int lane = bit / lane_bytes;
+      const vec_mask_t lane_mask = (((vec_mask_t)1 << lane_bytes) - 1) << bit;
+      found |= lane_mask;
+      mask &= ~lane_mask;
+      sw_result_t* res = &results[group[lane]];
+      const uint8_t* lanes = (const uint8_t*)(H + j);
+      res->score = lane_bytes == 1 ? lanes[lane] : lane_bytes == 2 ?
+        ((const int16_t*)lanes)[lane] : ((const int32_t*)lanes)[lane];
+      res->max_i = i;
+      res->max_j = j;
+    }
+  }
+}
+
+/**
+ * @brief      Allocates the zeroed row of each strand. A row is updated in
+ *             place: the cell above is read before being overwritten and kept
+ *             as the diagonal of the next column, so that the rows of both
+ *             strands take no more cache than two rows of one strand.
+ */
+static void alloc_rows(const int L, const int num_strands, vec_t** H) {
+  for (int s = 0; s < num_strands; ++s) {
+    H[s] = vec_alloc(L + 1);
+    for (int j = 0; j <= L; ++j) {
+      vec_store(H[s] + j, vec_zero());
+    }
+  }
+}
+
+static void free_rows(const int num_strands, vec_t** H) {
+  for (int s = 0; s < num_strands; ++s) {
+    free(H[s]);
+  }
+}
+
+/**
+ * @brief      Scores a group of up to V8_LANES targets on unsigned 8-bit lanes.
+ *             The number of strands is a compile-time constant at the call
+ *             sites.
+ *
+ * @return     The byte mask of the lanes which saturated on either strand.
+ */
+static ALWAYS_INLINE vec_mask_t sw_batch_u8(const batch_query_t* query,
+    const int num_strands, const char* const* targets, const int* lengths,
+    const int* group, const int group_size) {
+  const int L = lengths[group[0]];
+  vec_t* T = vec_alloc(L);
+  vec_t* H[MAX_STRANDS];
+  /*
+   * Target profile: column j holds the j-th character of each target, zero
+   * past its end (zero never matches a query character).
+   */
+  for (int j = 0; j < L; ++j) {
+    uint8_t* t = (uint8_t*)(T + j);
+    for (int lane = 0; lane < V8_LANES; ++lane) {
+      t[lane] = (lane < group_size && j < lengths[group[lane]]) ?
+        (uint8_t)targets[group[lane]][j] : 0;
+    }
+  }
+  alloc_rows(L, num_strands, H);
+  const vec_t v_gap = vec_set1_u8(GAP_PENALTY);
+  const vec_t v_bias = vec_set1_u8(SW_BIAS);
+  const vec_t v_match = vec_set1_u8(MATCH_SCORE + SW_BIAS);
+  const vec_t v_mismatch = vec_set1_u8(MISMATCH_SCORE + SW_BIAS);
+  const vec_t v_saturation = vec_set1_u8(UINT8_MAX - MATCH_SCORE - SW_BIAS);
+  vec_t v_best[MAX_STRANDS];
+  for (int s = 0; s < num_strands; ++s) {
+    v_best[s] = vec_zero();
+  }
+  vec_mask_t saturated = 0;
+  for (int i = 1; i <= query->m; ++i) {
+    vec_t v_x[MAX_STRANDS];
+    vec_t v_left[MAX_STRANDS];
+    vec_t v_row_max[MAX_STRANDS];
+    vec_t v_diag[MAX_STRANDS];
+    for (int s = 0; s < num_strands; ++s) {
+      v_x[s] = vec_set1_u8((uint8_t)query->seq[s][i-1]);
+      v_left[s] = vec_zero();
+      v_row_max[s] = vec_zero();
+      v_diag[s] = vec_zero();
+    }
+    for (int j = 1; j <= L; ++j) {
+      const vec_t v_t = vec_load(T + j - 1);
+      for (int s = 0; s < num_strands; ++s) {
+        const vec_t v_score = v8_select_eq(v_mismatch, v_match, v_t, v_x[s]);
+        const vec_t v_up = vec_load(H[s] + j);
+        vec_t v_h = v8_subs(v8_adds(v_diag[s], v_score), v_bias);
+        v_h = v8_max(v_h, v8_subs(v_up, v_gap));
+        v_h = v8_max(v_h, v8_subs(v_left[s], v_gap));
+        vec_store(H[s] + j, v_h);
+        v_diag[s] = v_up;
+        v_row_max[s] = v8_max(v_row_max[s], v_h);
+        v_left[s] = v_h;
+      }
+    }
+    for (int s = 0; s < num_strands; ++s) {
+      const vec_mask_t improved = ~vec_movemask(v8_eq(v8_subs(v_row_max[s],
+        v_best[s]), vec_zero())) & VEC_ALL_ONES & ~saturated;
+      if (improved) {
+        saturated |= ~vec_movemask(v8_eq(v8_subs(v_row_max[s],
+          v_saturation), vec_zero())) & VEC_ALL_ONES;
+        record_row_best(H[s], L, v_row_max[s], improved & ~saturated, 1,
+          i, group, query->results[s]);
+        v_best[s] = v8_max(v_best[s], v_row_max[s]);
+      }
+    }
+  }
+  free(T);
+  free_rows(num_strands, H);
+  return group_size < V8_LANES ?
+    saturated & (vec_mask_t)(((uint64_t)1 << group_size) - 1) : saturated;
+}
+
+/**
+ * @brief      Scores a group of up to V16_LANES targets on signed 16-bit lanes.
+ *
+ * @return     The byte mask of the lanes which saturated on either strand.
+ */
+static ALWAYS_INLINE vec_mask_t sw_batch_i16(const batch_query_t* query,
+    const int num_strands, const char* const* targets, const int* lengths,
+    const int* group, const int group_size) {
+  int L = 0;
+  for (int lane = 0; lane < group_size; ++lane) {
+    L = lengths[group[lane]] > L ? lengths[group[lane]] : L;
+  }
+  vec_t* T = vec_alloc(L);
+  vec_t* H[MAX_STRANDS];
+  for (int j = 0; j < L; ++j) {
+    int16_t* t = (int16_t*)(T + j);
+    for (int lane = 0; lane < V16_LANES; ++lane) {
+      t[lane] = (lane < group_size && j < lengths[group[lane]]) ?
+        (uint8_t)targets[group[lane]][j] : 0;
+    }
+  }
+  alloc_rows(L, num_strands, H);
+  const vec_t v_zero = vec_zero();
+  const vec_t v_gap = vec_set1_i16(GAP_PENALTY);
+  const vec_t v_match = vec_set1_i16(MATCH_SCORE);
+  const vec_t v_mismatch = vec_set1_i16(MISMATCH_SCORE);
+  const vec_t v_saturation = vec_set1_i16(INT16_MAX - MATCH_SCORE - 1);
+  vec_t v_best[MAX_STRANDS];
+  for (int s = 0; s < num_strands; ++s) {
+    v_best[s] = vec_zero();
+  }
+  vec_mask_t saturated = 0;
+  for (int i = 1; i <= query->m; ++i) {
+    vec_t v_x[MAX_STRANDS];
+    vec_t v_left[MAX_STRANDS];
+    vec_t v_row_max[MAX_STRANDS];
+    vec_t v_diag[MAX_STRANDS];
+    for (int s = 0; s < num_strands; ++s) {
+      v_x[s] = vec_set1_i16((uint8_t)query->seq[s][i-1]);
+      v_left[s] = vec_zero();
+      v_row_max[s] = vec_zero();
+      v_diag[s] = vec_zero();
+    }
+    for (int j = 1; j <= L; ++j) {
+      const vec_t v_t = vec_load(T + j - 1);
+      for (int s = 0; s < num_strands; ++s) {
+        const vec_t v_score = v16_select_eq(v_mismatch, v_match, v_t,
+          v_x[s]);
+        const vec_t v_up = vec_load(H[s] + j);
+        vec_t v_h = v16_max(v16_adds(v_diag[s], v_score), v_zero);
+        v_h = v16_max(v_h, v16_subs(v_up, v_gap));
+        v_h = v16_max(v_h, v16_subs(v_left[s], v_gap));
+        vec_store(H[s] + j, v_h);
+        v_diag[s] = v_up;
+        v_row_max[s] = v16_max(v_row_max[s], v_h);
+        v_left[s] = v_h;
+      }
+    }
+    for (int s = 0; s < num_strands; ++s) {
+      const vec_mask_t improved = vec_movemask(v16_gt(v_row_max[s],
+        v_best[s])) & ~saturated;
+      if (improved) {
+        saturated |= vec_movemask(v16_gt(v_row_max[s], v_saturation));
+        record_row_best(H[s], L, v_row_max[s], improved & ~saturated, 2,
+          i, group, query->results[s]);
+        v_best[s] = v16_max(v_best[s], v_row_max[s]);
+      }
+    }
+  }
+  free(T);
+  free_rows(num_strands, H);
+  return group_size < V16_LANES ?
+    saturated & (vec_mask_t)(((uint64_t)1 << (2 * group_size)) - 1) :
+    saturated;
+}
+
+/**
+ * @brief      Scores a group of up to V32_LANES targets on signed 32-bit lanes,
+ *             as wide as the scalar scores, so no lane can saturate.
+ */
+static ALWAYS_INLINE void sw_batch_i32(const batch_query_t* query,
+    const int num_strands, const char* const* targets, const int* lengths,
+    const int* group, const int group_size) {
+  int L = 0;
+  for (int lane = 0; lane < group_size; ++lane) {
+    L = lengths[group[lane]] > L ? lengths[group[lane]] : L;
+  }
+  vec_t* T = vec_alloc(L);
+  vec_t* H[MAX_STRANDS];
+  for (int j = 0; j < L; ++j) {
+    int32_t* t = (int32_t*)(T + j);
+    for (int lane = 0; lane < V32_LANES; ++lane) {
+      t[lane] = (lane < group_size && j < lengths[group[lane]]) ?
+        (uint8_t)targets[group[lane]][j] : 0;
+    }
+  }
+  alloc_rows(L, num_strands, H);
+  const vec_t v_zero = vec_zero();
+  const vec_t v_gap = vec_set1_i32(GAP_PENALTY);
+  const vec_t v_match = vec_set1_i32(MATCH_SCORE);
+  const vec_t v_mismatch = vec_set1_i32(MISMATCH_SCORE);
+  vec_t v_best[MAX_STRANDS];
+  for (int s = 0; s < num_strands; ++s) {
+    v_best[s] = vec_zero();
+  }
+  for (int i = 1; i <= query->m; ++i) {
+    vec_t v_x[MAX_STRANDS];
+    vec_t v_left[MAX_STRANDS];
+    vec_t v_row_max[MAX_STRANDS];
+    vec_t v_diag[MAX_STRANDS];
+    for (int s = 0; s < num_strands; ++s) {
+      v_x[s] = vec_set1_i32((uint8_t)query->seq[s][i-1]);
+      v_left[s] = vec_zero();
+      v_row_max[s] = vec_zero();
+      v_diag[s] = vec_zero();
+    }
+    for (int j = 1; j <= L; ++j) {
+      const vec_t v_t = vec_load(T + j - 1);
+      for (int s = 0; s < num_strands; ++s) {
+        const vec_t v_score = v32_select_eq(v_mismatch, v_match, v_t,
+          v_x[s]);
+        const vec_t v_up = vec_load(H[s] + j);
+        vec_t v_h = v32_max(v32_add(v_diag[s], v_score), v_zero);
+        v_h = v32_max(v_h, v32_sub(v_up, v_gap));
+        v_h = v32_max(v_h, v32_sub(v_left[s], v_gap));
+        vec_store(H[s] + j, v_h);
+        v_diag[s] = v_up;
+        v_row_max[s] = v32_max(v_row_max[s], v_h);
+        v_left[s] = v_h;
+      }
+    }
+    for (int s = 0; s < num_strands; ++s) {
+      const vec_mask_t improved = vec_movemask(v32_gt(v_row_max[s],
+        v_best[s]));
+      if (improved) {
+        record_row_best(H[s], L, v_row_max[s], improved, 4, i, group,
+          query->results[s]);
+        v_best[s] = v32_max(v_best[s], v_row_max[s]);
+      }
+    }
+  }
+  free(T);
+  free_rows(num_strands, H);
+}
+
+/**
+ * @brief      Resets the result of a target before scoring it on wider lanes.
+ */
+static void reset_result(sw_result_t* res, const int score_bits) {
+  // Cells with score zero only: the first cell is the end cell.
+  res->score = 0;
+  res->max_i = 1;
+  res->max_j = 1;
+  res->score_bits = score_bits;
+}
+
+/**
+ * @brief      Scores all the targets against the strands of the query, first
+ *             on 8-bit lanes, then re-scores the saturated targets on 16-bit
+ *             and 32-bit lanes. A target is re-scored on both strands when
+ *             either of them saturated.
+ */
+static ALWAYS_INLINE void run_batch(const batch_query_t* query,
+    const int num_strands, const char* const* targets, const int* lengths,
+    const int num_targets) {
+  target_ref_t* refs = malloc(sizeof(target_ref_t) * (num_targets + 1));
+  int* overflow = malloc(sizeof(int) * (num_targets + 1));
+  int num_overflow = 0;
+  int num_scored = 0;
+  /*
+   * Empty sequences are scored right away, the others sorted by length.
+   */
+  for (int k = 0; k < num_targets; ++k) {
+    for (int s = 0; s < num_strands; ++s) {
+      if (query->m == 0 || lengths[k] == 0) {
+        query->results[s][k] = sw_scalar(query->seq[s], query->m, targets[k],
+          lengths[k], MATRIX_IDENTITY);
+      } else {
+        reset_result(&query->results[s][k], 8);
+      }
+    }
+    if (query->m == 0 || lengths[k] == 0) {
+      continue;
+    }
+    refs[num_scored].length = lengths[k];
+    refs[num_scored].index = k;
+    ++num_scored;
+  }
+  qsort(refs, num_scored, sizeof(target_ref_t), compare_length_desc);
+  int group[V8_LANES];
+  for (int k = 0; k < num_scored; k += V8_LANES) {
+    const int group_size = num_scored - k < V8_LANES ? num_scored - k :
+      V8_LANES;
+    for (int lane = 0; lane < group_size; ++lane) {
+      group[lane] = refs[k + lane].index;
+    }
+    vec_mask_t saturated = sw_batch_u8(query, num_strands, targets, lengths,
+      group, group_size);
+    while (saturated) {
+      const int lane = vec_ctz(saturated);
+      saturated &= saturated - 1;
+      overflow[num_overflow++] = group[lane];
+    }
+  }
+  /*
+   * Re-score only the targets which saturated the 8-bit lanes, then only the
+   * ones which also saturated the 16-bit lanes.
+   */
+  int num_overflow32 = 0;
+  for (int k = 0; k < num_overflow; k += V16_LANES) {
+    const int group_size = num_overflow - k < V16_LANES ? num_overflow - k :
+      V16_LANES;
+    for (int lane = 0; lane < group_size; ++lane) {
+      group[lane] = overflow[k + lane];
+      for (int s = 0; s < num_strands; ++s) {
+        reset_result(&query->results[s][group[lane]], 16);
+      }
+    }
+    vec_mask_t saturated = sw_batch_i16(query, num_strands, targets, lengths,
+      group, group_size);
+    while (saturated) {
+      const int lane = vec_ctz(saturated) / 2;
+      saturated &= ~((vec_mask_t)3 << (2 * lane));
+      overflow[num_overflow32++] = group[lane];
+    }
+  }
+  for (int k = 0; k < num_overflow32; k += V32_LANES) {
+    const int group_size = num_overflow32 - k < V32_LANES ?
+      num_overflow32 - k : V32_LANES;
+    for (int lane = 0; lane < group_size; ++lane) {
+      group[lane] = overflow[k + lane];
+      for (int s = 0; s < num_strands; ++s) {
+        reset_result(&query->results[s][group[lane]], 32);
+      }
+    }
+    sw_batch_i32(query, num_strands, targets, lengths, group, group_size);
+  }
+  free(refs);
+  free(overflow);
+}
+
+void SIMD_NAME(sw_batch)(const char* X, const int m, const char* const* targets,
+    const int* lengths, const int num_targets, sw_result_t* results) {
+  const batch_query_t kQuery = {{X, NULL}, {results, NULL}, m};
+  run_batch(&kQuery, 1, targets, lengths, num_targets);
+}
+
+void SIMD_NAME(sw_batch_two_strands)(const char* X, const char* X_rc, const int m,
+    const char* const* targets, const int* lengths, const int num_targets,
+    sw_result_t* results, sw_result_t* rc_results) {
+  const batch_query_t kQuery = {{X, X_rc}, {results, rc_results}, m};
+  run_batch(&kQuery, 2, targets, lengths, num_targets);
+}
@@ -0,0 +1,50 @@
+/*
+ * File:  sw_batch.h
+ * Author: Stefano Ribes
+ */
+#ifndef SW_BATCH_H_
+#define SW_BATCH_H_
+
+#include "sw_striped.h"
+
+/**
+ * @brief      Scores one query against many targets with the local alignment
+ *             recurrence of local_alignment.c. Each vector lane holds a
+ *             different target (inter-sequence parallelism) and the targets
+ *             are sorted by length, so that the lanes of a vector stay busy.
+ *             Targets saturating the 8-bit lanes are re-scored on 16-bit
+ *             lanes, then on 32-bit lanes. The variant of the instruction set
+ *             of cpu_isa() is called, the scalar kernel if there is none.
+ *
+ * @param[in]  X            The query sequence
+ * @param[in]  m            The length of the query
+ * @param[in]  targets      The target sequences
+ * @param[in]  lengths      The lengths of the targets
+ * @param[in]  num_targets  The number of targets
+ * @param      results      The best score and end cell of each target, in the
+ *                          input order (max_i on the query, max_j on the
+ *                          target)
+ */
+void sw_batch(const char* X, const int m, const char* const* targets,
+    const int* lengths, const int num_targets, sw_result_t* results);
+
+/**
+ * @brief      Scores one query and its reverse complement against many
+ *             targets, as sw_batch() but in a single pass over each group of
+ *             targets: the target profile is built and loaded once for the two
+ *             strands. The result of each target is the best one of the two
+ *             strands, the forward one on ties; on the reverse strand max_i is
+ *             the position on the reverse complement of the query.
+ *
+ * @param[in]  X            The query sequence (nucleotides)
+ * @param[in]  m            The length of the query
+ * @param[in]  targets      The target sequences
+ * @param[in]  lengths      The lengths of the targets
+ * @param[in]  num_targets  The number of targets
+ * @param      results      The best score, end cell and strand ('+' or '-')
+ *                          of each target, in the input order
+ */
+void sw_batch_strands(const char* X, const int m, const char* const* targets,
+    const int* lengths, const int num_targets, sw_result_t* results);
+
+#endif // end SW_BATCH_H_
@@ -0,0 +1,123 @@
+/*
+ * File:  sw_dispatch.c
+ * Author: Stefano Ribes
+ *
+ * Entry points of the SIMD Smith-Waterman kernels: sw_striped.c and sw_batch.c
+ * are linked once per instruction set, and each call goes to the variant of
+ * cpu_isa(). The helpers shared by all the variants live here too.
+ */
+#include "cpu_dispatch.h"
+#include "sequence_io.h"
+#include "sw_batch.h"
+#include "sw_striped.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DECLARE_VARIANTS(isa) \
+  sw_result_t sw_striped_##isa(const char* X, const int m, const char* Y, \
+    const int n, const matrix_t matrix); \
+  void sw_batch_##isa(const char* X, const int m, \
+    const char* const* targets, const int* lengths, const int num_targets, \
+    sw_result_t* results); \
+  void sw_batch_two_strands_##isa(const char* X, const char* X_rc, \
+    const int m, const char* const* targets, const int* lengths, \
+    const int num_targets, sw_result_t* results, sw_result_t* rc_results);
+
+DECLARE_VARIANTS(sse41)
+DECLARE_VARIANTS(avx2)
+DECLARE_VARIANTS(avx512bw)
+
+sw_result_t sw_striped(const char* X, const int m, const char* Y,
+    const int n, const matrix_t matrix) {
+  switch (cpu_isa()) {
+    case ISA_AVX512BW:
+      return sw_striped_avx512bw(X, m, Y, n, matrix);
+    case ISA_AVX2:
+      return sw_striped_avx2(X, m, Y, n, matrix);
+    case ISA_SSE41:
+      return sw_striped_sse41(X, m, Y, n, matrix);
+    default:
+      return sw_scalar(X, m, Y, n, matrix);
+  }
+}
+
+void sw_batch(const char* X, const int m, const char* const* targets,
+    const int* lengths, const int num_targets, sw_result_t* results) {
+  switch (cpu_isa()) {
+    case ISA_AVX512BW:
+      sw_batch_avx512bw(X, m, targets, lengths, num_targets, results);
+      break;
+    case ISA_AVX2:
+      sw_batch_avx2(X, m, targets, lengths, num_targets, results);
+      break;
+    case ISA_SSE41:
+      sw_batch_sse41(X, m, targets, lengths, num_targets, results);
+      break;
+    default:
+      for (int k = 0; k < num_targets; ++k) {
+        results[k] = sw_scalar(X, m, targets[k], lengths[k], MATRIX_IDENTITY);
+      }
+  }
+}
+
+void sw_batch_strands(const char* X, const int m, const char* const* targets,
+    const int* lengths, const int num_targets, sw_result_t* results) {
+  char* X_rc = reverse_complement(X, m);
+  sw_result_t* rc_results = malloc(sizeof(sw_result_t) * (num_targets + 1));
+  if (rc_results == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the results\n");
+    exit(1);
+  }
+  switch (cpu_isa()) {
+    case ISA_AVX512BW:
+      sw_batch_two_strands_avx512bw(X, X_rc, m, targets, lengths, num_targets,
+        results, rc_results);
+      break;
+    case ISA_AVX2:
+      sw_batch_two_strands_avx2(X, X_rc, m, targets, lengths, num_targets,
+        results, rc_results);
+      break;
+    case ISA_SSE41:
+      sw_batch_two_strands_sse41(X, X_rc, m, targets, lengths, num_targets,
+        results, rc_results);
+      break;
+    default:
+      for (int k = 0; k < num_targets; ++k) {
+        results[k] = sw_scalar(X, m, targets[k], lengths[k], MATRIX_IDENTITY);
+        rc_results[k] = sw_scalar(X_rc, m, targets[k], lengths[k],
+          MATRIX_IDENTITY);
+      }
+  }
+  for (int k = 0; k < num_targets; ++k) {
+    if (rc_results[k].score > results[k].score) {
+      results[k] = rc_results[k];
+      results[k].strand = '-';
+    } else {
+      results[k].strand = '+';
+    }
+  }
+  free(X_rc);
+  free(rc_results);
+}
+
+sw_width_stats_t sw_width_stats(const sw_result_t* results,
+    const int num_results) {
+  sw_width_stats_t stats = {0, 0, 0, 0};
+  for (int k = 0; k < num_results; ++k) {
+    switch (results[k].score_bits) {
+      case 8:
+        ++stats.num_8;
+        break;
+      case 16:
+        ++stats.num_16;
+        break;
+      case 32:
+        ++stats.num_32;
+        break;
+      default:
+        ++stats.num_scalar;
+    }
+  }
+  return stats;
+}
@@ -0,0 +1,120 @@
+/*
+ * File:  sw_reverse.c
+ * Author: Stefano Ribes
+ *
+ * Reverse pass of the linear-space local alignment. Cell (r, c) of the pass
+ * holds the best score of an alignment of X[end_i-r .. end_i-1] with
+ * Y[end_j-c .. end_j-1], i.e. of a path from cell (end_i - r, end_j - c) to
+ * the end cell. Only a live range of each row is computed: a cell is dropped
+ * as soon as matching all the remaining symbols could not bring it back to the
+ * best score, and no alignment reaching the best score goes through it.
+ */
+#include "sw_reverse.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MINUS_INF (INT_MIN / 4) // Dropped cells
+
+/*
+ * The matrix parameter is a compile-time constant at every call site, so the
+ * compiler emits a specialised loop for each matrix.
+ */
+static ALWAYS_INLINE idx_t find_start(const uint8_t* X, const uint8_t* Y,
+    const int end_i, const int end_j, const int score, const int max_score,
+    int* prev, int* curr, idx_t* start, const matrix_t matrix) {
+  idx_t corner = {end_i, end_j};
+  start->x = end_i;
+  start->y = end_j;
+  // Row 0: the live cells are a prefix of the row.
+  int prev_lo = 0;
+  int prev_hi = -1;
+  for (int c = 0; c <= end_j; ++c) {
+    const int kRemaining = end_i < end_j - c ? end_i : end_j - c;
+    if (-GAP_PENALTY * c + max_score * kRemaining < score) {
+      break;
+    }
+    prev[c] = -GAP_PENALTY * c;
+    prev_hi = c;
+    if (prev[c] == score) {
+      corner.y = end_j - c < corner.y ? end_j - c : corner.y;
+      start->y = end_j - c;
+    }
+  }
+  for (int r = 1; r <= end_i && prev_hi >= 0; ++r) {
+    const uint8_t x = X[end_i - r];
+    int lo = -1;
+    int hi = -1;
+    int left = MINUS_INF;
+    for (int c = prev_lo; c <= end_j; ++c) {
+      if (c > prev_hi + 1 && left == MINUS_INF) {
+        break; // Only reachable from dropped cells
+      }
+      const int diag = c > prev_lo && c - 1 <= prev_hi ?
+        prev[c-1] + substitution_score(matrix, x, Y[end_j - c]) : MINUS_INF;
+      const int up = c <= prev_hi ? prev[c] - GAP_PENALTY : MINUS_INF;
+      int v = up > diag ? up : diag;
+      v = left - GAP_PENALTY > v ? left - GAP_PENALTY : v;
+      const int kRemaining = end_i - r < end_j - c ? end_i - r : end_j - c;
+      if (v + max_score * kRemaining < score) {
+        v = MINUS_INF;
+      } else {
+        lo = lo < 0 ? c : lo;
+        hi = c;
+        if (v == score) {
+          corner.x = end_i - r < corner.x ? end_i - r : corner.x;
+          corner.y = end_j - c < corner.y ? end_j - c : corner.y;
+          start->x = end_i - r;
+          start->y = end_j - c;
+        }
+      }
+      curr[c] = v;
+      left = v;
+    }
+    int* tmp = prev;
+    prev = curr;
+    curr = tmp;
+    prev_lo = lo;
+    prev_hi = hi;
+  }
+  return corner;
+}
+
+idx_t sw_start_corner(const char* X, const char* Y, const matrix_t matrix,
+    const int end_i, const int end_j, const int score, idx_t* start) {
+  uint8_t* X_codes = encode_sequence(matrix, X, end_i);
+  uint8_t* Y_codes = encode_sequence(matrix, Y, end_j);
+  int* prev = malloc(sizeof(int) * (end_j + 1));
+  int* curr = malloc(sizeof(int) * (end_j + 1));
+  if (prev == NULL || curr == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the reverse pass rows\n");
+    exit(1);
+  }
+  const int kMaxScore = matrix_max_score(matrix);
+  idx_t farthest;
+  start = start != NULL ? start : &farthest;
+  idx_t corner;
+  switch (matrix) {
+    case MATRIX_DNA:
+      corner = find_start(X_codes, Y_codes, end_i, end_j, score, kMaxScore,
+        prev, curr, start, MATRIX_DNA);
+      break;
+    case MATRIX_BLOSUM62:
+      corner = find_start(X_codes, Y_codes, end_i, end_j, score, kMaxScore,
+        prev, curr, start, MATRIX_BLOSUM62);
+      break;
+    case MATRIX_PAM250:
+      corner = find_start(X_codes, Y_codes, end_i, end_j, score, kMaxScore,
+        prev, curr, start, MATRIX_PAM250);
+      break;
+    default:
+      corner = find_start(X_codes, Y_codes, end_i, end_j, score, kMaxScore,
+        prev, curr, start, MATRIX_IDENTITY);
+  }
+  free(prev);
+  free(curr);
+  free(X_codes);
+  free(Y_codes);
+  return corner;
+}
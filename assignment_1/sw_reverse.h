@@ -0,0 +1,41 @@
+/*
+ * File:  sw_reverse.h
+ * Author: Stefano Ribes
+ */
+#ifndef SW_REVERSE_H_
+#define SW_REVERSE_H_
+
+#include "alignment.h"
+#include "scoring.h"
+
+/**
+ * @brief      Finds where the optimal local alignments ending at a given cell
+ *             may start. The prefixes X[0 .. end_i-1] and Y[0 .. end_j-1] are
+ *             aligned backwards from the end cell, keeping two rows: a start
+ *             cell is one whose anchored score equals the best score. Cells
+ *             that cannot reach the best score anymore, even matching all the
+ *             remaining symbols, are dropped, so the pass stops shortly after
+ *             the farthest start.
+ *
+ *             The returned corner is the upper-left one of the rectangle
+ *             holding every optimal alignment ending at the end cell. The
+ *             local alignment of that rectangle alone has the same traceback
+ *             of the full matrix from the end cell.
+ *
+ * @param[in]  X       The X input sequence
+ * @param[in]  Y       The Y input sequence
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  end_i   The (1-based) end row of the alignment
+ * @param[in]  end_j   The (1-based) end column of the alignment
+ * @param[in]  score   The best score, i.e. the score of the end cell
+ * @param      start   The start cell farthest from the end cell, i.e. a cell
+ *                     from which the global alignment to the end cell scores
+ *                     the best score, can be NULL
+ *
+ * @return     The upper-left corner (i0, j0): the alignments lie within rows
+ *             i0 + 1 .. end_i and columns j0 + 1 .. end_j.
+ */
+idx_t sw_start_corner(const char* X, const char* Y, const matrix_t matrix,
+    const int end_i, const int end_j, const int score, idx_t* start);
+
+#endif // end SW_REVERSE_H_
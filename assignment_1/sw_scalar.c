@@ -0,0 +1,70 @@
+/*
+ * File:  sw_scalar.c
+ * Author: Stefano Ribes
+ *
+ * Scalar Smith-Waterman, the fallback of the SIMD kernels on saturation and
+ * on processors without a supported vector instruction set.
+ */
+#include "sw_striped.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * The matrix parameter is a compile-time constant at every call site, so the
+ * compiler emits a specialised loop for each substitution matrix.
+ */
+static ALWAYS_INLINE sw_result_t sw_scalar_fill(const uint8_t* X, const int m,
+    const uint8_t* Y, const int n, int* prev, int* curr,
+    const matrix_t matrix) {
+  sw_result_t res = {0, 0, 0, 0, 0};
+  int max_score = -((1 << 30) - 1); // Fairly small number
+  for (int i = 1; i <= m; ++i) {
+    for (int j = 1; j <= n; j++) {
+      int score = prev[j-1] + substitution_score(matrix, X[i-1], Y[j-1]);
+      score = prev[j] - GAP_PENALTY > score ? prev[j] - GAP_PENALTY : score;
+      score = curr[j-1] - GAP_PENALTY > score ? curr[j-1] - GAP_PENALTY : score;
+      score = score > 0 ? score : 0;
+      curr[j] = score;
+      if (score > max_score) {
+        max_score = score;
+        res.max_i = i;
+        res.max_j = j;
+      }
+    }
+    int* tmp = prev;
+    prev = curr;
+    curr = tmp;
+  }
+  res.score = max_score > 0 ? max_score : 0;
+  return res;
+}
+
+sw_result_t sw_scalar(const char* X, const int m, const char* Y,
+    const int n, const matrix_t matrix) {
+  int* prev = calloc(n + 1, sizeof(int));
+  int* curr = calloc(n + 1, sizeof(int));
+  uint8_t* X_codes = encode_sequence(matrix, X, m);
+  uint8_t* Y_codes = encode_sequence(matrix, Y, n);
+  sw_result_t res;
+  switch (matrix) {
+    case MATRIX_DNA:
+      res = sw_scalar_fill(X_codes, m, Y_codes, n, prev, curr, MATRIX_DNA);
+      break;
+    case MATRIX_BLOSUM62:
+      res = sw_scalar_fill(X_codes, m, Y_codes, n, prev, curr,
+        MATRIX_BLOSUM62);
+      break;
+    case MATRIX_PAM250:
+      res = sw_scalar_fill(X_codes, m, Y_codes, n, prev, curr, MATRIX_PAM250);
+      break;
+    default:
+      res = sw_scalar_fill(X_codes, m, Y_codes, n, prev, curr,
+        MATRIX_IDENTITY);
+  }
+  free(prev);
+  free(curr);
+  free(X_codes);
+  free(Y_codes);
+  return res;
+}
@@ -0,0 +1,396 @@
+/*
+ * File:  sw_striped.c
+ * Author: Stefano Ribes
+ *
+ * Farrar's striped Smith-Waterman (Bioinformatics 23(2), 2007), with the
+ * linear gap penalty of local_alignment.c. Query position i is stored in lane
+ * i / seg_len of vector i % seg_len, so that the vertical dependency only
+ * crosses vectors once per column and is fixed up by the "lazy F" loop. The
+ * substitution matrix only enters the query profile, so the inner loops do
+ * not depend on it.
+ *
+ * The file is compiled once per instruction set, see simd.h.
+ */
+#include "sw_striped.h"
+#include "simd.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * @brief      Maps the characters to a compact alphabet. With the identity
+ *             matrix the alphabet is made of the query characters, and code 0
+ *             is reserved to characters which are not in the query. Otherwise
+ *             it is the alphabet of the substitution matrix.
+ */
+typedef struct {
+  uint8_t code[256];
+  int num_codes;
+  char symbol[256];
+  matrix_t matrix;
+  int bias; // Added to the 8-bit scores to make them non-negative
+  int max_score;
+} alphabet_t;
+
+static void build_alphabet(const char* X, const int m, const matrix_t matrix,
+    alphabet_t* alpha) {
+  const int kMinScore = matrix_min_score(matrix);
+  alpha->matrix = matrix;
+  alpha->bias = kMinScore < 0 ? -kMinScore : 0;
+  alpha->max_score = matrix_max_score(matrix);
+  if (matrix != MATRIX_IDENTITY) {
+    build_symbol_codes(matrix, alpha->code);
+    alpha->num_codes = matrix_num_codes(matrix);
+    return;
+  }
+  memset(alpha->code, 0, sizeof(alpha->code));
+  alpha->num_codes = 1;
+  alpha->symbol[0] = 0;
+  for (int i = 0; i < m; ++i) {
+    const uint8_t c = (uint8_t)X[i];
+    if (alpha->code[c] == 0) {
+      alpha->symbol[alpha->num_codes] = X[i];
+      alpha->code[c] = alpha->num_codes++;
+    }
+  }
+}
+
+/**
+ * @brief      Gets the score of a query character against a symbol code.
+ */
+static inline int profile_score(const alphabet_t* alpha, const char x,
+    const int c) {
+  if (alpha->matrix == MATRIX_IDENTITY) {
+    return (c != 0 && x == alpha->symbol[c]) ? MATCH_SCORE : MISMATCH_SCORE;
+  }
+  return substitution_score(alpha->matrix, alpha->code[(uint8_t)x], c);
+}
+
+/**
+ * @brief      Finds the first query position of a striped column holding the
+ *             given score.
+ *
+ * @param[in]  H           The striped column
+ * @param[in]  seg_len     The number of vectors in the column
+ * @param[in]  target      The target score, broadcast to all lanes
+ * @param[in]  lane_bytes  The lane width in bytes
+ *
+ * @return     The 0-based query position.
+ */
+static int first_position(const vec_t* H, const int seg_len,
+    const vec_t target, const int lane_bytes) {
+  int best = -1;
+  for (int s = 0; s < seg_len; ++s) {
+    const vec_t eq = lane_bytes == 1 ? v8_eq(vec_load(H + s), target) :
+      lane_bytes == 2 ? v16_eq(vec_load(H + s), target) :
+      v32_eq(vec_load(H + s), target);
+    const vec_mask_t mask = vec_movemask(eq);
+    if (mask) {
+      const int lane = vec_ctz(mask) / lane_bytes;
+      const int i = lane * seg_len + s;
+      if (best < 0 || i < best) {
+        best = i;
+      }
+    }
+  }
+  return best;
+}
+
+/*
+ * Keep the row-major tie breaking of the scalar fill: among equal scores the
+ * smallest row wins, then the smallest column.
+ */
+static inline void update_best(sw_result_t* res, const int score, const int i,
+    const int j) {
+  if (score > res->score || (score == res->score && i < res->max_i)) {
+    res->score = score;
+    res->max_i = i;
+    res->max_j = j;
+  }
+}
+
+/**
+ * @brief      Striped kernel on unsigned 8-bit lanes, biased by the opposite of
+ *             the lowest substitution score.
+ *
+ * @return     Zero on success, non-zero if the scores saturated.
+ */
+static int sw_striped_u8(const char* X, const int m, const char* Y,
+    const int n, const alphabet_t* alpha, sw_result_t* res) {
+  const int seg_len = (m + V8_LANES - 1) / V8_LANES;
+  vec_t* profile = vec_alloc((size_t)alpha->num_codes * seg_len);
+  vec_t* H_store = vec_alloc(seg_len);
+  vec_t* H_load = vec_alloc(seg_len);
+  vec_t* E = vec_alloc(seg_len);
+  /*
+   * Query profile: score of each query position against each symbol.
+   */
+  for (int c = 0; c < alpha->num_codes; ++c) {
+    uint8_t* p = (uint8_t*)(profile + (size_t)c * seg_len);
+    for (int s = 0; s < seg_len; ++s) {
+      for (int lane = 0; lane < V8_LANES; ++lane) {
+        const int i = lane * seg_len + s;
+        int score = 0;
+        if (i < m) {
+          score = profile_score(alpha, X[i], c) + alpha->bias;
+        }
+        p[s * V8_LANES + lane] = (uint8_t)score;
+      }
+    }
+  }
+  for (int s = 0; s < seg_len; ++s) {
+    vec_store(H_store + s, vec_zero());
+    vec_store(E + s, vec_zero());
+  }
+  const vec_t v_gap = vec_set1_u8(GAP_PENALTY);
+  const vec_t v_bias = vec_set1_u8(alpha->bias);
+  const int kSaturation = UINT8_MAX - alpha->max_score - alpha->bias;
+  int overflow = 0;
+  for (int j = 0; j < n && !overflow; ++j) {
+    const vec_t* p = profile + (size_t)alpha->code[(uint8_t)Y[j]] * seg_len;
+    vec_t v_f = vec_zero();
+    vec_t v_max = vec_zero();
+    vec_t v_h = v8_shift_lane(vec_load(H_store + seg_len - 1));
+    vec_t* tmp = H_load;
+    H_load = H_store;
+    H_store = tmp;
+    for (int s = 0; s < seg_len; ++s) {
+      v_h = v8_subs(v8_adds(v_h, vec_load(p + s)), v_bias);
+      const vec_t v_e = vec_load(E + s);
+      v_h = v8_max(v_h, v_e);
+      v_h = v8_max(v_h, v_f);
+      v_max = v8_max(v_max, v_h);
+      vec_store(H_store + s, v_h);
+      v_h = v8_subs(v_h, v_gap);
+      vec_store(E + s, v8_max(v8_subs(v_e, v_gap), v_h));
+      v_f = v8_max(v8_subs(v_f, v_gap), v_h);
+      v_h = vec_load(H_load + s);
+    }
+    /*
+     * Lazy F loop: propagate the vertical gaps across the stripes until they
+     * cannot improve any cell anymore.
+     */
+    v_f = v8_shift_lane(v_f);
+    int s = 0;
+    while (v8_any_gt(v_f, v8_subs(vec_load(H_store + s), v_gap))) {
+      v_h = v8_max(vec_load(H_store + s), v_f);
+      vec_store(H_store + s, v_h);
+      v_max = v8_max(v_max, v_h);
+      v_h = v8_subs(v_h, v_gap);
+      vec_store(E + s, v8_max(vec_load(E + s), v_h));
+      v_f = v8_subs(v_f, v_gap);
+      if (++s == seg_len) {
+        s = 0;
+        v_f = v8_shift_lane(v_f);
+      }
+    }
+    /*
+     * Only look for the end cell when the column can beat (or tie) the best
+     * score so far.
+     */
+    if (res->score < 0 || v8_any_ge(v_max, vec_set1_u8((uint8_t)res->score))) {
+      const int col_max = v8_hmax(v_max);
+      if (col_max >= kSaturation) {
+        overflow = 1;
+      } else if (col_max >= res->score) {
+        const int i = first_position(H_store, seg_len,
+          vec_set1_u8((uint8_t)col_max), 1);
+        update_best(res, col_max, i + 1, j + 1);
+      }
+    }
+  }
+  free(profile);
+  free(H_store);
+  free(H_load);
+  free(E);
+  return overflow;
+}
+
+/**
+ * @brief      Striped kernel on signed 16-bit lanes.
+ *
+ * @return     Zero on success, non-zero if the scores saturated.
+ */
+static int sw_striped_i16(const char* X, const int m, const char* Y,
+    const int n, const alphabet_t* alpha, sw_result_t* res) {
+  const int seg_len = (m + V16_LANES - 1) / V16_LANES;
+  vec_t* profile = vec_alloc((size_t)alpha->num_codes * seg_len);
+  vec_t* H_store = vec_alloc(seg_len);
+  vec_t* H_load = vec_alloc(seg_len);
+  vec_t* E = vec_alloc(seg_len);
+  for (int c = 0; c < alpha->num_codes; ++c) {
+    int16_t* p = (int16_t*)(profile + (size_t)c * seg_len);
+    for (int s = 0; s < seg_len; ++s) {
+      for (int lane = 0; lane < V16_LANES; ++lane) {
+        const int i = lane * seg_len + s;
+        int score = INT16_MIN;
+        if (i < m) {
+          score = profile_score(alpha, X[i], c);
+        }
+        p[s * V16_LANES + lane] = (int16_t)score;
+      }
+    }
+  }
+  for (int s = 0; s < seg_len; ++s) {
+    vec_store(H_store + s, vec_zero());
+    vec_store(E + s, vec_zero());
+  }
+  const vec_t v_gap = vec_set1_i16(GAP_PENALTY);
+  const vec_t v_zero = vec_zero();
+  const int kSaturation = INT16_MAX - alpha->max_score;
+  int overflow = 0;
+  for (int j = 0; j < n && !overflow; ++j) {
+    const vec_t* p = profile + (size_t)alpha->code[(uint8_t)Y[j]] * seg_len;
+    vec_t v_f = vec_zero();
+    vec_t v_max = vec_zero();
+    vec_t v_h = v16_shift_lane(vec_load(H_store + seg_len - 1));
+    vec_t* tmp = H_load;
+    H_load = H_store;
+    H_store = tmp;
+    for (int s = 0; s < seg_len; ++s) {
+      v_h = v16_max(v16_adds(v_h, vec_load(p + s)), v_zero);
+      const vec_t v_e = vec_load(E + s);
+      v_h = v16_max(v_h, v_e);
+      v_h = v16_max(v_h, v_f);
+      v_max = v16_max(v_max, v_h);
+      vec_store(H_store + s, v_h);
+      v_h = v16_subs(v_h, v_gap);
+      vec_store(E + s, v16_max(v16_subs(v_e, v_gap), v_h));
+      v_f = v16_max(v16_subs(v_f, v_gap), v_h);
+      v_h = vec_load(H_load + s);
+    }
+    v_f = v16_shift_lane(v_f);
+    int s = 0;
+    while (v16_any_gt(v_f, v16_subs(vec_load(H_store + s), v_gap))) {
+      v_h = v16_max(vec_load(H_store + s), v_f);
+      vec_store(H_store + s, v_h);
+      v_max = v16_max(v_max, v_h);
+      v_h = v16_subs(v_h, v_gap);
+      vec_store(E + s, v16_max(vec_load(E + s), v_h));
+      v_f = v16_subs(v_f, v_gap);
+      if (++s == seg_len) {
+        s = 0;
+        v_f = v16_shift_lane(v_f);
+      }
+    }
+    if (res->score < 0 ||
+        v16_any_ge(v_max, vec_set1_i16((int16_t)res->score))) {
+      const int col_max = v16_hmax(v_max);
+      if (col_max >= kSaturation) {
+        overflow = 1;
+      } else if (col_max >= res->score) {
+        const int i = first_position(H_store, seg_len,
+          vec_set1_i16((int16_t)col_max), 2);
+        update_best(res, col_max, i + 1, j + 1);
+      }
+    }
+  }
+  free(profile);
+  free(H_store);
+  free(H_load);
+  free(E);
+  return overflow;
+}
+
+/**
+ * @brief      Striped kernel on signed 32-bit lanes, which hold any score of
+ *             the scalar kernel and so cannot saturate. The padding positions
+ *             of the query profile score low enough never to become positive.
+ */
+static void sw_striped_i32(const char* X, const int m, const char* Y,
+    const int n, const alphabet_t* alpha, sw_result_t* res) {
+  const int seg_len = (m + V32_LANES - 1) / V32_LANES;
+  vec_t* profile = vec_alloc((size_t)alpha->num_codes * seg_len);
+  vec_t* H_store = vec_alloc(seg_len);
+  vec_t* H_load = vec_alloc(seg_len);
+  vec_t* E = vec_alloc(seg_len);
+  for (int c = 0; c < alpha->num_codes; ++c) {
+    int32_t* p = (int32_t*)(profile + (size_t)c * seg_len);
+    for (int s = 0; s < seg_len; ++s) {
+      for (int lane = 0; lane < V32_LANES; ++lane) {
+        const int i = lane * seg_len + s;
+        int score = INT32_MIN / 2;
+        if (i < m) {
+          score = profile_score(alpha, X[i], c);
+        }
+        p[s * V32_LANES + lane] = score;
+      }
+    }
+  }
+  for (int s = 0; s < seg_len; ++s) {
+    vec_store(H_store + s, vec_zero());
+    vec_store(E + s, vec_zero());
+  }
+  const vec_t v_gap = vec_set1_i32(GAP_PENALTY);
+  const vec_t v_zero = vec_zero();
+  for (int j = 0; j < n; ++j) {
+    const vec_t* p = profile + (size_t)alpha->code[(uint8_t)Y[j]] * seg_len;
+    vec_t v_f = vec_zero();
+    vec_t v_max = vec_zero();
+    vec_t v_h = v32_shift_lane(vec_load(H_store + seg_len - 1));
+    vec_t* tmp = H_load;
+    H_load = H_store;
+    H_store = tmp;
+    for (int s = 0; s < seg_len; ++s) {
+      v_h = v32_max(v32_add(v_h, vec_load(p + s)), v_zero);
+      const vec_t v_e = vec_load(E + s);
+      v_h = v32_max(v_h, v_e);
+      v_h = v32_max(v_h, v_f);
+      v_max = v32_max(v_max, v_h);
+      vec_store(H_store + s, v_h);
+      v_h = v32_sub(v_h, v_gap);
+      vec_store(E + s, v32_max(v32_sub(v_e, v_gap), v_h));
+      v_f = v32_max(v32_sub(v_f, v_gap), v_h);
+      v_h = vec_load(H_load + s);
+    }
+    v_f = v32_shift_lane(v_f);
+    int s = 0;
+    while (v32_any_gt(v_f, v32_sub(vec_load(H_store + s), v_gap))) {
+      v_h = v32_max(vec_load(H_store + s), v_f);
+      vec_store(H_store + s, v_h);
+      v_max = v32_max(v_max, v_h);
+      v_h = v32_sub(v_h, v_gap);
+      vec_store(E + s, v32_max(vec_load(E + s), v_h));
+      v_f = v32_sub(v_f, v_gap);
+      if (++s == seg_len) {
+        s = 0;
+        v_f = v32_shift_lane(v_f);
+      }
+    }
+    if (res->score < 0 || v32_any_ge(v_max, vec_set1_i32(res->score))) {
+      const int col_max = v32_hmax(v_max);
+      if (col_max >= res->score) {
+        const int i = first_position(H_store, seg_len,
+          vec_set1_i32(col_max), 4);
+        update_best(res, col_max, i + 1, j + 1);
+      }
+    }
+  }
+  free(profile);
+  free(H_store);
+  free(H_load);
+  free(E);
+}
+
+sw_result_t SIMD_NAME(sw_striped)(const char* X, const int m, const char* Y,
+    const int n, const matrix_t matrix) {
+  sw_result_t res = {-1, 0, 0, 8, 0};
+  if (m == 0 || n == 0) {
+    return sw_scalar(X, m, Y, n, matrix);
+  }
+  alphabet_t alpha;
+  build_alphabet(X, m, matrix, &alpha);
+  if (!sw_striped_u8(X, m, Y, n, &alpha, &res)) {
+    return res;
+  }
+  res.score = -1;
+  res.score_bits = 16;
+  if (!sw_striped_i16(X, m, Y, n, &alpha, &res)) {
+    return res;
+  }
+  res.score = -1;
+  res.score_bits = 32;
+  sw_striped_i32(X, m, Y, n, &alpha, &res);
+  return res;
+}
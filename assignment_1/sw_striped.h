@@ -0,0 +1,80 @@
+/*
+ * File:  sw_striped.h
+ * Author: Stefano Ribes
+ */
+#ifndef SW_STRIPED_H_
+#define SW_STRIPED_H_
+
+#include "alignment.h"
+#include "scoring.h"
+
+/*
+ * @brief      Result of a score-only local alignment: best score and its
+ *             (1-based) end cell, i.e. the first cell in row-major order
+ *             holding the maximum score, as in local_alignment.c.
+ */
+typedef struct {
+  int score;
+  int max_i;
+  int max_j;
+  int score_bits; // Width of the lanes which produced the score, 0 if scalar
+  char strand; // '+' or '-' when both strands are scored, 0 otherwise
+} sw_result_t;
+
+/*
+ * @brief      Number of results produced at each lane width. A result of the
+ *             32-bit lanes was first computed on 8-bit and 16-bit lanes too.
+ */
+typedef struct {
+  int num_scalar;
+  int num_8;
+  int num_16;
+  int num_32;
+} sw_width_stats_t;
+
+/**
+ * @brief      Score-only Smith-Waterman with a Farrar striped query profile.
+ *             The X sequence is the query, striped across the vector lanes,
+ *             and Y is scanned column by column. The kernel first runs on
+ *             8-bit lanes and is re-run on 16-bit lanes on saturation, then on
+ *             32-bit lanes. The variant of the instruction set of
+ *             cpu_isa() is called, the scalar kernel if there is none.
+ *
+ * @param[in]  X       The X input sequence (query)
+ * @param[in]  m       The length of the X sequence
+ * @param[in]  Y       The Y input sequence (database)
+ * @param[in]  n       The length of the Y sequence
+ * @param[in]  matrix  The substitution matrix
+ *
+ * @return     The best score and its end cell.
+ */
+sw_result_t sw_striped(const char* X, const int m, const char* Y, const int n,
+    const matrix_t matrix);
+
+/**
+ * @brief      Score-only Smith-Waterman keeping two rows of the score matrix.
+ *
+ * @param[in]  X       The X input sequence
+ * @param[in]  m       The length of the X sequence
+ * @param[in]  Y       The Y input sequence
+ * @param[in]  n       The length of the Y sequence
+ * @param[in]  matrix  The substitution matrix
+ *
+ * @return     The best score and its end cell.
+ */
+sw_result_t sw_scalar(const char* X, const int m, const char* Y, const int n,
+    const matrix_t matrix);
+
+/**
+ * @brief      Counts the results produced at each lane width, to measure how
+ *             often the 8-bit lanes are enough.
+ *
+ * @param[in]  results      The results
+ * @param[in]  num_results  The number of results
+ *
+ * @return     The counts.
+ */
+sw_width_stats_t sw_width_stats(const sw_result_t* results,
+    const int num_results);
+
+#endif // end SW_STRIPED_H_
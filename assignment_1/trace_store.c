@@ -0,0 +1,37 @@
+/*
+ * File:  trace_store.c
+ * Author: Stefano Ribes
+ */
+#include "trace_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t row_bytes(const int n) {
+  const size_t kBytes = ((size_t)n + 2) / 2; // Nibbles 0 .. n + 1
+  return (kBytes + TRACE_STORE_ALIGN - 1) / TRACE_STORE_ALIGN *
+    TRACE_STORE_ALIGN;
+}
+
+size_t trace_store_bytes(const int m, const int n) {
+  return ((size_t)m + 1) * row_bytes(n);
+}
+
+int trace_store_init(trace_store_t* store, const int m, const int n) {
+  store->m = m;
+  store->n = n;
+  store->row_bytes = row_bytes(n);
+  void* cells = NULL;
+  if (posix_memalign(&cells, TRACE_STORE_ALIGN, trace_store_bytes(m, n))) {
+    store->cells = NULL;
+    return 1;
+  }
+  store->cells = cells;
+  memset(store->cells, 0, trace_store_bytes(m, n));
+  return 0;
+}
+
+void trace_store_free(trace_store_t* store) {
+  free(store->cells);
+  store->cells = NULL;
+}
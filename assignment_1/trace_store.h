@@ -0,0 +1,94 @@
+/*
+ * File:  trace_store.h
+ * Author: Stefano Ribes
+ */
+#ifndef TRACE_STORE_H_
+#define TRACE_STORE_H_
+
+#include "alignment.h"
+
+#include <stdint.h>
+
+#define TRACE_STORE_ALIGN 64 // Rows start on a cache line
+
+/*
+ * Tie flags of a cell: the moves reaching its score. A cell without flags is a
+ * STOP cell.
+ */
+#define TIE_UP 1
+#define TIE_LEFT 2
+#define TIE_DIAG 4
+
+/*
+ * @brief      Packed traceback of a (m+1)x(n+1) alignment matrix. Each cell
+ *             takes 4 bits holding its tie flags, and cell (i, j) is stored in
+ *             nibble j + 1 of row i, so that tiles starting at odd columns
+ *             and spanning an even number of columns never share a byte. The
+ *             rows are stored row-major and padded to whole cache lines.
+ */
+typedef struct {
+  uint8_t* cells;
+  int m;
+  int n;
+  size_t row_bytes;
+} trace_store_t;
+
+/**
+ * @brief      Gets the size of the packed traceback of a (m+1)x(n+1) matrix.
+ *
+ * @param[in]  m     The length of the X sequence
+ * @param[in]  n     The length of the Y sequence
+ *
+ * @return     The traceback size in bytes.
+ */
+size_t trace_store_bytes(const int m, const int n);
+
+/**
+ * @brief      Allocates a packed traceback, with all the cells set to STOP.
+ *
+ * @param      store  The traceback
+ * @param[in]  m      The length of the X sequence
+ * @param[in]  n      The length of the Y sequence
+ *
+ * @return     Zero on success, non-zero if the allocation fails.
+ */
+int trace_store_init(trace_store_t* store, const int m, const int n);
+
+/**
+ * @brief      Releases a packed traceback.
+ *
+ * @param      store  The traceback
+ */
+void trace_store_free(trace_store_t* store);
+
+/**
+ * @brief      Gets the packed row i of a traceback.
+ */
+static inline uint8_t* trace_store_row(const trace_store_t* store,
+    const int i) {
+  return store->cells + (size_t)i * store->row_bytes;
+}
+
+/**
+ * @brief      Gets the tie flags of cell (i, j).
+ */
+static inline int trace_ties(const trace_store_t* store, const int i,
+    const int j) {
+  return (trace_store_row(store, i)[(j + 1) >> 1] >> (((j + 1) & 1) * 4)) &
+    0xf;
+}
+
+/**
+ * @brief      Gets the traced move of cell (i, j): ties are broken preferring
+ *             DIAG, then UP, then LEFT.
+ *
+ * @return     DIAG, UP, LEFT or STOP.
+ */
+static inline int trace_move(const trace_store_t* store, const int i,
+    const int j) {
+  const int kTies = trace_ties(store, i, j);
+  return (kTies & TIE_DIAG) ? DIAG : (kTies & TIE_UP) ? UP :
+    (kTies & TIE_LEFT) ? LEFT : STOP;
+}
+
+#endif // end TRACE_STORE_H_
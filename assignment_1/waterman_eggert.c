@@ -0,0 +1,256 @@
+/*
+ * File:  waterman_eggert.c
+ * Author: Stefano Ribes
+ *
+ * Clearing the cells of an alignment can only lower the scores of the cells
+ * below and to the right of them. Row i + 1 is recomputed over the columns
+ * that changed in row i (shifted by one for the diagonal moves), and further
+ * right as long as the horizontal gaps keep changing it.
+ */
+#include "waterman_eggert.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * @brief      Heap entry: the maximum of a row, valid while the row version is
+ *             the one it was pushed with.
+ */
+typedef struct {
+  int score;
+  int row;
+  int col;
+  int version;
+} row_max_t;
+
+/*
+ * @brief      State of the search: the score matrix, the cells taken by the
+ *             reported alignments and the heap of the row maxima.
+ */
+typedef struct {
+  const char* raw_X;
+  const char* raw_Y;
+  const uint8_t* X; // Encoded sequences
+  const uint8_t* Y;
+  int m;
+  int n;
+  matrix_t matrix;
+  int* H;
+  uint8_t* used;
+  int* version;
+  row_max_t* heap;
+  int heap_size;
+} search_t;
+
+static bool heap_before(const row_max_t* a, const row_max_t* b) {
+  return a->score > b->score || (a->score == b->score && a->row < b->row);
+}
+
+static void heap_push(search_t* s, const row_max_t entry) {
+  int k = s->heap_size++;
+  while (k > 0 && heap_before(&entry, &s->heap[(k - 1) / 2])) {
+    s->heap[k] = s->heap[(k - 1) / 2];
+    k = (k - 1) / 2;
+  }
+  s->heap[k] = entry;
+}
+
+static row_max_t heap_pop(search_t* s) {
+  const row_max_t kTop = s->heap[0];
+  const row_max_t kLast = s->heap[--s->heap_size];
+  int k = 0;
+  while (2 * k + 1 < s->heap_size) {
+    int child = 2 * k + 1;
+    if (child + 1 < s->heap_size &&
+        heap_before(&s->heap[child + 1], &s->heap[child])) {
+      ++child;
+    }
+    if (!heap_before(&s->heap[child], &kLast)) {
+      break;
+    }
+    s->heap[k] = s->heap[child];
+    k = child;
+  }
+  s->heap[k] = kLast;
+  return kTop;
+}
+
+/**
+ * @brief      Computes a cell from its up, left and diagonal neighbours. The
+ *             cells of the reported alignments are zero.
+ */
+static inline int cell_score(const search_t* s, const int i, const int j) {
+  const size_t kIdx = cell_idx(i, j, s->n);
+  if (s->used[kIdx]) {
+    return 0;
+  }
+  const int kDiag = s->H[cell_idx(i-1, j-1, s->n)] +
+    substitution_score(s->matrix, s->X[i-1], s->Y[j-1]);
+  const int kUp = s->H[cell_idx(i-1, j, s->n)] - GAP_PENALTY;
+  const int kLeft = s->H[kIdx - 1] - GAP_PENALTY;
+  int best = kDiag > 0 ? kDiag : 0;
+  best = kUp > best ? kUp : best;
+  return kLeft > best ? kLeft : best;
+}
+
+/**
+ * @brief      Pushes the maximum of a row, invalidating its previous entry.
+ */
+static void push_row_max(search_t* s, const int i) {
+  const int* kRow = s->H + cell_idx(i, 0, s->n);
+  int col = 1;
+  for (int j = 2; j <= s->n; ++j) {
+    col = kRow[j] > kRow[col] ? j : col;
+  }
+  ++s->version[i];
+  if (kRow[col] > 0) {
+    const row_max_t kEntry = {kRow[col], i, col, s->version[i]};
+    heap_push(s, kEntry);
+  }
+}
+
+/**
+ * @brief      Traces an alignment back from its end cell, with the tie-break
+ *             order of the other kernels (DIAG, UP, then LEFT), and marks its
+ *             cells as used.
+ */
+static void trace_hit(search_t* s, const row_max_t* end, local_hit_t* hit) {
+  hit->alignX = malloc(sizeof(char) * (end->row + end->col + 1));
+  hit->alignY = malloc(sizeof(char) * (end->row + end->col + 1));
+  if (hit->alignX == NULL || hit->alignY == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate an alignment\n");
+    exit(1);
+  }
+  hit->score = end->score;
+  hit->end_i = end->row;
+  hit->end_j = end->col;
+  hit->length = 0;
+  int i = end->row;
+  int j = end->col;
+  while (s->H[cell_idx(i, j, s->n)] > 0) {
+    const int kScore = s->H[cell_idx(i, j, s->n)];
+    s->used[cell_idx(i, j, s->n)] = 1;
+    if (kScore == s->H[cell_idx(i-1, j-1, s->n)] +
+        substitution_score(s->matrix, s->X[i-1], s->Y[j-1])) {
+      hit->alignX[hit->length] = s->raw_X[i-1];
+      hit->alignY[hit->length] = s->raw_Y[j-1];
+      --i;
+      --j;
+    } else if (kScore == s->H[cell_idx(i-1, j, s->n)] - GAP_PENALTY) {
+      hit->alignX[hit->length] = s->raw_X[i-1];
+      hit->alignY[hit->length] = '-';
+      --i;
+    } else {
+      hit->alignX[hit->length] = '-';
+      hit->alignY[hit->length] = s->raw_Y[j-1];
+      --j;
+    }
+    ++hit->length;
+  }
+  hit->start_i = i;
+  hit->start_j = j;
+}
+
+/**
+ * @brief      Recomputes the scores changed by the cells of an alignment,
+ *             from its first row down to the last row that changes.
+ */
+static void recompute(search_t* s, const local_hit_t* hit) {
+  int lo = hit->start_j + 1;
+  int hi = hit->end_j;
+  for (int i = hit->start_i + 1; i <= s->m; ++i) {
+    if (i <= hit->end_i) {
+      lo = lo < hit->start_j + 1 ? lo : hit->start_j + 1;
+      hi = hi > hit->end_j ? hi : hit->end_j;
+    } else if (lo > hi) {
+      break;
+    }
+    int changed_lo = s->n + 1;
+    int changed_hi = 0;
+    for (int j = lo > 1 ? lo : 1; j <= s->n; ++j) {
+      const int kScore = cell_score(s, i, j);
+      int* cell = &s->H[cell_idx(i, j, s->n)];
+      if (kScore == *cell) {
+        if (j >= hi) {
+          break;
+        }
+        continue;
+      }
+      *cell = kScore;
+      changed_lo = j < changed_lo ? j : changed_lo;
+      changed_hi = j;
+    }
+    if (changed_hi > 0) {
+      push_row_max(s, i);
+    }
+    lo = changed_lo;
+    hi = changed_hi + 1 <= s->n ? changed_hi + 1 : s->n;
+  }
+}
+
+int waterman_eggert(const char* X, const int m, const char* Y, const int n,
+    const matrix_t matrix, const int k, const int min_score,
+    local_hit_t* hits) {
+  search_t s;
+  s.raw_X = X;
+  s.raw_Y = Y;
+  s.X = encode_sequence(matrix, X, m);
+  s.Y = encode_sequence(matrix, Y, n);
+  s.m = m;
+  s.n = n;
+  s.matrix = matrix;
+  s.H = calloc(cell_idx(m + 1, 0, n), sizeof(int));
+  s.used = calloc(cell_idx(m + 1, 0, n), sizeof(uint8_t));
+  s.version = calloc(m + 1, sizeof(int));
+  /*
+   * A row is pushed again at each of its recomputations, at most once per
+   * alignment, so the heap holds at most (k + 1) m entries.
+   */
+  s.heap = malloc(sizeof(row_max_t) * ((size_t)(k + 1) * m + 1));
+  s.heap_size = 0;
+  if (s.H == NULL || s.used == NULL || s.version == NULL || s.heap == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the %dx%d matrix\n", m, n);
+    exit(1);
+  }
+  for (int i = 1; i <= m; ++i) {
+    for (int j = 1; j <= n; ++j) {
+      s.H[cell_idx(i, j, n)] = cell_score(&s, i, j);
+    }
+    push_row_max(&s, i);
+  }
+  int num_hits = 0;
+  while (num_hits < k && s.heap_size > 0) {
+    const row_max_t kTop = heap_pop(&s);
+    if (kTop.version != s.version[kTop.row]) {
+      continue; // The row was recomputed after this entry
+    }
+    if (kTop.score < min_score) {
+      break;
+    }
+    trace_hit(&s, &kTop, &hits[num_hits]);
+    recompute(&s, &hits[num_hits]);
+    ++num_hits;
+  }
+  free((uint8_t*)s.X);
+  free((uint8_t*)s.Y);
+  free(s.H);
+  free(s.used);
+  free(s.version);
+  free(s.heap);
+  return num_hits;
+}
+
+size_t waterman_eggert_bytes(const int m, const int n, const int k) {
+  return (sizeof(int) + sizeof(uint8_t)) * cell_idx(m + 1, 0, n) +
+    sizeof(int) * (m + 1) + sizeof(row_max_t) * ((size_t)(k + 1) * m + 1);
+}
+
+void local_hits_free(local_hit_t* hits, const int num_hits) {
+  for (int h = 0; h < num_hits; ++h) {
+    free(hits[h].alignX);
+    free(hits[h].alignY);
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * File:  waterman_eggert.h
+ * Author: Stefano Ribes
+ */
+#ifndef WATERMAN_EGGERT_H_
+#define WATERMAN_EGGERT_H_
+
+#include "alignment.h"
+#include "scoring.h"
+
+/*
+ * @brief      Local alignment found by waterman_eggert(). The aligned strings
+ *             are stored backwards, as for print_alignment().
+ */
+typedef struct {
+  int score;
+  int start_i; // The alignment covers X[start_i .. end_i-1]
+  int start_j; // and Y[start_j .. end_j-1]
+  int end_i;
+  int end_j;
+  int length;
+  char* alignX;
+  char* alignY;
+} local_hit_t;
+
+/**
+ * @brief      Finds the K best non-overlapping local alignments (Waterman and
+ *             Eggert): each alignment is the best one that shares no cell of
+ *             the matrix with the previous ones. The cells of a reported
+ *             alignment are cleared, then only the rows and columns whose
+ *             scores change are recomputed, from its first row downwards. The
+ *             next alignment ends at the top of a max-heap holding the
+ *             maximum of each row, whose stale entries are skipped.
+ *
+ *             The full score matrix is kept, i.e. O(m n) memory.
+ *
+ * @param[in]  X          The X input sequence
+ * @param[in]  m          The length of the X sequence
+ * @param[in]  Y          The Y input sequence
+ * @param[in]  n          The length of the Y sequence
+ * @param[in]  matrix     The substitution matrix
+ * @param[in]  k          The maximum number of alignments
+ * @param[in]  min_score  The minimum score of an alignment, at least 1
+ * @param      hits       The k alignments, to be released with
+ *                        local_hits_free()
+ *
+ * @return     The number of alignments found, by decreasing score.
+ */
+int waterman_eggert(const char* X, const int m, const char* Y, const int n,
+    const matrix_t matrix, const int k, const int min_score,
+    local_hit_t* hits);
+
+/**
+ * @brief      Gets the memory taken by waterman_eggert(): the score matrix,
+ *             the used cells and the heap of the row maxima.
+ *
+ * @param[in]  m     The length of the X sequence
+ * @param[in]  n     The length of the Y sequence
+ * @param[in]  k     The maximum number of alignments
+ *
+ * @return     The size in bytes.
+ */
+size_t waterman_eggert_bytes(const int m, const int n, const int k);
+
+/**
+ * @brief      Releases the aligned strings of some alignments.
+ *
+ * @param      hits      The alignments
+ * @param[in]  num_hits  The number of alignments
+ */
+void local_hits_free(local_hit_t* hits, const int num_hits);
+
+#endif // end WATERMAN_EGGERT_H_
@@ -0,0 +1,242 @@
+/*
+ * File:  wavefront.c
+ * Author: Stefano Ribes
+ *
+ * Tiled anti-diagonal (wavefront) fill of the DP matrices. Each tile is an
+ * OpenMP task depending on the tiles above and on the left, so tiles on the
+ * same anti-diagonal run concurrently without a barrier between diagonals.
+ * Within a tile the cells are computed with the same code and order of the
+ * serial fill, hence the results are bit-identical. The sequences are encoded
+ * once in the alphabet of the substitution matrix.
+ *
+ * The fills do not need the score matrix: a tile only reads the last row of
+ * the tile above and the last column of the tile on the left, so only the
+ * scores on the tile boundaries are kept, next to the packed traceback.
+ */
+#include "wavefront.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+/*
+ * @brief      Matrices and boundaries shared by the tiles of a fill.
+ */
+typedef struct {
+  const uint8_t* X;
+  const uint8_t* Y;
+  int m;
+  int n;
+  int tile;
+  matrix_t matrix;
+  int* F; // Score matrix, optional
+  trace_store_t* store; // Packed traceback
+  int* rows; // Last row of each tile row
+  int* cols; // Last column of each tile column
+} wavefront_t;
+
+/*
+ * The bool and matrix parameters are compile-time constants at every call
+ * site, so the compiler emits a specialised loop for each combination.
+ */
+static ALWAYS_INLINE void fill_tile(const wavefront_t* w, const int i_start,
+    const int i_end, const int j_start, const int j_end, const int ti,
+    const int tj, const bool store_F, const bool is_local,
+    const matrix_t matrix) {
+  const int n = w->n;
+  const int kWidth = j_end - j_start + 1;
+  const int* kTop = w->rows + (size_t)ti * (n + 1);
+  int* bottom = w->rows + (size_t)(ti + 1) * (n + 1);
+  const int* kLeft = w->cols + (size_t)tj * (w->m + 1);
+  int* right = w->cols + (size_t)(tj + 1) * (w->m + 1);
+  // Scores of the row above, from column j_start - 1.
+  int* row = malloc(sizeof(int) * (kWidth + 1));
+  memcpy(row, kTop + j_start - 1, sizeof(int) * (kWidth + 1));
+  for (int i = i_start; i <= i_end; ++i) {
+    const uint8_t x = w->X[i-1];
+    uint8_t* trace_row = trace_store_row(w->store, i);
+    int diag_score = row[0];
+    int score = kLeft[i];
+    row[0] = score;
+    for (int k = 1; k <= kWidth; ++k) {
+      const int j = j_start + k - 1;
+      const int up_score = row[k];
+      const int diag = diag_score + substitution_score(matrix, x, w->Y[j-1]);
+      const int up = up_score - GAP_PENALTY;
+      const int left = score - GAP_PENALTY;
+      score = up > diag ? up : diag;
+      score = left > score ? left : score;
+      int ties = (diag == score ? TIE_DIAG : 0) |
+        (up == score ? TIE_UP : 0) | (left == score ? TIE_LEFT : 0);
+      if (is_local) {
+        // Stop trace if score is equal to zero.
+        ties = score > 0 ? ties : 0;
+        score = score > 0 ? score : 0;
+      }
+      // Cell (i, j) is nibble j + 1, and j_start is odd: the tile starts on
+      // a low nibble.
+      if ((j & 1) == 1) {
+        trace_row[(j + 1) >> 1] = ties;
+      } else {
+        trace_row[(j + 1) >> 1] |= ties << 4;
+      }
+      if (store_F) {
+        w->F[cell_idx(i, j, n)] = score;
+      }
+      diag_score = up_score;
+      row[k] = score;
+    }
+    right[i] = score;
+  }
+  memcpy(bottom + j_start, row + 1, sizeof(int) * kWidth);
+  free(row);
+}
+
+static ALWAYS_INLINE void fill_tile_matrix(const wavefront_t* w,
+    const int ti, const int tj, const bool is_local, const matrix_t matrix) {
+  const int i_start = ti * w->tile + 1;
+  const int j_start = tj * w->tile + 1;
+  const int i_end = i_start + w->tile - 1 < w->m ? i_start + w->tile - 1 :
+    w->m;
+  const int j_end = j_start + w->tile - 1 < w->n ? j_start + w->tile - 1 :
+    w->n;
+  if (w->F != NULL) {
+    fill_tile(w, i_start, i_end, j_start, j_end, ti, tj, true, is_local,
+      matrix);
+  } else {
+    fill_tile(w, i_start, i_end, j_start, j_end, ti, tj, false, is_local,
+      matrix);
+  }
+}
+
+static void fill_tile_dispatch(const wavefront_t* w, const int ti,
+    const int tj, const bool is_local) {
+  switch (w->matrix) {
+    case MATRIX_DNA:
+      fill_tile_matrix(w, ti, tj, is_local, MATRIX_DNA);
+      break;
+    case MATRIX_BLOSUM62:
+      fill_tile_matrix(w, ti, tj, is_local, MATRIX_BLOSUM62);
+      break;
+    case MATRIX_PAM250:
+      fill_tile_matrix(w, ti, tj, is_local, MATRIX_PAM250);
+      break;
+    default:
+      fill_tile_matrix(w, ti, tj, is_local, MATRIX_IDENTITY);
+  }
+}
+
+static void wavefront_fill(const wavefront_t* w, const int num_threads,
+    const bool is_local) {
+  const int kTileRows = (w->m + w->tile - 1) / w->tile;
+  const int kTileCols = (w->n + w->tile - 1) / w->tile;
+  if (num_threads <= 1 || (kTileRows == 1 && kTileCols == 1)) {
+    for (int ti = 0; ti < kTileRows; ++ti) {
+      for (int tj = 0; tj < kTileCols; ++tj) {
+        fill_tile_dispatch(w, ti, tj, is_local);
+      }
+    }
+    return;
+  }
+  /*
+   * One dependency token per tile, plus a sentinel row and column for the
+   * tiles on the matrix boundary.
+   */
+  char* deps = calloc((size_t)(kTileRows + 1) * (kTileCols + 1), sizeof(char));
+  const int kStride = kTileCols + 1;
+  #pragma omp parallel num_threads(num_threads)
+  #pragma omp single
+  {
+    for (int d = 0; d < kTileRows + kTileCols - 1; ++d) {
+      const int ti_start = d < kTileCols ? 0 : d - kTileCols + 1;
+      const int ti_end = d < kTileRows ? d : kTileRows - 1;
+      for (int ti = ti_start; ti <= ti_end; ++ti) {
+        const int tj = d - ti;
+        // The tokens of the tiles above and to the left, and of the tile.
+        #pragma omp task depend(in: deps[ti * kStride + tj + 1], \
+            deps[(ti + 1) * kStride + tj]) \
+            depend(out: deps[(ti + 1) * kStride + tj + 1]) firstprivate(ti, tj)
+        fill_tile_dispatch(w, ti, tj, is_local);
+      }
+    }
+  }
+  free(deps);
+}
+
+/**
+ * @brief      Fills a matrix by tiles, given the score of the cells of row 0
+ *             and column 0, -gap times their index: GAP_PENALTY for the global
+ *             alignment, zero for the local one.
+ *
+ * @return     The score of cell (m, n).
+ */
+static int fill(const char* X, const char* Y, const int m, const int n,
+    const matrix_t matrix, int* F, trace_store_t* store, const int tile,
+    const int num_threads, const bool is_local) {
+  const int kGap = is_local ? 0 : GAP_PENALTY;
+  if (F != NULL) {
+    for (int i = 0; i <= m; ++i) {
+      F[cell_idx(i, 0, n)] = -kGap * i;
+    }
+    for (int j = 0; j <= n; ++j) {
+      F[j] = -kGap * j;
+    }
+  }
+  if (m == 0 || n == 0) {
+    return -kGap * (m + n);
+  }
+  wavefront_t w;
+  w.m = m;
+  w.n = n;
+  w.tile = tile + (tile & 1); // Tiles must not share a byte of the traceback
+  w.matrix = matrix;
+  w.F = F;
+  w.store = store;
+  const int kTileRows = (m + w.tile - 1) / w.tile;
+  const int kTileCols = (n + w.tile - 1) / w.tile;
+  w.rows = malloc(sizeof(int) * (kTileRows + 1) * (size_t)(n + 1));
+  w.cols = malloc(sizeof(int) * (kTileCols + 1) * (size_t)(m + 1));
+  if (w.rows == NULL || w.cols == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the tile boundaries\n");
+    exit(1);
+  }
+  for (int j = 0; j <= n; ++j) {
+    w.rows[j] = -kGap * j;
+  }
+  for (int ti = 1; ti <= kTileRows; ++ti) {
+    const int kRow = ti * w.tile < m ? ti * w.tile : m;
+    w.rows[(size_t)ti * (n + 1)] = -kGap * kRow;
+  }
+  for (int i = 0; i <= m; ++i) {
+    w.cols[i] = -kGap * i;
+  }
+  for (int tj = 1; tj <= kTileCols; ++tj) {
+    const int kCol = tj * w.tile < n ? tj * w.tile : n;
+    w.cols[(size_t)tj * (m + 1)] = -kGap * kCol;
+  }
+  uint8_t* X_codes = encode_sequence(matrix, X, m);
+  uint8_t* Y_codes = encode_sequence(matrix, Y, n);
+  w.X = X_codes;
+  w.Y = Y_codes;
+  wavefront_fill(&w, num_threads, is_local);
+  const int kScore = w.rows[(size_t)kTileRows * (n + 1) + n];
+  free(w.rows);
+  free(w.cols);
+  free(X_codes);
+  free(Y_codes);
+  return kScore;
+}
+
+int wavefront_fill_global(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, int* F, trace_store_t* store,
+    const int tile, const int num_threads) {
+  return fill(X, Y, m, n, matrix, F, store, tile, num_threads, false);
+}
+
+void wavefront_fill_local(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, int* F, trace_store_t* store,
+    const int tile, const int num_threads) {
+  fill(X, Y, m, n, matrix, F, store, tile, num_threads, true);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*
+ * File:  wavefront.h
+ * Author: Stefano Ribes
+ */
+#ifndef WAVEFRONT_H_
+#define WAVEFRONT_H_
+
+#include "alignment.h"
+#include "scoring.h"
+#include "trace_store.h"
+
+#define WAVEFRONT_TILE 256 // Side of the square tiles, in cells
+
+/**
+ * @brief      Fills the global alignment traceback of global_alignment.c. The
+ *             matrix is split in tiles, which are processed in parallel along
+ *             the anti-diagonals: a tile only waits for its upper and left
+ *             neighbours. Only the scores on the tile boundaries are kept,
+ *             unless the full score matrix is requested. The result is
+ *             bit-identical to the serial row-by-row fill.
+ *
+ * @param[in]  X            The X input sequence
+ * @param[in]  Y            The Y input sequence
+ * @param[in]  m            The length of the X sequence
+ * @param[in]  n            The length of the Y sequence
+ * @param[in]  matrix       The substitution matrix
+ * @param      F            The (m+1)x(n+1) score matrix, can be NULL
+ * @param      store        The (m+1)x(n+1) packed traceback, with row 0 and
+ *                          column 0 set to STOP
+ * @param[in]  tile         The tile side, in cells (rounded up to even)
+ * @param[in]  num_threads  The number of threads
+ *
+ * @return     The alignment score, i.e. the score of cell (m, n).
+ */
+int wavefront_fill_global(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, int* F, trace_store_t* store,
+    const int tile, const int num_threads);
+
+/**
+ * @brief      Fills the local alignment traceback of local_alignment.c, by
+ *             tiles as in wavefront_fill_global(). The cells whose score is
+ *             clamped to zero have no tie flags, i.e. they are STOP cells.
+ *
+ * @param[in]  X            The X input sequence
+ * @param[in]  Y            The Y input sequence
+ * @param[in]  m            The length of the X sequence
+ * @param[in]  n            The length of the Y sequence
+ * @param[in]  matrix       The substitution matrix
+ * @param      F            The (m+1)x(n+1) score matrix, can be NULL
+ * @param      store        The (m+1)x(n+1) packed traceback, with row 0 and
+ *                          column 0 set to STOP
+ * @param[in]  tile         The tile side, in cells (rounded up to even)
+ * @param[in]  num_threads  The number of threads
+ */
+void wavefront_fill_local(const char* X, const char* Y, const int m,
+    const int n, const matrix_t matrix, int* F, trace_store_t* store,
+    const int tile, const int num_threads);
+
+#endif // end WAVEFRONT_H_
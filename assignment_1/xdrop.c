@@ -0,0 +1,234 @@
+/*
+ * File:  xdrop.c
+ * Author: Stefano Ribes
+ *
+ * X-drop extension. As in the reverse pass of the local alignment, each row
+ * keeps the live range [lo, hi] of its cells: a cell is only reachable from
+ * live cells, so the fill of a row starts at the first live cell of the
+ * previous one and stops one column past its last live cell, unless the left
+ * neighbour is still live.
+ */
+#include "xdrop.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MINUS_INF (INT_MIN / 4) // Dropped cells
+
+/*
+ * @brief      B sequence of an extension: bytes, or a packed view read from
+ *             symbol start.
+ */
+typedef struct {
+  const uint8_t* codes;
+  const seq_view_t* view;
+  size_t start;
+} target_t;
+
+static ALWAYS_INLINE uint8_t target_code(const target_t* B, const long t,
+    const int bits) {
+  const size_t i = B->start + t;
+  switch (bits) {
+    case 2:
+      return (B->view->words[i >> 5] >> ((i & 31) * 2)) & 3;
+    case 5:
+      return (B->view->words[i / 12] >> ((i % 12) * 5)) & 31;
+    default:
+      return B->codes[t];
+  }
+}
+
+/*
+ * The direction, packing (zero for bytes, otherwise the bits per symbol) and
+ * matrix parameters are compile-time constants at every call site, so the
+ * compiler emits a specialised loop for each combination.
+ */
+static ALWAYS_INLINE xdrop_result_t extend(const uint8_t* A, const int la,
+    const target_t* B, const int lb, const int xdrop, const int zdrop,
+    int* prev, int* curr, const int dir, const int bits,
+    const matrix_t matrix) {
+  xdrop_result_t best = {0, 0, 0};
+  // Row 0: the live cells are a prefix of the row.
+  int prev_lo = 0;
+  int prev_hi = -1;
+  for (int c = 0; c <= lb && -GAP_PENALTY * c >= -xdrop; ++c) {
+    prev[c] = -GAP_PENALTY * c;
+    prev_hi = c;
+  }
+  for (int r = 1; r <= la && prev_hi >= 0; ++r) {
+    const uint8_t a = A[dir * (r - 1)];
+    int lo = -1;
+    int hi = -1;
+    int left = MINUS_INF;
+    int row_max = MINUS_INF;
+    int row_max_c = 0;
+    for (int c = prev_lo; c <= lb; ++c) {
+      if (c > prev_hi + 1 && left == MINUS_INF) {
+        break; // Only reachable from dropped cells
+      }
+      const int diag = c > prev_lo && c - 1 <= prev_hi ?
+        prev[c-1] + substitution_score(matrix, a,
+          target_code(B, (long)dir * (c - 1), bits)) :
+        MINUS_INF;
+      const int up = c <= prev_hi ? prev[c] - GAP_PENALTY : MINUS_INF;
+      int v = up > diag ? up : diag;
+      v = left - GAP_PENALTY > v ? left - GAP_PENALTY : v;
+      if (v < best.score - xdrop) {
+        v = MINUS_INF;
+      } else {
+        lo = lo < 0 ? c : lo;
+        hi = c;
+        if (v > best.score) {
+          best.score = v;
+          best.length_a = r;
+          best.length_b = c;
+        }
+        if (v > row_max) {
+          row_max = v;
+          row_max_c = c;
+        }
+      }
+      curr[c] = v;
+      left = v;
+    }
+    if (zdrop > 0 && hi >= 0) {
+      const int kDelta = (r - best.length_a) - (row_max_c - best.length_b);
+      const int kGaps = kDelta < 0 ? -kDelta : kDelta;
+      if (row_max < best.score - zdrop - GAP_PENALTY * kGaps) {
+        break;
+      }
+    }
+    int* tmp = prev;
+    prev = curr;
+    curr = tmp;
+    prev_lo = lo;
+    prev_hi = hi;
+  }
+  return best;
+}
+
+/*
+ * Dispatches the extension to the loop specialised for its parameters.
+ */
+#define EXTEND(dir, bits) \
+  switch (matrix) { \
+    case MATRIX_DNA: \
+      result = extend(A, la, B, lb, xdrop, zdrop, prev, curr, dir, bits, \
+        MATRIX_DNA); \
+      break; \
+    case MATRIX_BLOSUM62: \
+      result = extend(A, la, B, lb, xdrop, zdrop, prev, curr, dir, bits, \
+        MATRIX_BLOSUM62); \
+      break; \
+    case MATRIX_PAM250: \
+      result = extend(A, la, B, lb, xdrop, zdrop, prev, curr, dir, bits, \
+        MATRIX_PAM250); \
+      break; \
+    default: \
+      result = extend(A, la, B, lb, xdrop, zdrop, prev, curr, dir, bits, \
+        MATRIX_IDENTITY); \
+  }
+
+/**
+ * @brief      Decodes the window of a packed DNA sequence read by an
+ *             extension, if it overlaps an ambiguous run: the packed symbols
+ *             read as A, so the run is restored to the code of N.
+ *
+ * @param[in]  view   The packed sequence
+ * @param[in]  start  The first symbol of the extension
+ * @param[in]  lb     The number of symbols of the window
+ * @param[in]  dir    The direction, +1 (forward) or -1 (backward)
+ *
+ * @return     The window, by increasing index, or NULL if it holds no
+ *             ambiguous symbol. To be freed by the caller.
+ */
+static uint8_t* decode_ambiguous(const seq_view_t* view, const size_t start,
+    const int lb, const int dir) {
+  const size_t kFirst = dir > 0 ? start : start + 1 - lb;
+  const size_t kEnd = kFirst + lb;
+  size_t r = seq_view_next_amb(view, kFirst);
+  if (r == view->num_amb || view->amb[r].start >= kEnd) {
+    return NULL;
+  }
+  uint8_t* window = malloc(lb);
+  if (window == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the extension window\n");
+    exit(1);
+  }
+  for (int t = 0; t < lb; ++t) {
+    window[t] = seq_view_code(view, kFirst + t);
+  }
+  const uint8_t kN = matrix_num_codes(MATRIX_DNA) - 1;
+  for (; r < view->num_amb && view->amb[r].start < kEnd; ++r) {
+    const size_t kRunStart = view->amb[r].start > kFirst ?
+      view->amb[r].start : kFirst;
+    const size_t kRunEnd = view->amb[r].start + view->amb[r].length < kEnd ?
+      view->amb[r].start + view->amb[r].length : kEnd;
+    memset(window + (kRunStart - kFirst), kN, kRunEnd - kRunStart);
+  }
+  return window;
+}
+
+static xdrop_result_t run_extend(const uint8_t* A, const int la,
+    const target_t* B, int lb, const int dir, const matrix_t matrix,
+    const int xdrop, const int zdrop) {
+  /*
+   * Column c of row r scores at most max_score * r - GAP_PENALTY * (c - r),
+   * so no live cell lies past the columns below
+   */
+  const long kMaxColumns = la + ((long)matrix_max_score(matrix) * la + xdrop) /
+    GAP_PENALTY + 1;
+  lb = lb < kMaxColumns ? lb : (int)kMaxColumns;
+  int* prev = malloc(sizeof(int) * (lb + 1));
+  int* curr = malloc(sizeof(int) * (lb + 1));
+  if (prev == NULL || curr == NULL) {
+    fprintf(stderr, "ERROR. Unable to allocate the extension rows\n");
+    exit(1);
+  }
+  xdrop_result_t result;
+  int bits = B->view != NULL ? B->view->bits : 0;
+  uint8_t* window = NULL;
+  target_t decoded = {NULL, NULL, 0};
+  // The ambiguous symbols of a DNA view read as A: bytes hold their code.
+  if (bits == 2 && lb > 0) {
+    window = decode_ambiguous(B->view, B->start, lb, dir);
+    if (window != NULL) {
+      decoded.codes = dir > 0 ? window : window + lb - 1;
+      B = &decoded;
+      bits = 0;
+    }
+  }
+  if (bits == 2 && dir > 0) {
+    EXTEND(1, 2);
+  } else if (bits == 2) {
+    EXTEND(-1, 2);
+  } else if (bits == 5 && dir > 0) {
+    EXTEND(1, 5);
+  } else if (bits == 5) {
+    EXTEND(-1, 5);
+  } else if (dir > 0) {
+    EXTEND(1, 0);
+  } else {
+    EXTEND(-1, 0);
+  }
+  free(prev);
+  free(curr);
+  free(window);
+  return result;
+}
+
+xdrop_result_t xdrop_extend(const uint8_t* A, const int la, const uint8_t* B,
+    const int lb, const int dir, const matrix_t matrix, const int xdrop,
+    const int zdrop) {
+  const target_t kTarget = {B, NULL, 0};
+  return run_extend(A, la, &kTarget, lb, dir, matrix, xdrop, zdrop);
+}
+
+xdrop_result_t xdrop_extend_view(const uint8_t* A, const int la,
+    const seq_view_t* B, const size_t start, const int lb, const int dir,
+    const matrix_t matrix, const int xdrop, const int zdrop) {
+  const target_t kTarget = {NULL, B, start};
+  return run_extend(A, la, &kTarget, lb, dir, matrix, xdrop, zdrop);
+}
@@ -0,0 +1,70 @@
+/*
+ * File:  xdrop.h
+ * Author: Stefano Ribes
+ */
+#ifndef XDROP_H_
+#define XDROP_H_
+
+#include "alignment.h"
+#include "scoring.h"
+#include "seq_store.h"
+
+#include <stdint.h>
+
+/*
+ * @brief      Result of an X-drop extension.
+ */
+typedef struct {
+  int score; // Best score of the extension, zero if it is empty
+  int length_a; // Symbols of A covered by the best extension
+  int length_b; // Symbols of B covered by the best extension
+} xdrop_result_t;
+
+/**
+ * @brief      Extends an alignment from an anchor, e.g. the end of a seed, in
+ *             one direction. The recurrence is the one of the local alignment,
+ *             without the zero floor: cell (r, c) holds the best score of the
+ *             alignments of the first r symbols of A with the first c symbols
+ *             of B. Only a live range of each row is filled: a cell is dropped
+ *             when its score is more than xdrop below the best one.
+ *
+ *             With zdrop > 0, the extension also stops as soon as the best
+ *             score of a row, once the gaps between its cell and the best one
+ *             are paid back, falls more than zdrop below the best score.
+ *
+ * @param[in]  A       The encoded A sequence, symbol t is A[dir * t]
+ * @param[in]  la      The number of symbols of A that can be extended into
+ * @param[in]  B       The encoded B sequence, symbol t is B[dir * t]
+ * @param[in]  lb      The number of symbols of B that can be extended into
+ * @param[in]  dir     The direction, +1 (forward) or -1 (backward)
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  xdrop   The X-drop threshold
+ * @param[in]  zdrop   The Z-drop threshold, none if not positive
+ *
+ * @return     The best score and the lengths of the extension reaching it.
+ */
+xdrop_result_t xdrop_extend(const uint8_t* A, const int la, const uint8_t* B,
+    const int lb, const int dir, const matrix_t matrix, const int xdrop,
+    const int zdrop);
+
+/**
+ * @brief      Same as xdrop_extend(), reading the B sequence from its packed
+ *             form: symbol t is the one at start + dir * t of the view.
+ *
+ * @param[in]  A       The encoded A sequence, symbol t is A[dir * t]
+ * @param[in]  la      The number of symbols of A that can be extended into
+ * @param[in]  B       The packed B sequence
+ * @param[in]  start   The first symbol of B
+ * @param[in]  lb      The number of symbols of B that can be extended into
+ * @param[in]  dir     The direction, +1 (forward) or -1 (backward)
+ * @param[in]  matrix  The substitution matrix
+ * @param[in]  xdrop   The X-drop threshold
+ * @param[in]  zdrop   The Z-drop threshold, none if not positive
+ *
+ * @return     The best score and the lengths of the extension reaching it.
+ */
+xdrop_result_t xdrop_extend_view(const uint8_t* A, const int la,
+    const seq_view_t* B, const size_t start, const int lb, const int dir,
+    const matrix_t matrix, const int xdrop, const int zdrop);
+
+#endif // end XDROP_H_
@@ -11,15 +11,10 @@
 #include <stdlib.h>
 #include <string.h>
 
-void atom_callback(const PdbEntry* entry, int* line_idx, void* user_data) {
+void atom_callback(const PdbRecord* record, int* line_idx, void* user_data) {
   // printf("I'm atom_callback!\n");
   Atom* atoms = (Atom*)user_data;
-  int serial = atoi(entry->s_serial);
-  int resSeq = atoi(entry->s_resSeq);
   int i = *(line_idx);
-  double x = atof(entry->s_x);
-  double y = atof(entry->s_y);
-  double z = atof(entry->s_z);
   /*
    * Copy values to the next element in the atom array.
    */
@@ -28,21 +23,19 @@ void atom_callback(const PdbEntry* entry, int* line_idx, void* user_data) {
     exit(0);
   }
   /*
-   * Convert the numeric fields to integers or doubles.
-   * The library functions atoi() and atof() are
-   * described in the UNIX manual pages ('man atoi' and
-   * 'man atof').
+   * The fields are slices of the mapped PDB file, see scan_records(): the
+   * numeric ones are converted by pdb_field_int() and pdb_field_double().
    */
-  atoms[i].serial = serial;
-  strcpy(atoms[i].atomName, entry->s_name);
-  strcpy(atoms[i].altLoc, entry->s_altLoc);
-  strcpy(atoms[i].resName, entry->s_resName);
-  strcpy(atoms[i].chainID, entry->s_chainID);
-  atoms[i].resSeq = resSeq;
-  strcpy(atoms[i].iCode, entry->s_iCode);
-  atoms[i].centre.x = x;
-  atoms[i].centre.y = y;
-  atoms[i].centre.z = z;
+  atoms[i].serial = pdb_field_int(record->serial);
+  pdb_field_copy(record->name, atoms[i].atomName);
+  pdb_field_copy(record->altLoc, atoms[i].altLoc);
+  pdb_field_copy(record->resName, atoms[i].resName);
+  pdb_field_copy(record->chainID, atoms[i].chainID);
+  atoms[i].resSeq = pdb_field_int(record->resSeq);
+  pdb_field_copy(record->iCode, atoms[i].iCode);
+  atoms[i].centre.x = pdb_field_double(record->x);
+  atoms[i].centre.y = pdb_field_double(record->y);
+  atoms[i].centre.z = pdb_field_double(record->z);
   (*(line_idx))++;
 }
 
@@ -58,7 +51,7 @@ int main(int argc, char **argv) {
    * Declare an array to hold data read from the ATOM records of a PDB file.
    */
   Atom atoms[MAX_ATOMS + 1];
-  numAtoms = read_data(argv[1], &atom_callback, (void*)atoms);
+  numAtoms = scan_records(argv[1], &atom_callback, (void*)atoms);
   for (i = 0; i < numAtoms; ++i) {
     print_pdb_atom (
       atoms[i].serial,
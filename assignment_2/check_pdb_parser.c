@@ -0,0 +1,149 @@
+/*
+ * File:  check_pdb_parser.c
+ * Purpose:  Check that the PDB field parsers match the C library exactly.
+ * Author: Stefano Ribes
+ *
+ * To compile this C program, type:
+ *
+ *   make check_pdb_parser.exe
+ *
+ * To run the program, type:
+ *
+ *   ./check_pdb_parser.exe [file.pdb ...]
+ *
+ * The program checks, bit for bit, that pdb_field_double() returns what atof()
+ * returns, pdb_field_float() what strtof() returns and pdb_field_int() what
+ * atoi() returns. The real fields cover the whole %8.3f range of the PDB
+ * coordinates, from -999.999 to 9999.999, then the values with fewer decimals
+ * and a few fields out of that format; pdb_field_milli() must also give the
+ * exact number of thousandths of the %8.3f fields. The integer fields cover
+ * the range of the serial and resSeq columns. Finally, the ATOM records of the
+ * given PDB files are checked. The exit status is non-zero on any mismatch.
+ */
+#include "pdb_handler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_REPORTED 10 // Mismatches printed in full
+#define NO_MILLI INT64_MIN // The thousandths of a field are not checked
+
+typedef struct {
+  long num_checks;
+  long num_mismatches;
+} Counters;
+
+/**
+ * @brief      Counts a mismatch and prints the first ones.
+ */
+static void report(Counters* counters, const char* kind, const char* s) {
+  if (counters->num_mismatches++ < MAX_REPORTED) {
+    printf("MISMATCH %s '%s'\n", kind, s);
+  }
+}
+
+/**
+ * @brief      Checks a real field against atof() and strtof().
+ *
+ * @param      counters  The counters
+ * @param[in]  s         The field, NUL-terminated
+ * @param[in]  milli     The expected thousandths, NO_MILLI if not checked
+ */
+static void check_real(Counters* counters, const char* s, const int64_t milli) {
+  const PdbField kField = {s, (int)strlen(s)};
+  const double kDouble = pdb_field_double(kField);
+  const double kAtof = atof(s);
+  const float kFloat = pdb_field_float(kField);
+  const float kStrtof = strtof(s, NULL);
+  ++counters->num_checks;
+  if (memcmp(&kDouble, &kAtof, sizeof(double)) != 0) {
+    report(counters, "atof", s);
+  }
+  if (memcmp(&kFloat, &kStrtof, sizeof(float)) != 0) {
+    report(counters, "strtof", s);
+  }
+  if (milli != NO_MILLI && pdb_field_milli(kField) != milli) {
+    report(counters, "milli", s);
+  }
+}
+
+/**
+ * @brief      Checks an integer field against atoi().
+ */
+static void check_int(Counters* counters, const char* s) {
+  const PdbField kField = {s, (int)strlen(s)};
+  ++counters->num_checks;
+  if (pdb_field_int(kField) != atoi(s)) {
+    report(counters, "atoi", s);
+  }
+}
+
+/**
+ * @brief      Callback of scan_records(), checking the numeric fields of an
+ *             ATOM record.
+ */
+static void record_callback(const PdbRecord* record, int* line_idx,
+    void* user_data) {
+  Counters* counters = (Counters*)user_data;
+  const PdbField kReals[3] = {record->x, record->y, record->z};
+  const PdbField kInts[2] = {record->serial, record->resSeq};
+  char s[LINE_LENGTH];
+  for (int k = 0; k < 3; ++k) {
+    pdb_field_copy(kReals[k], s);
+    check_real(counters, s, NO_MILLI);
+  }
+  for (int k = 0; k < 2; ++k) {
+    pdb_field_copy(kInts[k], s);
+    check_int(counters, s);
+  }
+  (*line_idx)++;
+}
+
+int main(int argc, char **argv) {
+  Counters counters = {0, 0};
+  char s[32];
+  /*
+   * The %8.3f coordinates, then the ones with fewer decimals
+   */
+  for (long v = -999999; v <= 9999999; ++v) {
+    snprintf(s, sizeof(s), "%8.3f", v / 1000.0);
+    check_real(&counters, s, v);
+  }
+  for (long v = -99999; v <= 999999; ++v) {
+    snprintf(s, sizeof(s), "%.2f", v / 100.0);
+    check_real(&counters, s, v * 10);
+    snprintf(s, sizeof(s), "%.1f", v / 10.0);
+    check_real(&counters, s, v * 100);
+  }
+  /*
+   * Fields out of the fixed format fall back to the C library
+   */
+  const char* kOddFields[] = {"-0.000", "  -0.000", "", "   ", "1.2345",
+    "1e3", "+3.5", ".5", "-.5", "5.", "1.5 ", "12345678", "-1234567", "abc",
+    "-", "9999999.9", "99999999999.5", "-4294967296.1", "1.00000000001"};
+  for (size_t k = 0; k < sizeof(kOddFields) / sizeof(kOddFields[0]); ++k) {
+    check_real(&counters, kOddFields[k], NO_MILLI);
+  }
+  /*
+   * The serial (5 columns) and resSeq (4 columns) fields
+   */
+  for (long v = -9999; v <= 99999; ++v) {
+    snprintf(s, sizeof(s), "%5ld", v);
+    check_int(&counters, s);
+  }
+  for (long v = -999; v <= 9999; ++v) {
+    snprintf(s, sizeof(s), "%4ld", v);
+    check_int(&counters, s);
+  }
+  printf("[INFO] Checked %ld fields\n", counters.num_checks);
+  for (int arg = 1; arg < argc; ++arg) {
+    const long kNumChecks = counters.num_checks;
+    const int kNumAtoms = scan_records(argv[arg], &record_callback,
+      &counters);
+    printf("[INFO] Checked %ld fields of %d atoms of %s\n",
+      counters.num_checks - kNumChecks, kNumAtoms, argv[arg]);
+  }
+  printf("[INFO] Number of mismatches: %ld\n", counters.num_mismatches);
+  return counters.num_mismatches != 0;
+}
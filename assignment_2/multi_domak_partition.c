@@ -22,7 +22,7 @@ typedef struct {
   char previousICode[2];
 } user_data_t;
 
-void residue_callback(const PdbEntry* entry, int* line_idx, void* data);
+void residue_callback(const PdbRecord* record, int* line_idx, void* data);
 
 int main(int argc, char** argv) {
   if (argc < 2) {
@@ -41,7 +41,7 @@ int main(int argc, char** argv) {
   data.previousSeq = 0;
   strcpy(data.previousID, "");
   strcpy(data.previousICode, "");
-  num_residues = read_data(argv[1], &residue_callback, (void*)&data);
+  num_residues = scan_records(argv[1], &residue_callback, (void*)&data);
   for (int i = 1; i <= num_residues; ++i) {
     if (!residues[i].numAtoms) {
       fprintf(stderr, "ERROR. Residue n.%d doesn't contain any heavy atom (CA). Exiting.\n", i);
@@ -97,7 +97,7 @@ int main(int argc, char** argv) {
   return 0;
 }
 
-void residue_callback(const PdbEntry* entry, int* line_idx, void* data) {
+void residue_callback(const PdbRecord* record, int* line_idx, void* data) {
   // printf("I'm residue_callback!\n");
   int i = *line_idx;
   user_data_t* d = (user_data_t*)data;
@@ -105,16 +105,19 @@ void residue_callback(const PdbEntry* entry, int* line_idx, void* data) {
   char* previousID = d->previousID;
   char* previousICode = d->previousICode;
   /*
-   * Copy values to the next element in the array.
+   * Copy values to the next element in the array. The fields are slices of
+   * the mapped PDB file: only the ones read below are copied or converted.
    */
-  int serial = atoi(entry->s_serial);
-  int resSeq = atoi(entry->s_resSeq);
-  double x = atof(entry->s_x);
-  double y = atof(entry->s_y);
-  double z = atof(entry->s_z);
+  char name[5];
+  char chainID[2];
+  char iCode[2];
+  pdb_field_copy(record->name, name);
+  pdb_field_copy(record->chainID, chainID);
+  pdb_field_copy(record->iCode, iCode);
+  const int resSeq = pdb_field_int(record->resSeq);
    const bool kNewSequence = resSeq != d->previousSeq;
-  const bool kNewChanID = strcmp(entry->s_chainID, previousID) != 0;
-  const bool kNewICode = strcmp(entry->s_iCode, previousICode) != 0;
+  const bool kNewChanID = strcmp(chainID, previousID) != 0;
+  const bool kNewICode = strcmp(iCode, previousICode) != 0;
   if (kNewSequence || kNewChanID || kNewICode) {
     if (i > MAX_RESIDUES) {
       fprintf(stderr, "Too many residues\n");
@@ -123,29 +126,29 @@ void residue_callback(const PdbEntry* entry, int* line_idx, void* data) {
     ++(*(line_idx));
     ++i;
     d->previousSeq = resSeq;
-    strcpy(previousID, entry->s_chainID);
-    strcpy(previousICode, entry->s_iCode);
+    strcpy(previousID, chainID);
+    strcpy(previousICode, iCode);
     residues[i].numAtoms = 0;
-    strcpy(residues[i].resName, entry->s_resName);
-    strcpy(residues[i].chainID, entry->s_chainID);
+    pdb_field_copy(record->resName, residues[i].resName);
+    strcpy(residues[i].chainID, chainID);
     residues[i].resSeq = resSeq;
-    strcpy(residues[i].iCode, entry->s_iCode);
+    strcpy(residues[i].iCode, iCode);
   }
   /*
    * Add "heavy" atoms only.
    */
-  if (is_heavy_atom(entry->s_name)) {
+  if (is_heavy_atom(name)) {
     ++(residues[i].numAtoms);
     if (residues[i].numAtoms > MAX_ATOMS_PER_RESIDUE) {
       fprintf(stderr, "ERROR. Too many atoms in residues %d. Exiting.\n", i);
       exit(0);
     }
     int j = residues[i].numAtoms;
-    residues[i].atom[j].serial = serial;
-    strcpy(residues[i].atom[j].atomName, entry->s_name);
-    strcpy(residues[i].atom[j].altLoc, entry->s_altLoc);
-    residues[i].atom[j].centre.x = x;
-    residues[i].atom[j].centre.y = y;
-    residues[i].atom[j].centre.z = z;
+    residues[i].atom[j].serial = pdb_field_int(record->serial);
+    strcpy(residues[i].atom[j].atomName, name);
+    pdb_field_copy(record->altLoc, residues[i].atom[j].altLoc);
+    residues[i].atom[j].centre.x = pdb_field_double(record->x);
+    residues[i].atom[j].centre.y = pdb_field_double(record->y);
+    residues[i].atom[j].centre.z = pdb_field_double(record->z);
   }
 }
\ No newline at end of file
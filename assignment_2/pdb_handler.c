@@ -2,39 +2,227 @@
  * File:  pdb_handler.c
  * Author: Stefano Ribes
  */
+#define _POSIX_C_SOURCE 200809L // For mmap()
+
 #include "pdb_handler.h"
 
-int read_data(const char *filename, const callback_ptr callback, void* user_data) {
-  FILE  *stream;
-  char line[LINE_LENGTH];
-  PdbEntry entry;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief      Gets the slice of columns [start, start + length) of a line,
+ *             clipped to the line.
+ */
+static inline PdbField get_field(const char* line, const int line_length,
+    const int start, const int length) {
+  PdbField field;
+  field.data = line + start;
+  field.length = start >= line_length ? 0 :
+    (start + length <= line_length ? length : line_length - start);
+  return field;
+}
+
+int scan_records(const char* filename, const record_callback_ptr callback,
+    void* user_data) {
   int i = 0;
-  if ((stream = fopen(filename, "r")) == NULL) {
+  const int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
     (void) fprintf(stderr, "Unable to open %s\n", filename);
     exit(0);
   }
-  while (fgets(line, LINE_LENGTH, stream)) {
-    if (strncmp(line, "ATOM  ", 6) == 0) {
+  const size_t kSize = st.st_size;
+  if (kSize == 0) {
+    close(fd);
+    return i;
+  }
+  const char* data = mmap(NULL, kSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    (void) fprintf(stderr, "Unable to map %s\n", filename);
+    exit(0);
+  }
+  posix_madvise((void*)data, kSize, POSIX_MADV_SEQUENTIAL);
+  const char* end = data + kSize;
+  PdbRecord record;
+  for (const char* line = data; line < end; ) {
+    const char* eol = memchr(line, '\n', end - line);
+    const char* kLineEnd = eol != NULL ? eol : end;
+    int length = kLineEnd - line;
+    if (length > 0 && line[length - 1] == '\r') {
+      --length;
+    }
+    if (length >= 6 && memcmp(line, "ATOM  ", 6) == 0) {
       /*
        * Split the line into its constituent fields.
        * We are only interested in columns 1-54.
        */
-      strncpy(entry.s_serial,  &line[6],  5); entry.s_serial[5] = '\0';
-      strncpy(entry.s_name,    &line[12], 4); entry.s_name[4] = '\0';
-      strncpy(entry.s_altLoc,  &line[16], 1); entry.s_altLoc[1] = '\0';
-      strncpy(entry.s_resName, &line[17], 3); entry.s_resName[3] = '\0';
-      strncpy(entry.s_chainID, &line[21], 1); entry.s_chainID[1] = '\0';
-      strncpy(entry.s_resSeq,  &line[22], 4); entry.s_resSeq[4] = '\0';
-      strncpy(entry.s_iCode,   &line[26], 1); entry.s_iCode[1] = '\0';
-      strncpy(entry.s_x,       &line[30], 8); entry.s_x[8] = '\0';
-      strncpy(entry.s_y,       &line[38], 8); entry.s_y[8] = '\0';
-      strncpy(entry.s_z,       &line[46], 8); entry.s_z[8] = '\0';
-      /*
-       * Call given callback function on each entry: each program will have its
-       * own definition.
-       */
-      callback(&entry, &i, user_data);
+      record.serial  = get_field(line, length, 6,  5);
+      record.name    = get_field(line, length, 12, 4);
+      record.altLoc  = get_field(line, length, 16, 1);
+      record.resName = get_field(line, length, 17, 3);
+      record.chainID = get_field(line, length, 21, 1);
+      record.resSeq  = get_field(line, length, 22, 4);
+      record.iCode   = get_field(line, length, 26, 1);
+      record.x       = get_field(line, length, 30, 8);
+      record.y       = get_field(line, length, 38, 8);
+      record.z       = get_field(line, length, 46, 8);
+      callback(&record, &i, user_data);
     }
+    line = kLineEnd + 1;
   }
+  munmap((void*)data, kSize);
   return i;
+}
+
+int pdb_field_int(const PdbField field) {
+  const char* p = field.data;
+  const char* end = field.data + field.length;
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    ++p;
+  }
+  const int kSign = p < end && *p == '-' ? -1 : 1;
+  if (p < end && (*p == '-' || *p == '+')) {
+    ++p;
+  }
+  int value = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p - '0');
+    ++p;
+  }
+  return kSign * value;
+}
+
+/**
+ * @brief      Parses a real field with at most three decimals, the %8.3f of
+ *             the PDB coordinates, as an integer number of thousandths: the
+ *             digits are accumulated, skipping the point, and the value is
+ *             scaled by the missing decimals. The field is rejected as soon
+ *             as it has too many digits, so the value never overflows.
+ *
+ * @param[in]  field     The field
+ * @param      milli     The absolute value, in thousandths
+ * @param      negative  Whether the value has a minus sign
+ *
+ * @return     One if the field has that format, zero otherwise (more decimals,
+ *             an exponent, more than six integer digits, trailing characters
+ *             or no digits at all).
+ */
+static inline int parse_milli(const PdbField field, int32_t* milli,
+    int* negative) {
+  const char* p = field.data;
+  const char* end = field.data + field.length;
+  while (p < end && *p == ' ') {
+    ++p;
+  }
+  *negative = p < end && *p == '-';
+  p += p < end && (*p == '-' || *p == '+');
+  int32_t value = 0;
+  int num_digits = 0;
+  for (; p < end && (unsigned)(*p - '0') < 10; ++p) {
+    if (++num_digits > 6) {
+      return 0;
+    }
+    value = value * 10 + (*p - '0');
+  }
+  int num_decimals = 0;
+  if (p < end && *p == '.') {
+    for (++p; p < end && (unsigned)(*p - '0') < 10; ++p) {
+      if (++num_decimals > 3) {
+        return 0;
+      }
+      value = value * 10 + (*p - '0');
+    }
+  }
+  static const int32_t kScale[4] = {1000, 100, 10, 1};
+  if (p != end || num_digits + num_decimals == 0) {
+    return 0;
+  }
+  *milli = value * kScale[num_decimals];
+  return 1;
+}
+
+int32_t pdb_field_milli(const PdbField field) {
+  int32_t milli;
+  int negative;
+  if (parse_milli(field, &milli, &negative)) {
+    return negative ? -milli : milli;
+  }
+  const double kValue = pdb_field_double(field) * 1000.0;
+  return (int32_t)(kValue < 0 ? kValue - 0.5 : kValue + 0.5);
+}
+
+float pdb_field_float(const PdbField field) {
+  int32_t milli;
+  int negative;
+  /*
+   * The thousandths are exact in a float up to 2^24, so that a single
+   * (correctly rounded) division gives the float nearest to the field.
+   */
+  if (parse_milli(field, &milli, &negative) && milli <= (1 << 24)) {
+    const float kValue = milli / 1000.0f;
+    return negative ? -kValue : kValue;
+  }
+  char s[LINE_LENGTH];
+  pdb_field_copy(field, s);
+  return strtof(s, NULL);
+}
+
+double pdb_field_double(const PdbField field) {
+  int32_t milli;
+  int negative;
+  /*
+   * As above, the division gives the double nearest to the field, which is
+   * what atof() returns. The sign is applied last to keep "-0.000".
+   */
+  if (parse_milli(field, &milli, &negative)) {
+    const double kValue = milli / 1000.0;
+    return negative ? -kValue : kValue;
+  }
+  char s[LINE_LENGTH];
+  pdb_field_copy(field, s);
+  return atof(s);
+}
+
+void pdb_field_copy(const PdbField field, char* s) {
+  memcpy(s, field.data, field.length);
+  s[field.length] = '\0';
+}
+
+/*
+ * @brief      Callback of read_data() and its user data, for entry_callback().
+ */
+typedef struct {
+  callback_ptr callback;
+  void* user_data;
+} entry_adapter_t;
+
+/**
+ * @brief      Copies a record into a PdbEntry for a read_data() callback.
+ */
+static void entry_callback(const PdbRecord* record, int* i, void* data) {
+  const entry_adapter_t* adapter = (const entry_adapter_t*)data;
+  PdbEntry entry;
+  pdb_field_copy(record->serial,  entry.s_serial);
+  pdb_field_copy(record->name,    entry.s_name);
+  pdb_field_copy(record->altLoc,  entry.s_altLoc);
+  pdb_field_copy(record->resName, entry.s_resName);
+  pdb_field_copy(record->chainID, entry.s_chainID);
+  pdb_field_copy(record->resSeq,  entry.s_resSeq);
+  pdb_field_copy(record->iCode,   entry.s_iCode);
+  pdb_field_copy(record->x,       entry.s_x);
+  pdb_field_copy(record->y,       entry.s_y);
+  pdb_field_copy(record->z,       entry.s_z);
+  /*
+   * Call given callback function on each entry: each program will have its
+   * own definition.
+   */
+  adapter->callback(&entry, i, adapter->user_data);
+}
+
+int read_data(const char *filename, const callback_ptr callback, void* user_data) {
+  entry_adapter_t adapter = {callback, user_data};
+  return scan_records(filename, &entry_callback, &adapter);
 }
\ No newline at end of file
@@ -18,7 +18,7 @@ typedef struct {
   char previousICode[2];
 } user_data_t;
 
-void residue_callback(const PdbEntry* entry, int* line_idx, void* data) {
+void residue_callback(const PdbRecord* record, int* line_idx, void* data) {
   // printf("I'm residue_callback!\n");
   int i = *line_idx;
   user_data_t* d = (user_data_t*)data;
@@ -26,16 +26,20 @@ void residue_callback(const PdbEntry* entry, int* line_idx, void* data) {
   char* previousID = d->previousID;
   char* previousICode = d->previousICode;
 
-  int serial = atoi(entry->s_serial);
-  int resSeq = atoi(entry->s_resSeq);
-  double x = atof(entry->s_x);
-  double y = atof(entry->s_y);
-  double z = atof(entry->s_z);
+  /*
+   * The fields are slices of the mapped PDB file: only the ones read below
+   * are copied or converted.
+   */
+  char chainID[2];
+  char iCode[2];
+  pdb_field_copy(record->chainID, chainID);
+  pdb_field_copy(record->iCode, iCode);
+  const int resSeq = pdb_field_int(record->resSeq);
   /*
    * Copy values to the next element in the array.
    */
-  if (resSeq != d->previousSeq || strcmp(entry->s_chainID, previousID) != 0 ||
-       strcmp(entry->s_iCode, previousICode) != 0) {
+  if (resSeq != d->previousSeq || strcmp(chainID, previousID) != 0 ||
+       strcmp(iCode, previousICode) != 0) {
     if (i > MAX_RESIDUES) {
       (void) fprintf(stderr, "Too many residues\n");
       exit(0);
@@ -43,25 +47,25 @@ void residue_callback(const PdbEntry* entry, int* line_idx, void* data) {
     (*(line_idx))++;
     ++i;
     d->previousSeq = resSeq;
-    strcpy(previousID, entry->s_chainID);
-    strcpy(previousICode, entry->s_iCode);
+    strcpy(previousID, chainID);
+    strcpy(previousICode, iCode);
     residues[i].numAtoms = 0;
-    strcpy(residues[i].resName, entry->s_resName);
-    strcpy(residues[i].chainID, entry->s_chainID);
+    pdb_field_copy(record->resName, residues[i].resName);
+    strcpy(residues[i].chainID, chainID);
     residues[i].resSeq = resSeq;
-    strcpy(residues[i].iCode, entry->s_iCode);
+    strcpy(residues[i].iCode, iCode);
   }
   if (++(residues[i].numAtoms) > MAX_ATOMS_PER_RESIDUE) {
     (void) fprintf(stderr, "Too many atoms in residues %d\n", i);
     exit(0);
   }
   int j = residues[i].numAtoms;
-  residues[i].atom[j].serial = serial;
-  strcpy(residues[i].atom[j].atomName, entry->s_name);
-  strcpy(residues[i].atom[j].altLoc, entry->s_altLoc);
-  residues[i].atom[j].centre.x = x;
-  residues[i].atom[j].centre.y = y;
-  residues[i].atom[j].centre.z = z;
+  residues[i].atom[j].serial = pdb_field_int(record->serial);
+  pdb_field_copy(record->name, residues[i].atom[j].atomName);
+  pdb_field_copy(record->altLoc, residues[i].atom[j].altLoc);
+  residues[i].atom[j].centre.x = pdb_field_double(record->x);
+  residues[i].atom[j].centre.y = pdb_field_double(record->y);
+  residues[i].atom[j].centre.z = pdb_field_double(record->z);
   d->j = j;
 }
 
@@ -79,7 +83,7 @@ int main(int argc, char **argv) {
   data.previousSeq = 0;
   strcpy(data.previousID, "");
   strcpy(data.previousICode, "");
-  numResidues = read_data(argv[1], &residue_callback, (void*)&data);
+  numResidues = scan_records(argv[1], &residue_callback, (void*)&data);
   for (i = 1; i <= numResidues; ++i) {
     for (j = 1; j <= residues[i].numAtoms; ++j) {
       print_pdb_atom (
@@ -3,9 +3,11 @@
  * Author: Stefano Ribes
  */
 #include "atom.h"
+#include "cpu_dispatch.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <immintrin.h>
 
 double get_distance(const Point a, const Point b) {
   const Point diff = {a.x - b.x, a.y - b.y, a.z - b.z};
@@ -16,6 +18,122 @@ double get_atoms_distance(const Atom a, const Atom b) {
   return get_distance(a.centre, b.centre);
 }
 
+/*
+ * The vector variants compute the distances with the same operations, in the
+ * same order, of get_distance(), so that all of them find the same points.
+ * Each one handles the points left over by its last full vector with the
+ * scalar kernel.
+ */
+static int find_close_scalar(const Point centre, const double* xs,
+    const double* ys, const double* zs, const int start, const int num_points,
+    const double cutoff, int* indices, int num_found) {
+  for (int k = start; k < num_points; ++k) {
+    const Point p = {xs[k], ys[k], zs[k]};
+    if (get_distance(centre, p) < cutoff) {
+      indices[num_found++] = k;
+    }
+  }
+  return num_found;
+}
+
+__attribute__((target("sse4.1")))
+static int find_close_sse41(const Point centre, const double* xs,
+    const double* ys, const double* zs, const int num_points,
+    const double cutoff, int* indices) {
+  const __m128d kX = _mm_set1_pd(centre.x);
+  const __m128d kY = _mm_set1_pd(centre.y);
+  const __m128d kZ = _mm_set1_pd(centre.z);
+  const __m128d kCutoff = _mm_set1_pd(cutoff);
+  int num_found = 0;
+  int k = 0;
+  for (; k + 2 <= num_points; k += 2) {
+    const __m128d dx = _mm_sub_pd(kX, _mm_loadu_pd(xs + k));
+    const __m128d dy = _mm_sub_pd(kY, _mm_loadu_pd(ys + k));
+    const __m128d dz = _mm_sub_pd(kZ, _mm_loadu_pd(zs + k));
+    const __m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx),
+      _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+    int mask = _mm_movemask_pd(_mm_cmplt_pd(_mm_sqrt_pd(d2), kCutoff));
+    while (mask) {
+      indices[num_found++] = k + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return find_close_scalar(centre, xs, ys, zs, k, num_points, cutoff, indices,
+    num_found);
+}
+
+__attribute__((target("avx2")))
+static int find_close_avx2(const Point centre, const double* xs,
+    const double* ys, const double* zs, const int num_points,
+    const double cutoff, int* indices) {
+  const __m256d kX = _mm256_set1_pd(centre.x);
+  const __m256d kY = _mm256_set1_pd(centre.y);
+  const __m256d kZ = _mm256_set1_pd(centre.z);
+  const __m256d kCutoff = _mm256_set1_pd(cutoff);
+  int num_found = 0;
+  int k = 0;
+  for (; k + 4 <= num_points; k += 4) {
+    const __m256d dx = _mm256_sub_pd(kX, _mm256_loadu_pd(xs + k));
+    const __m256d dy = _mm256_sub_pd(kY, _mm256_loadu_pd(ys + k));
+    const __m256d dz = _mm256_sub_pd(kZ, _mm256_loadu_pd(zs + k));
+    const __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx),
+      _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+    int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_sqrt_pd(d2), kCutoff,
+      _CMP_LT_OQ));
+    while (mask) {
+      indices[num_found++] = k + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return find_close_scalar(centre, xs, ys, zs, k, num_points, cutoff, indices,
+    num_found);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int find_close_avx512bw(const Point centre, const double* xs,
+    const double* ys, const double* zs, const int num_points,
+    const double cutoff, int* indices) {
+  const __m512d kX = _mm512_set1_pd(centre.x);
+  const __m512d kY = _mm512_set1_pd(centre.y);
+  const __m512d kZ = _mm512_set1_pd(centre.z);
+  const __m512d kCutoff = _mm512_set1_pd(cutoff);
+  int num_found = 0;
+  int k = 0;
+  for (; k + 8 <= num_points; k += 8) {
+    const __m512d dx = _mm512_sub_pd(kX, _mm512_loadu_pd(xs + k));
+    const __m512d dy = _mm512_sub_pd(kY, _mm512_loadu_pd(ys + k));
+    const __m512d dz = _mm512_sub_pd(kZ, _mm512_loadu_pd(zs + k));
+    const __m512d d2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx),
+      _mm512_mul_pd(dy, dy)), _mm512_mul_pd(dz, dz));
+    unsigned mask = _mm512_cmp_pd_mask(_mm512_sqrt_pd(d2), kCutoff,
+      _CMP_LT_OQ);
+    while (mask) {
+      indices[num_found++] = k + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return find_close_scalar(centre, xs, ys, zs, k, num_points, cutoff, indices,
+    num_found);
+}
+
+int find_close_points(const Point centre, const double* xs, const double* ys,
+    const double* zs, const int num_points, const double cutoff,
+    int* indices) {
+  switch (cpu_isa()) {
+    case ISA_AVX512BW:
+      return find_close_avx512bw(centre, xs, ys, zs, num_points, cutoff,
+        indices);
+    case ISA_AVX2:
+      return find_close_avx2(centre, xs, ys, zs, num_points, cutoff, indices);
+    case ISA_SSE41:
+      return find_close_sse41(centre, xs, ys, zs, num_points, cutoff,
+        indices);
+    default:
+      return find_close_scalar(centre, xs, ys, zs, 0, num_points, cutoff,
+        indices, 0);
+  }
+}
+
 bool is_heavy_atom(const char* atom_name) {
   if (strcmp(atom_name, " CA ") == 0) {
     return true;
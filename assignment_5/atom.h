@@ -24,6 +24,26 @@ typedef struct {
 
 double get_distance(const Point a, const Point b);
 double get_atoms_distance(const Atom a, const Atom b);
+
+/**
+ * @brief      Finds the points closer than a cutoff to a centre, i.e. those
+ *             for which get_distance() is below the cutoff. The coordinates
+ *             are stored as three arrays. The kernel is built for each
+ *             instruction set, and the one of cpu_isa() is run.
+ *
+ * @param[in]  centre      The centre
+ * @param[in]  xs          The x coordinates of the points
+ * @param[in]  ys          The y coordinates of the points
+ * @param[in]  zs          The z coordinates of the points
+ * @param[in]  num_points  The number of points
+ * @param[in]  cutoff      The cutoff distance
+ * @param      indices     The indices of the close points, in increasing
+ *                         order, of at least num_points entries
+ *
+ * @return     The number of close points.
+ */
+int find_close_points(const Point centre, const double* xs, const double* ys,
+  const double* zs, const int num_points, const double cutoff, int* indices);
 bool is_heavy_atom(const char* atom_name);
 void print_pdb_atom (const int serial, const char* s_name, const char* s_altLoc,
   const char* s_resName, const char* s_chainID, const int resSeq,
@@ -5,8 +5,10 @@
 extern "C" {
 #include "pdb_handler.h"
 #include "atom.h"
+#include "cpu_dispatch.h"
 }
 
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <vector>
@@ -46,33 +48,45 @@ struct PointEqualsFunc {
  */
 class Protein {
 public:
-  typedef std::unordered_map<Point, std::vector<Atom>, PointHashFunc,
+  /**
+   * @brief      Atoms of a cube of the hash table, as indices in the protein,
+   *             next to their coordinates laid out for the distance kernel of
+   *             find_close_points().
+   */
+  struct Cube {
+    std::vector<int> ids;
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<double> zs;
+  };
+  typedef std::unordered_map<Point, Cube, PointHashFunc,
     PointEqualsFunc> HashTableType;
   static const int kAtomRadius = 2;
 
   /**
-   * @brief      Callback function to pass to read_data(), which is used for
-   *             reading PDB files. Populate a vector of atoms.
+   * @brief      Callback function to pass to scan_records(), which is used for
+   *             reading PDB files. Populate a vector of atoms, parsing the
+   *             fields straight from the mapped file.
    *
-   * @param[in]  entry      The read PDB entry
+   * @param[in]  record     The read PDB record
    * @param      line_idx   The line index of the PDB file
    * @param      user_data  The user data
    */
-  static void atom_callback(const PdbEntry* entry, int* line_idx,
+  static void atom_callback(const PdbRecord* record, int* line_idx,
       void* user_data) {
     std::vector<Atom>* atoms = static_cast<std::vector<Atom>*>(user_data);
     // Convert the numeric fields to integers or doubles.
     Atom a;
-    a.serial = atoi(entry->s_serial);
-    a.resSeq = atoi(entry->s_resSeq);
-    strcpy(a.atomName, entry->s_name);
-    strcpy(a.altLoc, entry->s_altLoc);
-    strcpy(a.resName, entry->s_resName);
-    strcpy(a.chainID, entry->s_chainID);
-    strcpy(a.iCode, entry->s_iCode);
-    a.centre.x = double(atof(entry->s_x));
-    a.centre.y = double(atof(entry->s_y));
-    a.centre.z = double(atof(entry->s_z));
+    a.serial = pdb_field_int(record->serial);
+    a.resSeq = pdb_field_int(record->resSeq);
+    pdb_field_copy(record->name, a.atomName);
+    pdb_field_copy(record->altLoc, a.altLoc);
+    pdb_field_copy(record->resName, a.resName);
+    pdb_field_copy(record->chainID, a.chainID);
+    pdb_field_copy(record->iCode, a.iCode);
+    a.centre.x = pdb_field_double(record->x);
+    a.centre.y = pdb_field_double(record->y);
+    a.centre.z = pdb_field_double(record->z);
     atoms->push_back(a);
     (*line_idx)++; // Advance to the next line in the PDB file.
   }
@@ -104,6 +118,58 @@ public:
     return cube;
   }
 
+  /**
+   * @brief      Compares an atom with the atoms of a cube, with the distance
+   *             kernel of find_close_points(), and records the clashing ones.
+   *
+   * @param[in]  a                The atom
+   * @param[in]  cube             The cube to compare with
+   * @param[in]  cutoff           The clash distance
+   * @param      indices          The buffer of the kernel, grown as needed
+   * @param      last_clash       The last clash of each atom, see
+   *                              RecordClashes()
+   * @param      num_clashes      The number of clashes
+   * @param      num_comparisons  The number of comparisons
+   */
+  static void FindClashes(const Atom& a, const Cube& cube,
+      const double cutoff, std::vector<int>& indices,
+      std::vector<int>& last_clash, int& num_clashes, int& num_comparisons) {
+    const int kNumAtoms = cube.ids.size();
+    if (indices.size() < cube.ids.size()) {
+      indices.resize(cube.ids.size());
+    }
+    const int kNumFound = find_close_points(a.centre, cube.xs.data(),
+      cube.ys.data(), cube.zs.data(), kNumAtoms, cutoff, indices.data());
+    num_comparisons += kNumAtoms;
+    for (int k = 0; k < kNumFound; ++k) {
+      last_clash[cube.ids[indices[k]]] = ++num_clashes;
+    }
+  }
+
+  /**
+   * @brief      Collects the clashing atoms by serial number. Several atoms
+   *             may share a serial number in large files: the last one
+   *             detected is kept.
+   *
+   * @param[in]  atoms       The atoms
+   * @param[in]  last_clash  The number of clashes detected up to the last one
+   *                         of each atom, zero if it does not clash
+   * @param      clashes     The clashing atoms, by serial number
+   */
+  static void RecordClashes(const std::vector<Atom>& atoms,
+      const std::vector<int>& last_clash, std::map<int, Atom>& clashes) {
+    std::vector<std::pair<int, int> > order; // (last clash, atom)
+    for (size_t k = 0; k < atoms.size(); ++k) {
+      if (last_clash[k] > 0) {
+        order.push_back(std::make_pair(last_clash[k], int(k)));
+      }
+    }
+    std::sort(order.begin(), order.end());
+    for (auto i = order.begin(); i != order.end(); ++i) {
+      clashes[atoms[i->second].serial] = atoms[i->second];
+    }
+  }
+
   /**
    * @brief      Detect and print out number of steric overlaps and number of
    *             atom-atom comparisons.
@@ -118,12 +184,15 @@ public:
     std::map<int, Atom> clashes;
     int num_clashes = 0;
     int num_comparisons = 0;
+    const auto b_atoms = b_protein.get_atoms();
+    std::vector<int> last_clash(b_atoms.size(), 0);
     if (use_hash) {
       const auto a_atoms = a_protein.get_atoms();
       Point min_coords = b_protein.get_min_coods();
       // Use protein B min dimensions to store the cubes in the hash tables.
       b_protein.MapAtomsToCubes(min_coords);
-      auto hashmap = b_protein.get_hash_table();
+      const HashTableType& hashmap = b_protein.get_hash_table();
+      std::vector<int> indices;
       // Loop over all atoms in Protein A.
       for (auto a = a_atoms.begin(); a != a_atoms.end(); ++a) {
         // Get the coordinates of the cube containing atom A.
@@ -138,19 +207,14 @@ public:
                 atom_coords.y + j,
                 atom_coords.z + k
               };
-              if (hashmap.find(coords) == hashmap.end()) {
+              const auto cube = hashmap.find(coords);
+              if (cube == hashmap.end()) {
                 // Cube coordinates of neighbouring atom of Protein A are not in
                 // the hashmap of Protein B. Continue.
                 continue;
               } else {
-                const auto b_atoms = hashmap[coords];
-                for (auto b = b_atoms.begin(); b != b_atoms.end(); ++b) {
-                  ++num_comparisons;
-                  if (get_atoms_distance(*a, *b) < kCubeSize) {
-                    ++num_clashes;
-                    clashes[b->serial] = *b;
-                  }
-                }
+                Protein::FindClashes(*a, cube->second, kCubeSize, indices,
+                  last_clash, num_clashes, num_comparisons);
               }
             }
           }
@@ -158,17 +222,25 @@ public:
       }
     } else {
       const auto a_atoms = a_protein.get_atoms();
-      const auto b_atoms = b_protein.get_atoms();
+      // The coordinates of protein B are laid out once for the kernel.
+      const int kNumAtoms = b_atoms.size();
+      std::vector<double> xs(kNumAtoms), ys(kNumAtoms), zs(kNumAtoms);
+      std::vector<int> indices(kNumAtoms);
+      for (int k = 0; k < kNumAtoms; ++k) {
+        xs[k] = b_atoms[k].centre.x;
+        ys[k] = b_atoms[k].centre.y;
+        zs[k] = b_atoms[k].centre.z;
+      }
       for (auto a = a_atoms.begin(); a != a_atoms.end(); ++a) {
-        for (auto b = b_atoms.begin(); b != b_atoms.end(); ++b) {
-          ++num_comparisons;
-          if (get_atoms_distance(*a, *b) < kCubeSize) {
-            ++num_clashes;
-            clashes[b->serial] = *b;
-          }
+        const int kNumFound = find_close_points(a->centre, xs.data(),
+          ys.data(), zs.data(), kNumAtoms, kCubeSize, indices.data());
+        num_comparisons += kNumAtoms;
+        for (int k = 0; k < kNumFound; ++k) {
+          last_clash[indices[k]] = ++num_clashes;
         }
       }
     }
+    Protein::RecordClashes(b_atoms, last_clash, clashes);
     for (auto i = clashes.begin(); i != clashes.end(); ++i) {
       const auto atom = i->second;
       std::cout << atom.serial << " " << atom.resName << " "
@@ -189,7 +261,7 @@ public:
   Protein(const char* pdb_file) {
     this->max_coords_ = {-1e308, -1e308, -1e308};
     this->min_coords_ = {1e308, 1e308, 1e308};
-    const int num_atoms = read_data(pdb_file, &this->atom_callback,
+    const int num_atoms = scan_records(pdb_file, &this->atom_callback,
       static_cast<void*>(&this->atoms_));
     for (auto a = this->atoms_.begin(); a != this->atoms_.end(); ++a) {
       this->UpdateMaxCoordinates(a->centre);
@@ -202,7 +274,8 @@ public:
   /**
    * @brief      For each atom in the protein, get the coordinates of its
    *             surrounding cube. Then store all atoms into the hash table
-   *             using the coordinates as keys.
+   *             using the coordinates as keys, next to the coordinates of the
+   *             atoms of each cube, laid out once for the distance kernel.
    *
    * @param[in]  min_coords  The minimum coordinates of a given Protein
    */
@@ -212,7 +285,11 @@ public:
     // keys.
     for (auto a = this->atoms_.begin(); a != this->atoms_.end(); ++a) {
       const Point cube_coord = Protein::GetCubeCoord(*a, min_coords);
-      this->hash_table_[cube_coord].push_back(*a);
+      Cube& cube = this->hash_table_[cube_coord];
+      cube.ids.push_back(a - this->atoms_.begin());
+      cube.xs.push_back(a->centre.x);
+      cube.ys.push_back(a->centre.y);
+      cube.zs.push_back(a->centre.z);
     }
   }
 
@@ -262,7 +339,7 @@ public:
     }
   }
 
-  HashTableType get_hash_table() {
+  const HashTableType& get_hash_table() {
     return this->hash_table_;
   }
 
@@ -287,16 +364,32 @@ private:
 
 
 int main(int argc, char const *argv[]) {
-  if (argc < 3) {
-    fprintf(stderr, "ERROR. Usage: detect_steric_clashes.exe file1.pdb file2.pdb [use_bruteforce]\n");
+  // The distance kernel runs on the most capable instruction set of the
+  // processor, unless another one is picked with --isa.
+  std::vector<const char*> args;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--isa") == 0 && arg + 1 < argc) {
+      if (cpu_select_isa(argv[++arg])) {
+        fprintf(stderr, "ERROR. Unknown or unsupported instruction set %s\n",
+          argv[arg]);
+        exit(1);
+      }
+    } else {
+      args.push_back(argv[arg]);
+    }
+  }
+  if (args.size() < 2) {
+    fprintf(stderr, "ERROR. Usage: detect_steric_clashes.exe "
+      "[--isa scalar|sse4.1|avx2|avx512bw] file1.pdb file2.pdb "
+      "[use_bruteforce]\n");
     exit(1);
   }
   bool use_hash = true;
-  if (argc >= 4) {
+  if (args.size() >= 3) {
     use_hash = false;
   }
-  Protein a = Protein(argv[1]);
-  Protein b = Protein(argv[2]);
+  Protein a = Protein(args[0]);
+  Protein b = Protein(args[1]);
   Protein::DetectStericOverlaps(a, b, use_hash);
   return 0;
 }
\ No newline at end of file
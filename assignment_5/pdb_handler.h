@@ -11,6 +11,7 @@ extern "C" {
 
 #include "atom.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,10 +34,89 @@ typedef struct {
   char s_z[9];
 } PdbEntry;
 
+/*
+ * @brief      Field of a PDB record: a slice of the mapped file, hence not
+ *             NUL-terminated. The fields past the end of a short line are
+ *             empty.
+ */
+typedef struct {
+  const char* data;
+  int length;
+} PdbField;
+
+/*
+ * @brief      ATOM or HETATM record, as slices of the mapped file.
+ */
+typedef struct {
+  PdbField serial;
+  PdbField name;
+  PdbField altLoc;
+  PdbField resName;
+  PdbField chainID;
+  PdbField resSeq;
+  PdbField iCode;
+  PdbField x;
+  PdbField y;
+  PdbField z;
+} PdbRecord;
+
 typedef void (*callback_ptr)(const PdbEntry*, int*, void* user_data);
+typedef void (*record_callback_ptr)(const PdbRecord*, int*, void* user_data);
 
+/**
+ * @brief      Calls a callback on each ATOM and HETATM record of a PDB file,
+ *             with the fields copied into a PdbEntry. The callback converts
+ *             the fields it reads. See scan_records().
+ *
+ * @return     The final value of the counter passed to the callback.
+ */
 int read_data(const char *filename, const callback_ptr callback, void* user_data);
 
+/**
+ * @brief      Calls a callback on each ATOM and HETATM record of a PDB file,
+ *             without copying it: the file is mapped, the lines are found
+ *             with memchr() and the fields of a record are slices of the
+ *             mapping. The other lines are only scanned for their end.
+ *
+ * @param[in]  filename   The PDB file
+ * @param[in]  callback   The callback, given the record, a counter starting
+ *                        at zero and the user data
+ * @param      user_data  The user data
+ *
+ * @return     The final value of the counter.
+ */
+int scan_records(const char* filename, const record_callback_ptr callback,
+  void* user_data);
+
+/**
+ * @brief      Parses an integer field, as atoi() does.
+ */
+int pdb_field_int(const PdbField field);
+
+/**
+ * @brief      Parses a coordinate field as a fixed-point integer, in
+ *             milli-angstroms. The %8.3f fields of the PDB format are parsed
+ *             exactly, without floating point; the other fields are rounded.
+ */
+int32_t pdb_field_milli(const PdbField field);
+
+/**
+ * @brief      Parses a real field, as strtof() does. The fields with at most
+ *             three decimals are parsed as integers, see pdb_field_milli().
+ */
+float pdb_field_float(const PdbField field);
+
+/**
+ * @brief      Parses a real field, as atof() does. The fields with at most
+ *             three decimals are parsed as integers, see pdb_field_milli().
+ */
+double pdb_field_double(const PdbField field);
+
+/**
+ * @brief      Copies a field into a string of at least length + 1 characters.
+ */
+void pdb_field_copy(const PdbField field, char* s);
+
 #ifdef __cplusplus
 }
 #endif